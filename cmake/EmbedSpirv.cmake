@@ -0,0 +1,89 @@
+# Compiles shaders/*.glsl with glslc and embeds the SPIR-V words into the binary.
+# Stage of a shader comes from its "// type: <stage>" line, as in scripts/CompileShaders.sh.
+#
+# Included, it defines embed_spirv(<out var> <shader dir> <output dir>),
+# which returns the generated source to add to the targets.
+# Run with -P, it writes that source out of the compiled .spv files:
+#   cmake -DOUTPUT=<file.cpp> -DSPIRV_FILES=<a.spv;b.spv> -P EmbedSpirv.cmake
+
+if (CMAKE_SCRIPT_MODE_FILE)
+    set(content "// Generated by cmake/EmbedSpirv.cmake, do not edit\n\n")
+    string(APPEND content "#include \"Etna/Core/Vulkan/VulkanShaderRegistry.h\"\n\n")
+    string(APPEND content "namespace vkc\n{\n")
+
+    set(table "")
+    set(index 0)
+    foreach (spirv_file ${SPIRV_FILES})
+        get_filename_component(name ${spirv_file} NAME)
+        file(READ ${spirv_file} hex HEX)
+
+        # SPIR-V is little endian words, byte order of the file is reversed per word
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+               "0x\\4\\3\\2\\1, " words "${hex}")
+        # Eight words a line
+        string(REPEAT "0x[0-9a-f]+, " 7 line_pattern)
+        string(REGEX REPLACE "(${line_pattern}0x[0-9a-f]+,) " "\\1\n        " words "${words}")
+        string(REGEX REPLACE "\n        $" "" words "${words}")
+        string(REGEX REPLACE ", $" "," words "${words}")
+
+        string(APPEND content "    static const uint32_t Spirv${index}[] = {\n        ${words}\n    };\n\n")
+        string(APPEND table "        {\"${name}\", Spirv${index}, sizeof(Spirv${index}) / sizeof(uint32_t)},\n")
+        math(EXPR index "${index} + 1")
+    endforeach ()
+
+    string(APPEND content "    extern const EmbeddedShader EmbeddedShaders[];\n")
+    string(APPEND content "    extern const uint32_t EmbeddedShaderCount;\n\n")
+    string(APPEND content "    const EmbeddedShader EmbeddedShaders[] = {\n${table}    };\n")
+    string(APPEND content "    const uint32_t EmbeddedShaderCount = ${index};\n}\n")
+
+    # Untouched output keeps the dependants from rebuilding
+    file(CONFIGURE OUTPUT ${OUTPUT} CONTENT "${content}" @ONLY)
+    return()
+endif ()
+
+function(embed_spirv out_var shader_dir output_dir)
+    if (NOT Vulkan_GLSLC_EXECUTABLE)
+        find_program(Vulkan_GLSLC_EXECUTABLE glslc HINTS $ENV{VULKAN_SDK}/bin)
+    endif ()
+    if (NOT Vulkan_GLSLC_EXECUTABLE)
+        message(WARNING "glslc is not found, shaders are read from ${shader_dir} at runtime")
+        set(${out_var} "" PARENT_SCOPE)
+        return()
+    endif ()
+
+    file(GLOB shader_sources CONFIGURE_DEPENDS ${shader_dir}/*.glsl)
+    file(GLOB shader_includes CONFIGURE_DEPENDS ${shader_dir}/include/*.glsl)
+
+    set(spirv_files "")
+    foreach (shader_source ${shader_sources})
+        get_filename_component(name ${shader_source} NAME_WE)
+        file(STRINGS ${shader_source} type_line REGEX "^[ \t]*//[ \t]*type:" LIMIT_COUNT 1)
+        string(REGEX REPLACE "^[ \t]*//[ \t]*type:[ \t]*([a-z]+).*$" "\\1" stage "${type_line}")
+        if (NOT stage)
+            message(FATAL_ERROR "Shader type is not specified in ${shader_source}")
+        endif ()
+
+        set(spirv_file ${output_dir}/${name}.spv)
+        add_custom_command(
+                OUTPUT ${spirv_file}
+                COMMAND ${CMAKE_COMMAND} -E make_directory ${output_dir}
+                COMMAND ${Vulkan_GLSLC_EXECUTABLE} -fshader-stage=${stage}
+                        --target-env=vulkan1.2 --target-spv=spv1.3
+                        -I ${shader_dir}/include ${shader_source} -o ${spirv_file}
+                DEPENDS ${shader_source} ${shader_includes}
+                COMMENT "Compiling ${name}.glsl"
+                VERBATIM)
+        list(APPEND spirv_files ${spirv_file})
+    endforeach ()
+
+    set(registry ${output_dir}/EmbeddedShaders.cpp)
+    add_custom_command(
+            OUTPUT ${registry}
+            COMMAND ${CMAKE_COMMAND} -DOUTPUT=${registry} "-DSPIRV_FILES=${spirv_files}"
+                    -P ${CMAKE_CURRENT_FUNCTION_LIST_FILE}
+            DEPENDS ${spirv_files} ${CMAKE_CURRENT_FUNCTION_LIST_FILE}
+            COMMENT "Embedding SPIR-V"
+            VERBATIM)
+
+    set(${out_var} ${registry} PARENT_SCOPE)
+endfunction()
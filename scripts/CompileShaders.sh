@@ -3,6 +3,9 @@
 # Define the source directory containing your shader files
 SOURCE_DIR="../shaders"
 
+# Shared code, included by the shaders rather than compiled on its own
+INCLUDE_DIR="$SOURCE_DIR/include"
+
 # Define the output directory for the compiled SPIR-V files
 OUTPUT_DIR="../bin/shaders"
 
@@ -29,7 +32,7 @@ for shader_file in "$SOURCE_DIR"/*.glsl; do
     if [ -n "$shader_type" ]; then
       # Compile the shader to SPIR-V using glslc, specifying the shader type
 
-      glslc -fshader-stage="${shader_type}" --target-env=vulkan1.2 --target-spv=spv1.3  "$shader_file" -o "$OUTPUT_DIR/$filename_no_ext.spv"
+      glslc -fshader-stage="${shader_type}" --target-env=vulkan1.2 --target-spv=spv1.3 -I "$INCLUDE_DIR" "$shader_file" -o "$OUTPUT_DIR/$filename_no_ext.spv"
 
       # Check if the compilation was successful
       if [ $? -eq 0 ]; then
@@ -0,0 +1,68 @@
+// type: compute
+#version 450
+
+// Frustum culling of the brick proxy's boxes, see vkc::BrickProxy.
+// Visible boxes are appended to the list the draw's instances index into.
+
+// Has to match CullGroupSize in VulkanBrickProxy.cpp
+layout(local_size_x = 64) in;
+
+// Layout of vkc::ProxyBox, w is unused
+struct ProxyBox
+{
+    vec4 Min;
+    vec4 Max;
+};
+
+layout(set = 0, binding = 0) readonly buffer ProxyBoxes
+{
+    ProxyBox boxes[];
+};
+layout(set = 0, binding = 1) writeonly buffer VisibleBoxes
+{
+    uint visible[];
+};
+// VkDrawIndexedIndirectCommand, its instance count is reset to zero before the dispatch
+layout(set = 0, binding = 2) buffer DrawArguments
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+} draw;
+
+layout(push_constant) uniform CullConstants
+{
+    mat4 ModelViewProjection;
+    uint BoxCount;
+} pc;
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= pc.BoxCount)
+    {
+        return;
+    }
+
+    ProxyBox box = boxes[index];
+
+    // Box is culled if all of its corners are outside of the same clip plane, depth spans [0, w]
+    ivec3 below = ivec3(0);
+    ivec3 above = ivec3(0);
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec3 position = mix(box.Min.xyz, box.Max.xyz, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+        vec4 clip = pc.ModelViewProjection * vec4(position, 1.0);
+        below += ivec3(lessThan(clip.xyz, vec3(-clip.w, -clip.w, 0.0)));
+        above += ivec3(greaterThan(clip.xyz, vec3(clip.w)));
+    }
+    if (any(equal(below, ivec3(8))) || any(equal(above, ivec3(8))))
+    {
+        return;
+    }
+
+    uint slot = atomicAdd(draw.InstanceCount, 1u);
+    visible[slot] = index;
+}
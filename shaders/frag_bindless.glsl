@@ -0,0 +1,34 @@
+// type: fragment
+#version 450
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec2 fragTexCoord;
+// Box of the proxy's brick, or all of the cube
+layout(location = 2) flat in vec3 fragClipMin;
+layout(location = 3) flat in vec3 fragClipMax;
+
+layout(location = 0) out vec4 outColor;
+
+#include "VolumeMarch.glsl"
+
+// Has to match BindlessTextureTable::Capacity
+#define BINDLESS_VOLUME_CAPACITY 1024
+
+// Partially bound, only registered slots are valid
+layout(set = 1, binding = 0) uniform sampler3D volumes[BINDLESS_VOLUME_CAPACITY];
+
+vec4 SampleVolume(vec3 uvw)
+{
+    // Same index for the whole draw, so no nonuniformEXT
+    return texture(volumes[pc.TextureIndex], uvw);
+}
+
+vec2 SampleBaked(vec3 uvw)
+{
+    return texture(volumes[pc.BakedIndex], uvw).xy;
+}
+
+void main()
+{
+    outColor = MarchVolume(fragPosition, fragClipMin, fragClipMax);
+}
@@ -0,0 +1,36 @@
+// type: fragment
+#version 450
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+// Instrumented frag_bindless.glsl, the cost set goes after the table's
+#define MARCH_COST
+#define COST_SET 2
+#include "VolumeMarch.glsl"
+#include "MarchCost.glsl"
+
+// Has to match BindlessTextureTable::Capacity
+#define BINDLESS_VOLUME_CAPACITY 1024
+
+// Partially bound, only registered slots are valid
+layout(set = 1, binding = 0) uniform sampler3D volumes[BINDLESS_VOLUME_CAPACITY];
+
+vec4 SampleVolume(vec3 uvw)
+{
+    // Same index for the whole draw, so no nonuniformEXT
+    return texture(volumes[pc.TextureIndex], uvw);
+}
+
+vec2 SampleBaked(vec3 uvw)
+{
+    return texture(volumes[pc.BakedIndex], uvw).xy;
+}
+
+void main()
+{
+    MarchVolume(fragPosition);
+    outColor = RecordMarchCost();
+}
@@ -0,0 +1,33 @@
+// type: fragment
+#version 450
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+// Instrumented frag.glsl, the cost set goes after the scene's
+#define MARCH_COST
+#define COST_SET 1
+#include "VolumeMarch.glsl"
+#include "MarchCost.glsl"
+
+layout(binding = 2) uniform sampler3D texSampler;
+// Holds the volume itself while nothing is baked
+layout(binding = 3) uniform sampler3D bakedSampler;
+
+vec4 SampleVolume(vec3 uvw)
+{
+    return texture(texSampler, uvw);
+}
+
+vec2 SampleBaked(vec3 uvw)
+{
+    return texture(bakedSampler, uvw).xy;
+}
+
+void main()
+{
+    MarchVolume(fragPosition);
+    outColor = RecordMarchCost();
+}
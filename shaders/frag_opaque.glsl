@@ -0,0 +1,21 @@
+// type: fragment
+#version 450
+
+// Opaque boxes drawn before the volume, they only write depth and a flat shade.
+// Shades have to match OccluderFaceShades in ShaderData.h.
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+const vec3 FaceShades = vec3(0.3, 0.4, 0.5);
+
+void main()
+{
+    // Faces of a box are axis aligned in its own space, the normal picks the shade
+    vec3 normal = abs(cross(dFdx(fragPosition), dFdy(fragPosition)));
+    float shade = normal.x > normal.y && normal.x > normal.z ? FaceShades.x
+                : normal.y > normal.z ? FaceShades.y : FaceShades.z;
+    outColor = vec4(vec3(shade), 1.0);
+}
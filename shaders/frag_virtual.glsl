@@ -0,0 +1,103 @@
+// type: fragment
+#version 450
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+#include "VolumeMarch.glsl"
+
+// Have to match VirtualVolume in VulkanVirtualVolume.h
+#define MAX_LEVELS 12
+#define PAGE_RESIDENT 0x80000000u
+#define REQUEST_VALID 0x80000000u
+
+layout(set = 1, binding = 0) uniform sampler3D atlas;
+
+layout(set = 1, binding = 1) uniform VirtualVolumeInfo
+{
+    vec4 AtlasScale;
+    uvec4 Layout;     // Brick size, border, level count, feedback capacity
+    vec4 Lod;         // x level 0 voxels a pixel covers at unit distance, y bias
+    uvec4 Frame;      // x feedback phase
+    uvec4 LevelGrid[MAX_LEVELS];
+    vec4 LevelExtent[MAX_LEVELS];
+} vvi;
+
+layout(set = 1, binding = 2) readonly buffer PageTable
+{
+    uint Entries[];
+} pages;
+
+// Hashed set of bricks the frame wanted, read back by the CPU
+layout(set = 1, binding = 3) buffer Feedback
+{
+    uint Requests[];
+} feedback;
+
+bool writesFeedback;
+uint lastRequest = 0u;
+
+void RequestBrick(uint level, uvec3 brick)
+{
+    uint request = REQUEST_VALID | (level << 27) | (brick.z << 18) | (brick.y << 9) | brick.x;
+    if (!writesFeedback || request == lastRequest)
+    {
+        return;
+    }
+    lastRequest = request;
+
+    // Collisions are dropped, the brick is requested again next frame
+    uint slot = (request * 2654435761u) % vvi.Layout.w;
+    atomicCompSwap(feedback.Requests[slot], 0u, request);
+}
+
+vec4 SampleVolume(vec3 uvw)
+{
+    // Pixel footprint grows with the distance from the camera
+    vec3 cameraUvw = pc.CameraLocal * 0.5 + 0.5;
+    float footprint = distance(uvw, cameraUvw) * 2.0 * vvi.Lod.x;
+    uint levelCount = vvi.Layout.z;
+    uint wanted = uint(clamp(log2(max(footprint, 1.0)) + vvi.Lod.y, 0.0, float(levelCount - 1u)));
+
+    // Same wrapping as the sampler of the dense volume
+    uvw = 1.0 - abs(mod(uvw, 2.0) - 1.0);
+
+    uint brickSize = vvi.Layout.x;
+    for (uint level = wanted; level < levelCount; level++)
+    {
+        vec3 voxel = uvw * vvi.LevelExtent[level].xyz;
+        uvec4 grid = vvi.LevelGrid[level];
+        uvec3 brick = min(uvec3(voxel) / brickSize, grid.xyz - 1u);
+        if (level == wanted)
+        {
+            RequestBrick(level, brick);
+        }
+
+        uint entry = pages.Entries[grid.w + brick.x + grid.x * (brick.y + grid.y * brick.z)];
+        if ((entry & PAGE_RESIDENT) != 0u)
+        {
+            uvec3 slot = uvec3(entry & 0xFFu, (entry >> 8) & 0xFFu, (entry >> 16) & 0xFFu);
+            vec3 texel = vec3(slot * (brickSize + 2u * vvi.Layout.y) + vvi.Layout.y) + voxel - vec3(brick * brickSize);
+            return textureLod(atlas, texel * vvi.AtlasScale.xyz, 0.0);
+        }
+    }
+
+    // Coarsest level is pinned, so this is never reached
+    return vec4(0.0);
+}
+
+vec2 SampleBaked(vec3 uvw)
+{
+    // Streamed volumes are never baked
+    return vec2(0.0);
+}
+
+void main()
+{
+    // A different eighth of the pixels reports every frame, which keeps the feedback small
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    writesFeedback = ((pixel.x + 3u * pixel.y) & 7u) == vvi.Frame.x;
+    outColor = MarchVolume(fragPosition);
+}
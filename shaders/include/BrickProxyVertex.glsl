@@ -0,0 +1,51 @@
+// Unit cube scaled to the box of an occupied brick, an instance per box the culling kept.
+// See vkc::BrickProxy, the full-screen triangle marches the whole box as in vert.glsl.
+// Includer defines PROXY_SET, the set of the boxes, before it.
+
+#include "DrawPushConstants.glsl"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragPosition;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out vec3 fragClipMin;
+layout(location = 3) flat out vec3 fragClipMax;
+
+// Layout of vkc::ProxyBox, w is unused
+struct ProxyBox
+{
+    vec4 Min;
+    vec4 Max;
+};
+
+layout(set = PROXY_SET, binding = 0) readonly buffer ProxyBoxes
+{
+    ProxyBox boxes[];
+};
+layout(set = PROXY_SET, binding = 1) readonly buffer VisibleBoxes
+{
+    uint visible[];
+};
+
+#include "FullscreenTriangle.glsl"
+
+void main()
+{
+    if (pc.Fullscreen != 0u)
+    {
+        fragClipMin = vec3(-1.0);
+        fragClipMax = vec3(1.0);
+        EmitFullscreenTriangle();
+        return;
+    }
+
+    ProxyBox box = boxes[visible[gl_InstanceIndex]];
+    // Corners are exact, so boxes sharing a face rasterize without gaps
+    vec3 position = mix(box.Min.xyz, box.Max.xyz, inPosition * 0.5 + 0.5);
+    gl_Position = pc.ModelViewProjection * vec4(position, 1.0);
+    fragPosition = position;
+    fragTexCoord = inTexCoord;
+    fragClipMin = box.Min.xyz;
+    fragClipMax = box.Max.xyz;
+}
@@ -0,0 +1,13 @@
+// Per-draw data, layout of DrawPushConstants in ShaderData.h
+layout(push_constant) uniform DrawPushConstants
+{
+    mat4 ModelViewProjection;
+    vec3 CameraLocal;
+    int MaxSteps;
+    uint TextureIndex; // Slot in the bindless table, unused otherwise
+    float StepQuality;
+    float PixelAngle;
+    uint BakedChannels; // Channels folded into the baked volume, zero if there's none
+    uint BakedIndex;    // Slot of the baked volume in the bindless table
+    uint Fullscreen;    // Triangle covering the viewport instead of the cube, camera is in or close to it
+} pc;
@@ -0,0 +1,13 @@
+// Full-screen triangle of the volume's vertex shaders, drawn with three vertices and no vertex buffer.
+// Includer declares the fragPosition and fragTexCoord outputs.
+
+void EmitFullscreenTriangle()
+{
+    // Counter-clockwise triangle over the whole viewport, in front of any depth
+    vec2 ndc = vec2(gl_VertexIndex == 2 ? 3.0 : -1.0, gl_VertexIndex == 1 ? 3.0 : -1.0);
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    // Pixel's point on the far plane in the box's local space, it's linear across the screen
+    vec4 farPoint = inverse(pc.ModelViewProjection) * vec4(ndc, 1.0, 1.0);
+    fragPosition = farPoint.xyz / farPoint.w;
+    fragTexCoord = ndc * 0.5 + 0.5;
+}
@@ -0,0 +1,55 @@
+// Per-pixel cost of the raymarch, layouts of CostMap in VulkanCostMap.h.
+// Includer defines MARCH_COST and COST_SET, the index of the cost set, before VolumeMarch.glsl.
+
+// Density samples in the low, texture fetches in the high 16 bits, cleared every frame
+layout(set = COST_SET, binding = 0, r32ui) uniform writeonly uimage2D costImage;
+
+// Totals of the frame, read back by the CPU.
+// Samples and fetches of a frame overflow 32 bits, so they are split into low and high words.
+layout(set = COST_SET, binding = 1) buffer CostTotals
+{
+    uint Pixels;
+    uint SamplesLow;
+    uint SamplesHigh;
+    uint FetchesLow;
+    uint FetchesHigh;
+    uint MaxSamples;
+} costTotals;
+
+// Fixed steps take MaxSteps samples at most, adaptive ones go past it where the media is busy
+const float HeatSamplesScale = 2.0;
+
+/// Blue through green to red, for heat within [0, 1]
+vec3 HeatColor(float heat)
+{
+    vec3 cold = mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), clamp(heat * 2.0, 0.0, 1.0));
+    return mix(cold, vec3(1.0, 0.0, 0.0), clamp(heat * 2.0 - 1.0, 0.0, 1.0));
+}
+
+/// Record the counts of the pixel's march and replace its color with their heat.
+/// Rays, which took no sample, leave the target as it is.
+vec4 RecordMarchCost()
+{
+    if (marchSamples == 0u)
+    {
+        return vec4(0.0);
+    }
+
+    imageStore(costImage, ivec2(gl_FragCoord.xy), uvec4(min(marchSamples, 0xFFFFu) | (min(marchFetches, 0xFFFFu) << 16)));
+    atomicAdd(costTotals.Pixels, 1u);
+    // Add, which wraps the low word, carries into the high one
+    uint samples = atomicAdd(costTotals.SamplesLow, marchSamples);
+    if (samples > 0xFFFFFFFFu - marchSamples)
+    {
+        atomicAdd(costTotals.SamplesHigh, 1u);
+    }
+    uint fetches = atomicAdd(costTotals.FetchesLow, marchFetches);
+    if (fetches > 0xFFFFFFFFu - marchFetches)
+    {
+        atomicAdd(costTotals.FetchesHigh, 1u);
+    }
+    atomicMax(costTotals.MaxSamples, marchSamples);
+
+    float heat = float(marchSamples) / (float(max(pc.MaxSteps, 1)) * HeatSamplesScale);
+    return vec4(HeatColor(clamp(heat, 0.0, 1.0)), 1.0);
+}
@@ -0,0 +1,201 @@
+// Raymarching of the noise volume, shared by the bound and the bindless fragment shaders.
+// Includer defines SampleVolume and SampleBaked, and calls MarchVolume with the box-local position,
+// either on the cube's face or, for the full-screen triangle, anywhere along the pixel's ray.
+// Brick proxy marches only the part of the ray within the brick's box, see vkc::BrickProxy.
+// Includers defining MARCH_COST before it count the density samples and fetches, see MarchCost.glsl.
+
+#include "DrawPushConstants.glsl"
+
+// WorldToLocal, CameraPosition, MaxSteps and StepQuality are pushed per draw instead.
+// Depth and camera fields follow GlobalShaderData in ShaderData.h.
+layout(binding = 1) uniform GlobalShaderData
+{
+    mat4 WorldToLocal;
+    vec3 CameraPosition;
+    int MaxSteps;
+    mat4 MediaScroll;
+    float StepQuality;
+    float DepthScale;
+    float DepthBias;
+    int OpaqueDepth;
+    vec4 CameraForward;
+} gsd;
+
+// Depth of the opaque geometry drawn before the volume, in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+layout(binding = 4) uniform sampler2D sceneDepth;
+
+vec4 SampleVolume(vec3 uvw);
+// Static channels folded together, only called when pc.BakedChannels isn't zero
+vec2 SampleBaked(vec3 uvw);
+
+vec2 IntersectAABB(vec3 rayOrigin, vec3 rayDir, vec3 boxMin, vec3 boxMax)
+{
+    vec3 tMin = (boxMin - rayOrigin) / rayDir;
+    vec3 tMax = (boxMax - rayOrigin) / rayDir;
+    vec3 t1 = min(tMin, tMax);
+    vec3 t2 = max(tMin, tMax);
+    float tNear = max(max(t1.x, t1.y), t1.z);
+    float tFar = min(min(t2.x, t2.y), t2.z);
+    return vec2(tNear, tFar);
+}
+
+const float density = 1;
+const vec3 boxMin = vec3(-1,-1,-1);
+const vec3 boxMax = vec3( 1, 1, 1);
+
+// Adaptive stepping, mirrored by the CPU reference raymarcher.
+// Step is scaled within [MinStepScale, MaxStepScale] of the base one, down where the density
+// or twice its change over the last step reaches ActivityRange, up where the ray crosses empty or smooth media.
+const float MinStepScale = 0.5;
+const float MaxStepScale = 4.0;
+const float ActivityRange = 0.1;
+// Bounds the loop, the shortest steps of up to 256 MaxSteps still cross the box within it
+const int MaxAdaptiveSamples = 2048;
+
+#ifdef MARCH_COST
+uint marchSamples = 0u;
+uint marchFetches = 0u;
+#define COUNT_SAMPLE(fetches) marchSamples++; marchFetches += (fetches)
+#else
+#define COUNT_SAMPLE(fetches)
+#endif
+
+float SampleDensity(vec3 uvw)
+{
+    float scale = 0.2;
+
+    // Same for the whole draw, so every invocation takes the same branch
+    uint baked = pc.BakedChannels;
+    if (baked != 0u)
+    {
+        // R holds the static terms, G the static (sample1 * sample2) * scale, see DensityBake.h
+        vec2 folded = SampleBaked(uvw);
+        float density = folded.x;
+        COUNT_SAMPLE(1u + uint((baked & 4u) == 0u) + uint((baked & 8u) == 0u));
+        if ((baked & 4u) == 0u)
+        {
+            density += folded.y * SampleVolume(uvw*0.75 + vec3(gsd.MediaScroll[0].z,gsd.MediaScroll[1].z,gsd.MediaScroll[2].z) * 0.25).z;
+        }
+        if ((baked & 8u) == 0u)
+        {
+            density += folded.y * SampleVolume(uvw*0.7 + vec3(gsd.MediaScroll[0].w,gsd.MediaScroll[1].w,gsd.MediaScroll[2].w) * 0.3).w;
+        }
+        return density;
+    }
+
+    COUNT_SAMPLE(4u);
+    float sample1 = SampleVolume(uvw).x;
+    float sample2 = SampleVolume(uvw*0.8 + vec3(gsd.MediaScroll[0].y,gsd.MediaScroll[1].y,gsd.MediaScroll[2].y) * 0.2).y;
+    float sample3 = SampleVolume(uvw*0.75 + vec3(gsd.MediaScroll[0].z,gsd.MediaScroll[1].z,gsd.MediaScroll[2].z) * 0.25).z;
+    float sample4 = SampleVolume(uvw*0.7 + vec3(gsd.MediaScroll[0].w,gsd.MediaScroll[1].w,gsd.MediaScroll[2].w) * 0.3).w;
+    return (sample1 * sample2 ) * (sample3 + sample4) * scale;
+}
+
+/// Optical depth along the ray inside of the box, tNear is the distance from the camera to uvwIn
+float MarchAdaptive(vec3 uvwIn, vec3 uvwDirection, float tNear, float rayLength, float baseStep)
+{
+    float previous = SampleDensity(uvwIn);
+    float change = 0;
+    float accumDist = 0;
+    float t = 0;
+    for (int i = 1; i < MaxAdaptiveSamples && t < rayLength; ++i)
+    {
+        float activity = max(previous, change * 2.0);
+        float smoothness = 1.0 - clamp(activity / ActivityRange, 0.0, 1.0);
+        float stepLength = baseStep * mix(MinStepScale, MaxStepScale, smoothness);
+
+        // No use stepping finer than a pixel covers at this distance
+        stepLength = max(stepLength, (tNear + t) * pc.PixelAngle);
+        stepLength = min(stepLength, rayLength - t);
+        t += stepLength;
+
+        // Trapezoids weighted by the step's length keep the optical depth independent of the sampling,
+        // and a long step doesn't stretch a single sample over the whole of it
+        float current = SampleDensity(uvwIn + uvwDirection * t);
+        accumDist += (previous + current) * 0.5 * stepLength;
+        change = abs(current - previous);
+        previous = current;
+    }
+    return accumDist;
+}
+
+/// Box-local distance along the ray to the opaque surface of this pixel, if it's closer than tFar.
+/// View depth is recovered from the projection, then measured along the ray instead of the view axis.
+float ClampToOpaque(vec3 rayDirection, float tFar)
+{
+    float depth = texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r;
+    if (depth >= 1.0)
+    {
+        return tFar;
+    }
+    float viewDepth = gsd.DepthScale / (depth + gsd.DepthBias);
+    return min(tFar, viewDepth / dot(rayDirection, gsd.CameraForward.xyz));
+}
+
+/// Segment of the ray within [clipMin, clipMax], texture coordinates still span the whole box
+vec4 MarchVolume(vec3 fragmentInBoxLocal, vec3 clipMin, vec3 clipMax)
+{
+    vec3 cameraInBoxLocal = pc.CameraLocal;
+    vec3 rayDirection = normalize(fragmentInBoxLocal - cameraInBoxLocal);
+    vec2 intersection = IntersectAABB(cameraInBoxLocal, rayDirection, clipMin, clipMax);
+
+    // Ray starts at the near plane, which matters once the camera is in the box
+    float nearPlane = gsd.DepthScale / gsd.DepthBias;
+    intersection.x = max(intersection.x, nearPlane / dot(rayDirection, gsd.CameraForward.xyz));
+
+    // Ray ends at the opaque geometry, nothing behind it is sampled
+    if (gsd.OpaqueDepth != 0)
+    {
+        intersection.y = ClampToOpaque(rayDirection, intersection.y);
+    }
+
+    // Full-screen rays, which miss the box or are hidden, leave the target as it is
+    if (intersection.x >= intersection.y)
+    {
+        return vec4(0.0);
+    }
+
+    // Step count is picked by the quality governor
+    int maxSteps = max(pc.MaxSteps, 1);
+
+    // Points of ray-box intersection
+    float stepSize = (1.0f / maxSteps) * 4;
+    vec3 Pin = cameraInBoxLocal + rayDirection * intersection.x;
+    vec3 Pout = cameraInBoxLocal + rayDirection * intersection.y;
+    vec3 stepVec = stepSize * rayDirection;
+    int actualSteps = min(maxSteps, int(distance(Pin, Pout) / stepSize));
+
+    // Normilize points in range [0, 1]
+    Pin -= boxMin;
+    Pout -= boxMin;
+    vec3 boxRange = abs(boxMax-boxMin);
+    Pin /= boxRange;
+    Pout /= boxRange;
+    stepVec /= boxRange;
+    vec3 accumDist = vec3(0);
+
+    if (pc.StepQuality > 0)
+    {
+        // Ray is marched to its end, however long it is
+        accumDist = vec3(MarchAdaptive(Pin, rayDirection / boxRange, intersection.x,
+                                       intersection.y - intersection.x, stepSize / pc.StepQuality));
+    }
+    else
+    {
+        for (int i = 0; i < actualSteps; ++i)
+        {
+            accumDist += SampleDensity(Pin);
+            Pin += stepVec;
+        }
+        accumDist *= stepSize;
+    }
+
+    // Beer-Lambert. Media is white, so its opacity is its premultiplied color, blended over the opaque pass.
+    vec3 color = vec3(1) - exp(vec3(density) * min(-accumDist, vec3(0,0,0)));
+    return vec4(color, color.x);
+}
+
+vec4 MarchVolume(vec3 fragmentInBoxLocal)
+{
+    return MarchVolume(fragmentInBoxLocal, boxMin, boxMax);
+}
@@ -1,22 +1,32 @@
 // type: vertex
 #version 450
 
-layout(binding = 0) uniform ObjectShaderData
-{
-    mat4 Model;
-    mat4 View;
-    mat4 Projection;
-} osd;
+#include "DrawPushConstants.glsl"
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragPosition;
 layout(location = 1) out vec2 fragTexCoord;
+// Part of the box the ray is marched through, all of it for the plain cube
+layout(location = 2) flat out vec3 fragClipMin;
+layout(location = 3) flat out vec3 fragClipMax;
+
+#include "FullscreenTriangle.glsl"
 
 void main()
 {
-    gl_Position = osd.Projection * osd.View * osd.Model * vec4(inPosition, 1.0);
-    fragPosition = vec3(osd.Model * vec4(inPosition, 1));
+    fragClipMin = vec3(-1.0);
+    fragClipMax = vec3(1.0);
+
+    if (pc.Fullscreen != 0u)
+    {
+        EmitFullscreenTriangle();
+        return;
+    }
+
+    gl_Position = pc.ModelViewProjection * vec4(inPosition, 1.0);
+    // Raymarching happens in the box's local space
+    fragPosition = inPosition;
     fragTexCoord = inTexCoord;
 }
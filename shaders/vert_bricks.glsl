@@ -0,0 +1,6 @@
+// type: vertex
+#version 450
+
+// Boxes follow the scene's set
+#define PROXY_SET 1
+#include "BrickProxyVertex.glsl"
@@ -0,0 +1,6 @@
+// type: vertex
+#version 450
+
+// Boxes follow the scene's set and the bindless table
+#define PROXY_SET 2
+#include "BrickProxyVertex.glsl"
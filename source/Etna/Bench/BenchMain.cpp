@@ -0,0 +1,584 @@
+/*
+ * VolumeBench: renders the volume scene headless along scripted
+ * camera paths for every combination of volume size, step count
+ * and resolution scale, and reports timings as JSON.
+ *
+ * Usage:
+ *      VolumeBench [--sizes 64,128,256,512] [--steps 64,128] [--scales 0.5,1.0]
+ *                  [--qualities 0,1] [--proxies 0,1] [--paths orbit,dolly] [--extent 1280x720]
+ *                  [--warmup 16] [--frames 128] [--out bench.json]
+ *
+ * Quality zero marches at fixed steps, others adapt them, see GlobalShaderData::StepQuality.
+ * Samples are only estimated for fixed steps, adaptive ones depend on the media
+ * and are reported as null. VolumeRef error measures them on the CPU instead.
+ * Proxy draws the occupied bricks instead of the whole cube, only with adaptive steps,
+ * see VolumeScene::SetBrickProxy. Each of its runs is compared against the cube's at the end,
+ * the report has the fractions of the cube's fragments and GPU p50 of every such run.
+ * Fragments are the volume pass' fragment shader invocations, null without pipeline statistics.
+ */
+
+#include "Etna/Core/Vulkan/VulkanContext.h"
+#include "Etna/Core/Vulkan/VulkanRenderer.h"
+
+#include "Etna/Core/Utils.h"
+#include "Etna/Core/Profiler.h"
+#include "Etna/Scene/VolumeScene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <ctime>
+    #include <sys/resource.h>
+#endif
+
+struct BenchSettings
+{
+    std::vector<uint32_t> Sizes = {64, 128, 256, 512};
+    std::vector<uint32_t> Steps = {64, 128};
+    std::vector<float> Scales = {0.5f, 1.0f};
+    std::vector<float> Qualities = {0.0f, VolumeScene::DefaultStepQuality};
+    std::vector<bool> Proxies = {false, true};
+    std::vector<std::string> Paths = {"orbit", "dolly"};
+    VkExtent2D Extent = {1280, 720};
+    uint32_t WarmupFrames = 16;
+    uint32_t MeasuredFrames = 128;
+    std::string OutputPath = "bench.json";
+};
+
+struct Percentiles
+{
+    double Min = 0, P50 = 0, P95 = 0, P99 = 0, Max = 0, Avg = 0;
+};
+
+struct BenchRun
+{
+    std::string Path;
+    uint32_t Size;
+    uint32_t Steps;
+    float StepQuality;
+    bool Proxy;
+    VkExtent2D Resolution;
+    Percentiles CpuMs;
+    Percentiles FrameMs;
+    Percentiles GpuMs;
+    size_t GpuSamples;
+    double SamplesPerFrame;
+    double SamplesPerSecond;
+    size_t FragmentSamples;
+    double FragmentsPerFrame;
+};
+
+static std::vector<std::string> Split(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static BenchSettings ParseArguments(int argc, char** argv)
+{
+    BenchSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            Error("Missing value for argument %s.", arg.c_str());
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--sizes")
+        {
+            settings.Sizes.clear();
+            for (const auto& item : Split(value)) settings.Sizes.push_back(std::stoul(item));
+        }
+        else if (arg == "--steps")
+        {
+            settings.Steps.clear();
+            for (const auto& item : Split(value)) settings.Steps.push_back(std::stoul(item));
+        }
+        else if (arg == "--scales")
+        {
+            settings.Scales.clear();
+            for (const auto& item : Split(value)) settings.Scales.push_back(std::stof(item));
+        }
+        else if (arg == "--qualities")
+        {
+            settings.Qualities.clear();
+            for (const auto& item : Split(value)) settings.Qualities.push_back(std::stof(item));
+        }
+        else if (arg == "--proxies")
+        {
+            settings.Proxies.clear();
+            for (const auto& item : Split(value)) settings.Proxies.push_back(std::stoul(item) != 0);
+        }
+        else if (arg == "--paths")
+        {
+            settings.Paths = Split(value);
+        }
+        else if (arg == "--extent")
+        {
+            auto separator = value.find('x');
+            if (separator == std::string::npos)
+            {
+                Error("Extent has to look like 1280x720, got %s.", value.c_str());
+            }
+            settings.Extent = {
+                static_cast<uint32_t>(std::stoul(value.substr(0, separator))),
+                static_cast<uint32_t>(std::stoul(value.substr(separator + 1)))
+            };
+        }
+        else if (arg == "--warmup")
+        {
+            settings.WarmupFrames = std::stoul(value);
+        }
+        else if (arg == "--frames")
+        {
+            settings.MeasuredFrames = std::stoul(value);
+        }
+        else if (arg == "--out")
+        {
+            settings.OutputPath = value;
+        }
+        else
+        {
+            Error("Unknown argument %s.", arg.c_str());
+        }
+    }
+    return settings;
+}
+
+/// Camera along the path, progress is in range [0, 1]
+static VolumeCamera GetPathCamera(const std::string& path, float progress)
+{
+    VolumeCamera camera;
+    if (path == "orbit")
+    {
+        // Full circle at the demo's distance and height
+        float radius = std::sqrt(18.0f);
+        float angle = glm::radians(45.0f) + progress * glm::two_pi<float>();
+        camera.Position = {radius * std::cos(angle), radius * std::sin(angle), 3.0f};
+    }
+    else if (path == "dolly")
+    {
+        // From far away, until the volume covers the whole screen
+        float distance = glm::mix(8.0f, 2.2f, progress);
+        camera.Position = glm::normalize(glm::vec3(1.0f)) * distance;
+    }
+    else
+    {
+        Error("Unknown camera path %s.", path.c_str());
+    }
+    return camera;
+}
+
+/// Raymarch samples taken by the fragment shader, estimated on a sparse pixel grid.
+/// Mirrors step count logic of fixed stepping in VolumeMarch.glsl for the unit cube.
+static double EstimateSamples(const VolumeCamera& camera, VkExtent2D extent, uint32_t maxSteps)
+{
+    const uint32_t stride = 4;
+    float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+    glm::mat4 inverseViewProjection = glm::inverse(
+        VolumeScene::GetProjection(camera, aspect) * VolumeScene::GetView(camera));
+
+    float stepSize = 4.0f / static_cast<float>(maxSteps);
+    double samples = 0;
+    for (uint32_t y = stride / 2; y < extent.height; y += stride)
+    {
+        for (uint32_t x = stride / 2; x < extent.width; x += stride)
+        {
+            glm::vec2 ndc = {
+                2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(extent.width) - 1.0f,
+                2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(extent.height) - 1.0f
+            };
+            glm::vec4 point = inverseViewProjection * glm::vec4(ndc, 0.5f, 1.0f);
+            glm::vec3 direction = glm::normalize(glm::vec3(point) / point.w - camera.Position);
+
+            glm::vec3 t1 = (glm::vec3(-1.0f) - camera.Position) / direction;
+            glm::vec3 t2 = (glm::vec3(1.0f) - camera.Position) / direction;
+            glm::vec3 tMin = glm::min(t1, t2);
+            glm::vec3 tMax = glm::max(t1, t2);
+            float tNear = std::max(std::max(tMin.x, tMin.y), tMin.z);
+            float tFar = std::min(std::min(tMax.x, tMax.y), tMax.z);
+            if (tNear >= tFar || tNear <= 0.0f)
+            {
+                continue;
+            }
+
+            auto steps = static_cast<uint32_t>((tFar - tNear) / stepSize);
+            samples += std::min(steps, maxSteps);
+        }
+    }
+    return samples * stride * stride;
+}
+
+static Percentiles ComputePercentiles(std::vector<double> values)
+{
+    Percentiles result;
+    if (values.empty())
+    {
+        return result;
+    }
+
+    std::sort(values.begin(), values.end());
+    auto rank = [&](double p)
+    {
+        auto index = static_cast<size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+    };
+
+    result.Min = values.front();
+    result.P50 = rank(0.50);
+    result.P95 = rank(0.95);
+    result.P99 = rank(0.99);
+    result.Max = values.back();
+    for (double value : values)
+    {
+        result.Avg += value;
+    }
+    result.Avg /= static_cast<double>(values.size());
+    return result;
+}
+
+/// CPU time of the calling thread in milliseconds, driver threads are not included
+static double GetThreadCpuMs()
+{
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    auto toMs = [](FILETIME time) { return (static_cast<double>(time.dwHighDateTime) * 4294967296.0 + time.dwLowDateTime) * 1e-4; };
+    return toMs(kernel) + toMs(user);
+#else
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<double>(time.tv_sec) * 1e3 + static_cast<double>(time.tv_nsec) * 1e-6;
+#endif
+}
+
+static double GetPeakMemoryMb()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<double>(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    #if defined(__APPLE__)
+        return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+    #else
+        return static_cast<double>(usage.ru_maxrss) / 1024.0;
+    #endif
+#endif
+}
+
+static BenchRun RunBench(vkc::Renderer& renderer, VolumeScene& scene, const BenchSettings& settings,
+                         const std::string& path, uint32_t steps, float scale, float quality, bool proxy)
+{
+    renderer.GetQualityGovernor().Pin(scale, steps);
+    scene.SetStepQuality(quality);
+    scene.SetBrickProxy(proxy);
+    auto& profiler = renderer.GetGpuProfiler();
+
+    std::vector<double> cpuMs, frameMs, gpuMs;
+    double totalSamples = 0;
+    double totalFragments = 0;
+    size_t fragmentSamples = 0;
+    VkExtent2D resolution = {};
+
+    uint32_t totalFrames = settings.WarmupFrames + settings.MeasuredFrames;
+    for (uint32_t i = 0; i < totalFrames; i++)
+    {
+        PROFILE_SCOPE("BenchFrame");
+        bool measured = i >= settings.WarmupFrames;
+        auto frameStart = std::chrono::steady_clock::now();
+        double cpuStart = GetThreadCpuMs();
+
+        float progress = static_cast<float>(i) / static_cast<float>(std::max(totalFrames - 1, 1u));
+        VolumeCamera camera = GetPathCamera(path, progress);
+        // Fixed time step, so media scrolls the same in every run
+        float time = static_cast<float>(i) / 60.0f;
+
+        uint64_t resolvedFrames = profiler.GetResolvedFrames();
+        renderer.BeginFrame();
+        float lastGpuMs = 0.0f;
+        if (measured && profiler.GetResolvedFrames() != resolvedFrames && profiler.GetLastMs("Frame", lastGpuMs))
+        {
+            gpuMs.push_back(lastGpuMs);
+
+            // Pass is the same for the whole run, the warmup covers the frames in flight
+            uint64_t fragments = 0;
+            if (profiler.GetLastFragments(scene.GetVolumePassName(), fragments))
+            {
+                totalFragments += static_cast<double>(fragments);
+                fragmentSamples++;
+            }
+        }
+
+        scene.Enqueue();
+        scene.Update(glm::mat4(1.0f), camera, time);
+        renderer.EndFrame();
+
+        if (measured)
+        {
+            cpuMs.push_back(GetThreadCpuMs() - cpuStart);
+            frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+
+            resolution = renderer.GetRenderArea().extent;
+            if (quality <= 0.0f)
+            {
+                totalSamples += EstimateSamples(camera, resolution, steps);
+            }
+        }
+    }
+    vkDeviceWaitIdle(vkc::Context::GetDevice());
+
+    BenchRun run{};
+    run.Path = path;
+    run.Size = scene.GetVolumeSize();
+    run.Steps = steps;
+    run.StepQuality = quality;
+    run.Proxy = proxy;
+    run.Resolution = resolution;
+    run.CpuMs = ComputePercentiles(cpuMs);
+    run.FrameMs = ComputePercentiles(frameMs);
+    run.GpuMs = ComputePercentiles(gpuMs);
+    run.GpuSamples = gpuMs.size();
+    run.SamplesPerFrame = totalSamples / std::max<double>(settings.MeasuredFrames, 1.0);
+
+    // GPU time is the honest denominator, wall time is used if there are no timestamps
+    double frameSeconds = (run.GpuSamples > 0 ? run.GpuMs.Avg : run.FrameMs.Avg) * 1e-3;
+    run.SamplesPerSecond = frameSeconds > 0.0 ? run.SamplesPerFrame / frameSeconds : 0.0;
+    run.FragmentSamples = fragmentSamples;
+    run.FragmentsPerFrame = fragmentSamples > 0 ? totalFragments / static_cast<double>(fragmentSamples) : 0.0;
+
+    InfoLog("%-6s size %3u steps %3u quality %.2f %-5s %4ux%-4u gpu p50 %7.3f ms, frame p50 %7.3f ms",
+            path.c_str(), run.Size, steps, quality, proxy ? "proxy" : "cube",
+            resolution.width, resolution.height, run.GpuMs.P50, run.FrameMs.P50);
+    return run;
+}
+
+/// Cube's run of the same settings as the proxy run, null if there is none
+static const BenchRun* FindCubeRun(const std::vector<BenchRun>& runs, const BenchRun& proxy)
+{
+    auto cube = std::find_if(runs.begin(), runs.end(), [&](const BenchRun& run)
+    {
+        return !run.Proxy && run.Path == proxy.Path && run.Size == proxy.Size && run.Steps == proxy.Steps
+            && run.StepQuality == proxy.StepQuality && run.Resolution.width == proxy.Resolution.width
+            && run.Resolution.height == proxy.Resolution.height;
+    });
+    return cube != runs.end() ? &*cube : nullptr;
+}
+
+/// Fractions of the cube's fragments and GPU p50 of a proxy run, zero where the cube has none
+static void CompareWithCube(const BenchRun& proxy, const BenchRun& cube, double& fragments, double& gpu)
+{
+    fragments = cube.FragmentsPerFrame > 0.0 ? proxy.FragmentsPerFrame / cube.FragmentsPerFrame : 0.0;
+    gpu = cube.GpuMs.P50 > 0.0 ? proxy.GpuMs.P50 / cube.GpuMs.P50 : 0.0;
+}
+
+/// Every proxy run against the cube's run of the same settings
+static void LogProxyComparison(const std::vector<BenchRun>& runs)
+{
+    for (const auto& proxy : runs)
+    {
+        const BenchRun* cube = proxy.Proxy ? FindCubeRun(runs, proxy) : nullptr;
+        if (!cube)
+        {
+            continue;
+        }
+
+        double fragments;
+        double gpu;
+        CompareWithCube(proxy, *cube, fragments, gpu);
+        InfoLog("%-6s size %3u steps %3u quality %.2f %4ux%-4u proxy vs cube: %.0f%% of the fragments, gpu p50 %7.3f vs %7.3f ms (%.0f%%)",
+                proxy.Path.c_str(), proxy.Size, proxy.Steps, proxy.StepQuality, proxy.Resolution.width, proxy.Resolution.height,
+                fragments * 100.0, proxy.GpuMs.P50, cube->GpuMs.P50, gpu * 100.0);
+    }
+}
+
+/// Quotes and backslashes of driver and command line strings would break the JSON
+static void WriteEscaped(std::ostream& out, const char* str)
+{
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+        {
+            out << '\\';
+        }
+        out << *str;
+    }
+}
+
+static void WritePercentiles(std::ostream& out, const char* name, const Percentiles& p)
+{
+    out << "\"" << name << "\": {"
+        << "\"min\": " << p.Min << ", \"p50\": " << p.P50 << ", \"p95\": " << p.P95
+        << ", \"p99\": " << p.P99 << ", \"max\": " << p.Max << ", \"avg\": " << p.Avg << "}";
+}
+
+static void WriteReport(std::ostream& out, const BenchSettings& settings, const std::vector<BenchRun>& runs)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(vkc::Context::GetPhysicalDevice(), &properties);
+
+    out << "{\n";
+    out << "  \"device\": \"";
+    WriteEscaped(out, properties.deviceName);
+    out << "\",\n";
+    out << "  \"warmup_frames\": " << settings.WarmupFrames << ",\n";
+    out << "  \"measured_frames\": " << settings.MeasuredFrames << ",\n";
+    out << "  \"peak_rss_mb\": " << GetPeakMemoryMb() << ",\n";
+    out << "  \"runs\": [\n";
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        const auto& run = runs[i];
+        out << "    {\"path\": \"";
+        WriteEscaped(out, run.Path.c_str());
+        out << "\", \"volume_size\": " << run.Size
+            << ", \"steps\": " << run.Steps << ", \"step_quality\": " << run.StepQuality
+            << ", \"proxy\": " << (run.Proxy ? "true" : "false")
+            << ", \"width\": " << run.Resolution.width << ", \"height\": " << run.Resolution.height << ",\n     ";
+        WritePercentiles(out, "cpu_ms", run.CpuMs);
+        out << ",\n     ";
+        WritePercentiles(out, "frame_ms", run.FrameMs);
+        out << ",\n     ";
+        WritePercentiles(out, "gpu_ms", run.GpuMs);
+        out << ",\n     \"gpu_samples\": " << run.GpuSamples;
+        if (run.FragmentSamples > 0)
+        {
+            out << ", \"fragments_per_frame\": " << run.FragmentsPerFrame;
+        }
+        else
+        {
+            out << ", \"fragments_per_frame\": null";
+        }
+        const BenchRun* cube = run.Proxy ? FindCubeRun(runs, run) : nullptr;
+        if (cube)
+        {
+            double fragments;
+            double gpu;
+            CompareWithCube(run, *cube, fragments, gpu);
+            out << ", \"cube_fragments_fraction\": " << fragments << ", \"cube_gpu_p50_fraction\": " << gpu;
+        }
+        if (run.StepQuality > 0.0f)
+        {
+            out << ", \"samples_per_frame\": null, \"samples_per_sec\": null}";
+        }
+        else
+        {
+            out << ", \"samples_per_frame\": " << run.SamplesPerFrame
+                << ", \"samples_per_sec\": " << run.SamplesPerSecond << "}";
+        }
+        out << (i + 1 < runs.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static int Run(int argc, char** argv)
+{
+    BenchSettings settings = ParseArguments(argc, argv);
+
+    vkc::Renderer renderer;
+    renderer.Init({
+        .Mode = vkc::ContextMode::Headless,
+        .FramesInFlight = 2,
+        .TargetExtent = settings.Extent
+    });
+
+    std::vector<BenchRun> runs;
+    {
+        VolumeScene scene(renderer, settings.Sizes.front());
+        // Bakes land within the warmup instead of a measured frame
+        scene.SetDensityBaking(DensityBaking::Blocking);
+        for (uint32_t size : settings.Sizes)
+        {
+            scene.LoadVolume(size);
+            for (const auto& path : settings.Paths)
+            {
+                for (uint32_t steps : settings.Steps)
+                {
+                    for (float scale : settings.Scales)
+                    {
+                        for (float quality : settings.Qualities)
+                        {
+                            for (bool proxy : settings.Proxies)
+                            {
+                                // Fixed steps always draw the cube
+                                if (proxy && quality <= 0.0f)
+                                {
+                                    continue;
+                                }
+                                runs.push_back(RunBench(renderer, scene, settings, path, steps, scale, quality, proxy));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        LogProxyComparison(runs);
+
+        std::ofstream file(settings.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+        {
+            ErrorNoThrow("Failed to open %s for writing.", settings.OutputPath.c_str());
+        }
+        else
+        {
+            WriteReport(file, settings, runs);
+        }
+        WriteReport(std::cout, settings, runs);
+
+        vkDeviceWaitIdle(vkc::Context::GetDevice());
+    }
+    renderer.Shutdown();
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    PROFILE_THREAD_NAME("Main");
+
+    LogsInit();
+    int result = 1;
+    try
+    {
+        result = Run(argc, argv);
+    }
+    catch (const Exception&)
+    {
+        // Already logged by Error
+    }
+    catch (const std::exception& exception)
+    {
+        ErrorNoThrow("Unhandled exception: %s", exception.what());
+    }
+    Log::Stop();
+
+    return result;
+}
@@ -0,0 +1,546 @@
+/*
+ * VolumeRef: CPU reference renders of the volume scene, and image diffs
+ * against the GPU, to catch shader regressions on machines with or without one.
+ *
+ * Usage:
+ *      VolumeRef render  [scene options] [--scalar] [--threads 0] [--out cpu.png]
+ *      VolumeRef gpu     [scene options] [--frames 1] [--out gpu.png]
+ *      VolumeRef diff    a.png b.png [--tolerance 3] [--max-bad 0.002] [--out diff.png]
+ *      VolumeRef compare [scene options] [--tolerance 3] [--max-bad 0.002] [--out ref]
+ *      VolumeRef error   [scene options] [--ref-steps 4096] [--threads 0] [--out error]
+ *      VolumeRef occlusion [scene options] [--threads 0] [--out occlusion]
+ *
+ * Scene options:
+ *      [--size 128] [--steps 128] [--quality 1] [--extent 640x360] [--time 0] [--phi 0] [--theta 0]
+ *      [--camera 3,3,3] [--occluders] [--proxy] [--no-bake]
+ *
+ * diff and compare exit with 1 if more than max-bad fraction of pixels
+ * differ by more than tolerance in any channel.
+ * error renders fixed and adaptive stepping on the CPU, and reports their samples per ray
+ * and error against a dense fixed step render of ref-steps.
+ * camera is the eye position, it still looks at the origin. Inside of the cube or close to it
+ * the GPU marches a full-screen triangle, see NeedsFullscreenMarch.
+ * occluders adds VolumeScene::GetMixedOccluders to the scene, rays end at them.
+ * occlusion renders the scene on the CPU with and without them, and reports the samples they save.
+ * proxy draws the GPU image with the occupied bricks instead of the whole cube, see VolumeScene::SetBrickProxy.
+ * Rays restart their adaptive steps in every brick and skip empty ones, so it's off by default.
+ * GPU images bake the static media channels from the first frame on, as the scene does by default,
+ * see DensityBake.h. no-bake fetches every channel instead. compare reports the error of the baked
+ * image against the unbaked one as well.
+ */
+
+#include "Etna/Core/Vulkan/VulkanContext.h"
+#include "Etna/Core/Vulkan/VulkanRenderer.h"
+
+#include "Etna/Core/Utils.h"
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/PngWriter.h"
+#include "Etna/Reference/CpuRaymarcher.h"
+#include "Etna/Scene/VolumeScene.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct RefSettings
+{
+    std::string Mode;
+    std::vector<std::string> Inputs;
+
+    uint32_t Size = 128;
+    uint32_t Steps = 128;
+    float Quality = VolumeScene::DefaultStepQuality;
+    uint32_t ReferenceSteps = 4096;
+    VkExtent2D Extent = {640, 360};
+    float Time = 0.0f;
+    float Phi = 0.0f;
+    float Theta = 0.0f;
+    VolumeCamera Camera;
+
+    bool Occluders = false;
+    bool Proxy = false;
+    bool Bake = true;
+
+    bool Scalar = false;
+    uint32_t Threads = 0;
+    uint32_t GpuFrames = 1;
+
+    uint32_t Tolerance = 3;
+    double MaxBadFraction = 0.002;
+    std::string OutputPath;
+};
+
+struct Image
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<uint8_t> Pixels; // RGBA8
+};
+
+struct ImageError
+{
+    double Mean = 0.0;
+    uint32_t Max = 0;
+    double Psnr = 0.0; // Infinite for equal images
+};
+
+static RefSettings ParseArguments(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        Error("Mode is missing, expected one of render, gpu, diff, compare, error or occlusion.");
+    }
+
+    RefSettings settings;
+    settings.Mode = argv[1];
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0)
+        {
+            settings.Inputs.push_back(arg);
+            continue;
+        }
+        if (arg == "--scalar")
+        {
+            settings.Scalar = true;
+            continue;
+        }
+        if (arg == "--occluders")
+        {
+            settings.Occluders = true;
+            continue;
+        }
+        if (arg == "--proxy")
+        {
+            settings.Proxy = true;
+            continue;
+        }
+        if (arg == "--no-bake")
+        {
+            settings.Bake = false;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            Error("Missing value for argument %s.", arg.c_str());
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--size")
+        {
+            settings.Size = std::stoul(value);
+        }
+        else if (arg == "--steps")
+        {
+            settings.Steps = std::stoul(value);
+        }
+        else if (arg == "--quality")
+        {
+            settings.Quality = std::stof(value);
+        }
+        else if (arg == "--ref-steps")
+        {
+            settings.ReferenceSteps = std::max<uint32_t>(std::stoul(value), 1);
+        }
+        else if (arg == "--extent")
+        {
+            auto separator = value.find('x');
+            if (separator == std::string::npos)
+            {
+                Error("Extent has to look like 640x360, got %s.", value.c_str());
+            }
+            settings.Extent = {
+                static_cast<uint32_t>(std::stoul(value.substr(0, separator))),
+                static_cast<uint32_t>(std::stoul(value.substr(separator + 1)))
+            };
+        }
+        else if (arg == "--time")
+        {
+            settings.Time = std::stof(value);
+        }
+        else if (arg == "--camera")
+        {
+            float position[3];
+            if (std::sscanf(value.c_str(), "%f,%f,%f", &position[0], &position[1], &position[2]) != 3)
+            {
+                Error("Camera has to look like 3,3,3, got %s.", value.c_str());
+            }
+            settings.Camera.Position = {position[0], position[1], position[2]};
+        }
+        else if (arg == "--phi")
+        {
+            settings.Phi = std::stof(value);
+        }
+        else if (arg == "--theta")
+        {
+            settings.Theta = std::stof(value);
+        }
+        else if (arg == "--threads")
+        {
+            settings.Threads = std::stoul(value);
+        }
+        else if (arg == "--frames")
+        {
+            settings.GpuFrames = std::max<uint32_t>(std::stoul(value), 1);
+        }
+        else if (arg == "--tolerance")
+        {
+            settings.Tolerance = std::stoul(value);
+        }
+        else if (arg == "--max-bad")
+        {
+            settings.MaxBadFraction = std::stod(value);
+        }
+        else if (arg == "--out")
+        {
+            settings.OutputPath = value;
+        }
+        else
+        {
+            Error("Unknown argument %s.", arg.c_str());
+        }
+    }
+    return settings;
+}
+
+static Image RenderCpu(const RefSettings& settings, CpuRaymarchStats* statsOut = nullptr)
+{
+    std::vector<unsigned char> volume;
+    GenerateNoiseVolume(settings.Size, volume);
+
+    float aspect = static_cast<float>(settings.Extent.width) / static_cast<float>(settings.Extent.height);
+    ObjectShaderData osd{};
+    GlobalShaderData gsd{};
+    VolumeScene::BuildShaderData(VolumeScene::GetModel(settings.Phi, settings.Theta), settings.Camera,
+                                 settings.Time, settings.Steps, settings.Quality, aspect, osd, gsd);
+
+    CpuRaymarcher raymarcher(settings.Threads);
+    if (settings.Occluders)
+    {
+        raymarcher.SetOccluders(VolumeScene::GetMixedOccluders());
+    }
+    Image image{settings.Extent.width, settings.Extent.height};
+    CpuRaymarchStats stats = raymarcher.Render(osd, gsd, volume.data(), settings.Size,
+                                               image.Width, image.Height, image.Pixels,
+                                               settings.Scalar ? CpuRaymarchPath::Scalar : CpuRaymarchPath::Auto);
+
+    ReportLog("CPU %s on %u threads: %ux%u in %.3f ms, %.2f Mrays/s, %.2f Msamples/s",
+              stats.Path == CpuRaymarchPath::Avx2 ? "avx2" : "scalar", raymarcher.GetThreadCount(),
+              image.Width, image.Height, stats.Seconds * 1e3,
+              stats.GetRaysPerSecond() * 1e-6, stats.GetSamplesPerSecond() * 1e-6);
+    if (statsOut)
+    {
+        *statsOut = stats;
+    }
+    return image;
+}
+
+static Image RenderGpu(const RefSettings& settings)
+{
+    vkc::Renderer renderer;
+    renderer.Init({
+        .Mode = vkc::ContextMode::Headless,
+        .FramesInFlight = 2,
+        .TargetExtent = settings.Extent
+    });
+
+    // Reference has no governor, so the image is always full size
+    renderer.GetQualityGovernor().Pin(1.0f, settings.Steps);
+
+    Image image;
+    {
+        VolumeScene scene(renderer, settings.Size);
+        scene.SetStepQuality(settings.Quality);
+        scene.SetDensityBaking(settings.Bake ? DensityBaking::Blocking : DensityBaking::Disabled);
+        scene.SetBrickProxy(settings.Proxy);
+        if (settings.Occluders)
+        {
+            scene.SetOccluders(VolumeScene::GetMixedOccluders());
+        }
+        glm::mat4 model = VolumeScene::GetModel(settings.Phi, settings.Theta);
+
+        for (uint32_t i = 0; i < settings.GpuFrames; i++)
+        {
+            renderer.BeginFrame();
+            scene.Enqueue();
+            scene.Update(model, settings.Camera, settings.Time);
+            renderer.EndFrame();
+        }
+        if (settings.Bake)
+        {
+            InfoLog("GPU marched with media channels 0x%x baked", scene.GetBakedChannels());
+        }
+
+        VkExtent2D extent{};
+        renderer.ReadbackLastFrame(image.Pixels, extent);
+        image.Width = extent.width;
+        image.Height = extent.height;
+
+        vkDeviceWaitIdle(vkc::Context::GetDevice());
+    }
+    renderer.Shutdown();
+
+    if (image.Width != settings.Extent.width || image.Height != settings.Extent.height)
+    {
+        Warning("GPU rendered %ux%u instead of %ux%u.", image.Width, image.Height,
+                settings.Extent.width, settings.Extent.height);
+    }
+    return image;
+}
+
+static Image ReadImage(const std::string& path)
+{
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        Error("Failed to load image %s.", path.c_str());
+    }
+
+    Image image{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    image.Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+    return image;
+}
+
+static void SaveImage(const std::string& path, const Image& image)
+{
+    if (WritePng(path, image.Width, image.Height, 4, image.Pixels.data()))
+    {
+        InfoLog("Saved %s", path.c_str());
+    }
+}
+
+/// Returns true if images match within the tolerance
+static bool DiffImages(const Image& a, const Image& b, const RefSettings& settings, const std::string& diffPath)
+{
+    if (a.Width != b.Width || a.Height != b.Height)
+    {
+        ReportLog("Diff FAILED: images differ in size, %ux%u and %ux%u.", a.Width, a.Height, b.Width, b.Height);
+        return false;
+    }
+
+    // Bad pixels are red, the rest shows the difference amplified
+    Image diff{a.Width, a.Height};
+    diff.Pixels.resize(a.Pixels.size());
+
+    size_t pixelCount = static_cast<size_t>(a.Width) * a.Height;
+    size_t badPixels = 0;
+    uint32_t maxDifference = 0;
+    double totalDifference = 0.0;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        uint32_t difference = 0;
+        for (size_t channel = 0; channel < 3; channel++)
+        {
+            int delta = std::abs(static_cast<int>(a.Pixels[i * 4 + channel]) - static_cast<int>(b.Pixels[i * 4 + channel]));
+            difference = std::max(difference, static_cast<uint32_t>(delta));
+        }
+        maxDifference = std::max(maxDifference, difference);
+        totalDifference += difference;
+
+        bool bad = difference > settings.Tolerance;
+        badPixels += bad ? 1 : 0;
+
+        auto amplified = static_cast<uint8_t>(std::min(difference * 16u, 255u));
+        diff.Pixels[i * 4 + 0] = bad ? 255 : amplified;
+        diff.Pixels[i * 4 + 1] = bad ? 0 : amplified;
+        diff.Pixels[i * 4 + 2] = bad ? 0 : amplified;
+        diff.Pixels[i * 4 + 3] = 255;
+    }
+
+    double badFraction = pixelCount > 0 ? static_cast<double>(badPixels) / static_cast<double>(pixelCount) : 0.0;
+    bool passed = badFraction <= settings.MaxBadFraction;
+    ReportLog("Diff %s: max %u, mean %.4f, %zu pixels over tolerance %u (%.4f%%, allowed %.4f%%)",
+              passed ? "passed" : "FAILED", maxDifference, pixelCount > 0 ? totalDifference / static_cast<double>(pixelCount) : 0.0,
+              badPixels, settings.Tolerance, badFraction * 100.0, settings.MaxBadFraction * 100.0);
+
+    if (!diffPath.empty())
+    {
+        SaveImage(diffPath, diff);
+    }
+    return passed;
+}
+
+static ImageError MeasureError(const Image& image, const Image& reference)
+{
+    ImageError error{};
+    size_t pixelCount = static_cast<size_t>(image.Width) * image.Height;
+    if (pixelCount == 0)
+    {
+        return error;
+    }
+
+    double squared = 0.0;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        // Grayscale, every channel holds the same value
+        int delta = std::abs(static_cast<int>(image.Pixels[i * 4]) - static_cast<int>(reference.Pixels[i * 4]));
+        error.Max = std::max(error.Max, static_cast<uint32_t>(delta));
+        error.Mean += delta;
+        squared += static_cast<double>(delta) * delta;
+    }
+    error.Mean /= static_cast<double>(pixelCount);
+
+    double mse = squared / static_cast<double>(pixelCount);
+    error.Psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+    return error;
+}
+
+/// Baked GPU image against the GPU marching every channel, baking is lossy
+static void ReportBakeError(const RefSettings& settings, const Image& baked)
+{
+    RefSettings unbaked = settings;
+    unbaked.Bake = false;
+    Image image = RenderGpu(unbaked);
+
+    ImageError error = MeasureError(baked, image);
+    ReportLog("Baked against unbaked march: error mean %.4f max %u psnr %.2f dB", error.Mean, error.Max, error.Psnr);
+}
+
+/// Fixed and adaptive stepping against a dense reference, all on the CPU
+static void ReportStepError(const RefSettings& settings)
+{
+    std::string prefix = settings.OutputPath.empty() ? "error" : settings.OutputPath;
+
+    RefSettings reference = settings;
+    reference.Steps = settings.ReferenceSteps;
+    reference.Quality = 0.0f;
+    Image dense = RenderCpu(reference);
+    SaveImage(prefix + "_reference.png", dense);
+
+    RefSettings fixed = settings;
+    fixed.Quality = 0.0f;
+    RefSettings adaptive = settings;
+    adaptive.Quality = settings.Quality > 0.0f ? settings.Quality : VolumeScene::DefaultStepQuality;
+
+    for (const RefSettings* run : {&fixed, &adaptive})
+    {
+        CpuRaymarchStats stats{};
+        Image image = RenderCpu(*run, &stats);
+        ImageError error = MeasureError(image, dense);
+
+        const char* name = run->Quality > 0.0f ? "adaptive" : "fixed";
+        ReportLog("%-8s steps %u quality %.2f: %.2f samples per ray, %.3f ms, error mean %.4f max %u psnr %.2f dB",
+                  name, run->Steps, run->Quality,
+                  stats.Rays > 0 ? static_cast<double>(stats.Samples) / static_cast<double>(stats.Rays) : 0.0,
+                  stats.Seconds * 1e3, error.Mean, error.Max, error.Psnr);
+        SaveImage(prefix + "_" + name + ".png", image);
+    }
+}
+
+/// Samples the mixed scene's occluders save, against the same view without them
+static void ReportOcclusion(const RefSettings& settings)
+{
+    std::string prefix = settings.OutputPath.empty() ? "occlusion" : settings.OutputPath;
+
+    RefSettings open = settings;
+    open.Occluders = false;
+    RefSettings mixed = settings;
+    mixed.Occluders = true;
+
+    CpuRaymarchStats openStats{};
+    CpuRaymarchStats mixedStats{};
+    SaveImage(prefix + "_open.png", RenderCpu(open, &openStats));
+    SaveImage(prefix + "_mixed.png", RenderCpu(mixed, &mixedStats));
+
+    uint64_t unoccluded = mixedStats.Samples + mixedStats.OccludedSamples;
+    ReportLog("Occluders: %llu samples instead of %llu, %llu saved (%.1f%%). %llu of %llu rays are hidden entirely.",
+              static_cast<unsigned long long>(mixedStats.Samples), static_cast<unsigned long long>(unoccluded),
+              static_cast<unsigned long long>(mixedStats.OccludedSamples),
+              unoccluded > 0 ? 100.0 * static_cast<double>(mixedStats.OccludedSamples) / static_cast<double>(unoccluded) : 0.0,
+              static_cast<unsigned long long>(openStats.Rays - mixedStats.Rays), static_cast<unsigned long long>(openStats.Rays));
+
+    // Fixed steps in front of the occluder don't change, so both add up.
+    // Adaptive ones take a shorter step to end at the occluder, their count is only close.
+    if (settings.Quality <= 0.0f && unoccluded != openStats.Samples)
+    {
+        Warning("Occluded samples don't add up, %llu marched without occluders.",
+                static_cast<unsigned long long>(openStats.Samples));
+    }
+}
+
+static int Run(int argc, char** argv)
+{
+    RefSettings settings = ParseArguments(argc, argv);
+
+    if (settings.Mode == "render")
+    {
+        SaveImage(settings.OutputPath.empty() ? "cpu.png" : settings.OutputPath, RenderCpu(settings));
+    }
+    else if (settings.Mode == "gpu")
+    {
+        SaveImage(settings.OutputPath.empty() ? "gpu.png" : settings.OutputPath, RenderGpu(settings));
+    }
+    else if (settings.Mode == "diff")
+    {
+        if (settings.Inputs.size() != 2)
+        {
+            Error("diff takes exactly two images.");
+        }
+        bool passed = DiffImages(ReadImage(settings.Inputs[0]), ReadImage(settings.Inputs[1]), settings, settings.OutputPath);
+        return passed ? 0 : 1;
+    }
+    else if (settings.Mode == "compare")
+    {
+        std::string prefix = settings.OutputPath.empty() ? "ref" : settings.OutputPath;
+
+        Image gpu = RenderGpu(settings);
+        // CPU follows whatever the GPU actually rendered
+        settings.Extent = {gpu.Width, gpu.Height};
+        Image cpu = RenderCpu(settings);
+
+        SaveImage(prefix + "_gpu.png", gpu);
+        SaveImage(prefix + "_cpu.png", cpu);
+        if (settings.Bake)
+        {
+            ReportBakeError(settings, gpu);
+        }
+        return DiffImages(cpu, gpu, settings, prefix + "_diff.png") ? 0 : 1;
+    }
+    else if (settings.Mode == "error")
+    {
+        ReportStepError(settings);
+    }
+    else if (settings.Mode == "occlusion")
+    {
+        ReportOcclusion(settings);
+    }
+    else
+    {
+        Error("Unknown mode %s, expected one of render, gpu, diff, compare, error or occlusion.", settings.Mode.c_str());
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    PROFILE_THREAD_NAME("Main");
+
+    LogsInit();
+    int result = 1;
+    try
+    {
+        result = Run(argc, argv);
+    }
+    catch (const Exception&)
+    {
+        // Already logged by Error
+    }
+    catch (const std::exception& exception)
+    {
+        ErrorNoThrow("Unhandled exception: %s", exception.what());
+    }
+    Log::Stop();
+
+    return result;
+}
@@ -0,0 +1,530 @@
+#include "BrickStore.h"
+#include "Profiler.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+struct BrickCacheEntry
+{
+    uint64_t Key;
+    std::unique_ptr<uint8_t[]> Texels;
+    // Handles holding the brick, pinned bricks are never evicted
+    std::atomic<uint32_t> Pins = 0;
+    // Being read by a thread otherwise
+    bool Ready = false;
+    // Read ahead and not requested yet
+    bool Prefetched = false;
+    std::list<BrickCacheEntry*>::iterator Position;
+};
+
+struct MappedFile
+{
+    const uint8_t* Data = nullptr;
+    uint64_t Size = 0;
+
+#if defined(_WIN32)
+    HANDLE File = INVALID_HANDLE_VALUE;
+    HANDLE Mapping = nullptr;
+
+    explicit MappedFile(const std::string& path)
+    {
+        File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_RANDOM_ACCESS, nullptr);
+        LARGE_INTEGER size{};
+        if (File == INVALID_HANDLE_VALUE || !GetFileSizeEx(File, &size))
+        {
+            Close();
+            Error("Failed to open %s.", path.c_str());
+        }
+        Size = static_cast<uint64_t>(size.QuadPart);
+
+        Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (Mapping)
+        {
+            Data = static_cast<const uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!Data)
+        {
+            Close();
+            Error("Failed to map %s.", path.c_str());
+        }
+    }
+
+    void Close()
+    {
+        if (Data)
+        {
+            UnmapViewOfFile(Data);
+        }
+        if (Mapping)
+        {
+            CloseHandle(Mapping);
+        }
+        if (File != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(File);
+        }
+    }
+#else
+    int Descriptor = -1;
+
+    explicit MappedFile(const std::string& path)
+    {
+        Descriptor = open(path.c_str(), O_RDONLY);
+        struct stat status{};
+        if (Descriptor < 0 || fstat(Descriptor, &status) != 0)
+        {
+            Close();
+            Error("Failed to open %s.", path.c_str());
+        }
+        Size = static_cast<uint64_t>(status.st_size);
+
+        void* mapped = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+        if (mapped == MAP_FAILED)
+        {
+            Close();
+            Error("Failed to map %s.", path.c_str());
+        }
+        Data = static_cast<const uint8_t*>(mapped);
+
+        // Bricks are scattered over the file, read-ahead of the kernel would only waste the cache
+        madvise(mapped, Size, MADV_RANDOM);
+    }
+
+    void Close()
+    {
+        if (Data)
+        {
+            munmap(const_cast<uint8_t*>(Data), Size);
+        }
+        if (Descriptor >= 0)
+        {
+            close(Descriptor);
+        }
+    }
+#endif
+
+    ~MappedFile()
+    {
+        Close();
+    }
+};
+
+BrickHandle::BrickHandle(BrickHandle&& other) noexcept
+    : Entry(std::exchange(other.Entry, nullptr))
+{
+}
+
+BrickHandle& BrickHandle::operator=(BrickHandle&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        Entry = std::exchange(other.Entry, nullptr);
+    }
+    return *this;
+}
+
+const uint8_t* BrickHandle::GetData() const
+{
+    return Entry->Texels.get();
+}
+
+void BrickHandle::Release()
+{
+    if (Entry)
+    {
+        Entry->Pins.fetch_sub(1, std::memory_order_release);
+        Entry = nullptr;
+    }
+}
+
+// Level in the top 4 bits, then 20 bits per axis
+static constexpr uint32_t MaxLevels = 16;
+static constexpr uint32_t MaxGridBricks = 1u << 20;
+
+BrickStore::BrickStore(const std::string& path, const BrickStoreSettings& settings)
+    : Settings(settings), Io(settings.IoThreads)
+{
+    PROFILE_FUNCTION();
+
+    File = std::make_unique<MappedFile>(path);
+
+    BrickFileHeader header{};
+    if (File->Size < sizeof(header))
+    {
+        Error("%s is too small for a brick file.", path.c_str());
+    }
+    memcpy(&header, File->Data, sizeof(header));
+    if (memcmp(header.Signature, BrickFileHeader::Magic, sizeof(header.Signature)) != 0 ||
+        header.Version != BrickFileHeader::CurrentVersion)
+    {
+        Error("%s is not a brick file of version %u.", path.c_str(), BrickFileHeader::CurrentVersion);
+    }
+    if (header.TexelSize != TexelSize || header.BrickSize == 0 ||
+        header.LevelCount == 0 || header.LevelCount > MaxLevels)
+    {
+        Error("%s has an unsupported layout.", path.c_str());
+    }
+
+    Extent = {header.Extent[0], header.Extent[1], header.Extent[2]};
+    BrickSize = header.BrickSize;
+    Border = header.Border;
+    PaddedSize = BrickSize + 2 * Border;
+    BrickBytes = static_cast<uint64_t>(PaddedSize) * PaddedSize * PaddedSize * TexelSize;
+
+    uint64_t brickCount = 0;
+    for (uint32_t level = 0; level < header.LevelCount; level++)
+    {
+        glm::uvec3 extent = GetLevelExtent(Extent, level);
+        glm::uvec3 grid = (extent + BrickSize - 1u) / BrickSize;
+        if (glm::any(glm::greaterThanEqual(grid, glm::uvec3(MaxGridBricks))))
+        {
+            Error("%s has too many bricks per side.", path.c_str());
+        }
+        Levels.push_back({extent, grid, brickCount});
+        brickCount += static_cast<uint64_t>(grid.x) * grid.y * grid.z;
+    }
+
+    if (File->Size < BrickFileHeader::DataOffset + brickCount * BrickBytes)
+    {
+        Error("%s is truncated.", path.c_str());
+    }
+
+    InfoLog("Brick store %s: %ux%ux%u, %u levels, %llu bricks of %u voxels.",
+            path.c_str(), Extent.x, Extent.y, Extent.z, header.LevelCount,
+            static_cast<unsigned long long>(brickCount), BrickSize);
+}
+
+BrickStore::~BrickStore()
+{
+    // Queued prefetches are drained by the pool without reading anything
+    Stopping = true;
+}
+
+void BrickStore::Write(const std::string& path, VolumeSource& source, uint32_t brickSize, uint32_t border)
+{
+    PROFILE_FUNCTION();
+
+    if (brickSize == 0)
+    {
+        Error("Brick size must be positive.");
+    }
+
+    glm::uvec3 extent = source.GetExtent();
+    uint32_t levelCount = 1;
+    while (glm::any(glm::greaterThan(GetLevelExtent(extent, levelCount - 1), glm::uvec3(1))))
+    {
+        levelCount++;
+    }
+    if (levelCount > MaxLevels)
+    {
+        Error("Volume needs %u levels, brick files hold %u at most.", levelCount, MaxLevels);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        Error("Failed to create %s.", path.c_str());
+    }
+
+    BrickFileHeader header{};
+    memcpy(header.Signature, BrickFileHeader::Magic, sizeof(header.Signature));
+    header.Version = BrickFileHeader::CurrentVersion;
+    header.BrickSize = brickSize;
+    header.Border = border;
+    header.LevelCount = levelCount;
+    header.Extent[0] = extent.x;
+    header.Extent[1] = extent.y;
+    header.Extent[2] = extent.z;
+    header.TexelSize = TexelSize;
+
+    std::vector<uint8_t> padding(BrickFileHeader::DataOffset, 0);
+    memcpy(padding.data(), &header, sizeof(header));
+    bool written = fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+
+    uint32_t paddedSize = brickSize + 2 * border;
+    std::vector<uint8_t> brick(static_cast<size_t>(paddedSize) * paddedSize * paddedSize * TexelSize);
+    for (uint32_t level = 0; level < levelCount && written; level++)
+    {
+        glm::uvec3 grid = (GetLevelExtent(extent, level) + brickSize - 1u) / brickSize;
+        for (uint32_t z = 0; z < grid.z; z++)
+        {
+            for (uint32_t y = 0; y < grid.y; y++)
+            {
+                for (uint32_t x = 0; x < grid.x && written; x++)
+                {
+                    glm::ivec3 origin = glm::ivec3(glm::uvec3(x, y, z) * brickSize) - static_cast<int32_t>(border);
+                    source.Read(level, origin, glm::uvec3(paddedSize), brick.data());
+                    written = fwrite(brick.data(), 1, brick.size(), file) == brick.size();
+                }
+            }
+        }
+    }
+
+    if (fclose(file) != 0 || !written)
+    {
+        Error("Failed to write %s.", path.c_str());
+    }
+}
+
+uint64_t BrickStore::GetKey(uint32_t level, glm::uvec3 brick) const
+{
+    return (static_cast<uint64_t>(level) << 60) | (static_cast<uint64_t>(brick.z) << 40) |
+           (static_cast<uint64_t>(brick.y) << 20) | brick.x;
+}
+
+std::unique_ptr<uint8_t[]> BrickStore::ReadBrick(uint64_t key)
+{
+    PROFILE_FUNCTION();
+
+    auto level = static_cast<uint32_t>(key >> 60);
+    glm::uvec3 brick(key & (MaxGridBricks - 1), (key >> 20) & (MaxGridBricks - 1), (key >> 40) & (MaxGridBricks - 1));
+    const Level& info = Levels[level];
+    uint64_t index = info.FirstBrick + brick.x + static_cast<uint64_t>(info.Grid.x) * (brick.y + static_cast<uint64_t>(info.Grid.y) * brick.z);
+
+    // Page faults of the mapping happen here, on whichever thread reads the brick
+    std::unique_ptr<uint8_t[]> texels(new uint8_t[BrickBytes]);
+    memcpy(texels.get(), File->Data + BrickFileHeader::DataOffset + index * BrickBytes, BrickBytes);
+    FrameBytesRead.fetch_add(BrickBytes, std::memory_order_relaxed);
+    return texels;
+}
+
+void BrickStore::Complete(BrickCacheEntry* entry, std::unique_ptr<uint8_t[]> texels)
+{
+    {
+        std::lock_guard lock(Mutex);
+        entry->Texels = std::move(texels);
+        entry->Ready = true;
+    }
+    Loaded.notify_all();
+}
+
+void BrickStore::Touch(BrickCacheEntry* entry)
+{
+    Recent.splice(Recent.begin(), Recent, entry->Position);
+}
+
+void BrickStore::Evict()
+{
+    auto position = Recent.end();
+    while (CachedBytes > Settings.CacheBytes && position != Recent.begin())
+    {
+        --position;
+        BrickCacheEntry* entry = *position;
+        if (!entry->Ready || entry->Pins.load(std::memory_order_acquire) != 0)
+        {
+            continue;
+        }
+
+        if (entry->Prefetched)
+        {
+            Stats.PrefetchWasted++;
+        }
+        uint64_t key = entry->Key;
+        position = Recent.erase(position);
+        CachedBytes -= BrickBytes;
+        Entries.erase(key);
+    }
+}
+
+BrickHandle BrickStore::GetBrick(uint32_t level, uint32_t x, uint32_t y, uint32_t z)
+{
+    glm::uvec3 brick(x, y, z);
+    if (level >= Levels.size() || glm::any(glm::greaterThanEqual(brick, Levels[level].Grid)))
+    {
+        Error("Brick %u %u %u of level %u is out of the volume.", x, y, z, level);
+    }
+    uint64_t key = GetKey(level, brick);
+
+    std::unique_lock lock(Mutex);
+    BrickCacheEntry* entry;
+    auto found = Entries.find(key);
+    if (found != Entries.end())
+    {
+        entry = found->second.get();
+        entry->Pins.fetch_add(1, std::memory_order_relaxed);
+        if (entry->Prefetched)
+        {
+            entry->Prefetched = false;
+            Stats.PrefetchUsed++;
+        }
+
+        // Prefetch in flight is waited for rather than read twice
+        if (entry->Ready)
+        {
+            FrameHits++;
+        }
+        else
+        {
+            FrameMisses++;
+            Loaded.wait(lock, [entry]() { return entry->Ready; });
+        }
+        Touch(entry);
+    }
+    else
+    {
+        FrameMisses++;
+        auto owned = std::make_unique<BrickCacheEntry>();
+        owned->Key = key;
+        owned->Pins = 1;
+        entry = owned.get();
+        entry->Position = Recent.insert(Recent.begin(), entry);
+        Entries.emplace(key, std::move(owned));
+        CachedBytes += BrickBytes;
+
+        lock.unlock();
+        Complete(entry, ReadBrick(key));
+        lock.lock();
+        Evict();
+    }
+
+    PrefetchAhead(level, brick);
+    return BrickHandle(entry);
+}
+
+void BrickStore::PrefetchAhead(uint32_t level, glm::uvec3 brick)
+{
+    if (!HasView || Settings.PrefetchDepth == 0)
+    {
+        return;
+    }
+
+    // Direction in voxels of the level, a step of its length crosses one brick
+    const Level& info = Levels[level];
+    glm::vec3 direction = View.Direction * glm::vec3(info.Extent);
+    float length = glm::length(direction);
+    if (length <= 0.0f)
+    {
+        return;
+    }
+    direction /= length;
+
+    glm::vec3 center = glm::vec3(brick) + 0.5f;
+    for (uint32_t step = 1; step <= Settings.PrefetchDepth; step++)
+    {
+        glm::vec3 ahead = center + direction * static_cast<float>(step);
+        if (glm::any(glm::lessThan(ahead, glm::vec3(0.0f))) ||
+            glm::any(glm::greaterThanEqual(ahead, glm::vec3(info.Grid))))
+        {
+            return;
+        }
+
+        uint64_t key = GetKey(level, glm::uvec3(ahead));
+        if (Entries.count(key) != 0)
+        {
+            continue;
+        }
+        if (PrefetchesInFlight >= Settings.MaxPrefetchesInFlight)
+        {
+            return;
+        }
+
+        auto owned = std::make_unique<BrickCacheEntry>();
+        owned->Key = key;
+        owned->Prefetched = true;
+        BrickCacheEntry* entry = owned.get();
+        entry->Position = Recent.insert(Recent.begin(), entry);
+        Entries.emplace(key, std::move(owned));
+        CachedBytes += BrickBytes;
+        PrefetchesInFlight++;
+        Stats.Prefetched++;
+
+        Io.Submit([this, entry]()
+        {
+            PROFILE_SCOPE("PrefetchBrick");
+            Complete(entry, Stopping ? std::unique_ptr<uint8_t[]>() : ReadBrick(entry->Key));
+
+            std::lock_guard lock(Mutex);
+            PrefetchesInFlight--;
+            Evict();
+        });
+    }
+}
+
+void BrickStore::Read(uint32_t lod, glm::ivec3 origin, glm::uvec3 size, uint8_t* texels)
+{
+    PROFILE_FUNCTION();
+
+    uint32_t level = std::min(lod, static_cast<uint32_t>(Levels.size()) - 1);
+    const Level& info = Levels[level];
+
+    // Virtual volume with the same brick size asks for exactly the stored bricks
+    glm::ivec3 start = origin + static_cast<int32_t>(Border);
+    if (size == glm::uvec3(PaddedSize) && glm::all(glm::greaterThanEqual(start, glm::ivec3(0))))
+    {
+        glm::uvec3 brick = glm::uvec3(start) / BrickSize;
+        if (brick * BrickSize == glm::uvec3(start) && glm::all(glm::lessThan(brick, info.Grid)))
+        {
+            BrickHandle handle = GetBrick(level, brick.x, brick.y, brick.z);
+            memcpy(texels, handle.GetData(), BrickBytes);
+            return;
+        }
+    }
+
+    // Any other box is clamped into the level and gathered from the interiors of the bricks
+    glm::ivec3 last = glm::ivec3(info.Extent) - 1;
+    BrickHandle handle;
+    uint64_t handleKey = ~0ull;
+    for (uint32_t z = 0; z < size.z; z++)
+    {
+        for (uint32_t y = 0; y < size.y; y++)
+        {
+            for (uint32_t x = 0; x < size.x; x++)
+            {
+                glm::uvec3 voxel(glm::clamp(origin + glm::ivec3(x, y, z), glm::ivec3(0), last));
+                glm::uvec3 brick = voxel / BrickSize;
+                uint64_t key = GetKey(level, brick);
+                if (key != handleKey)
+                {
+                    handle = GetBrick(level, brick.x, brick.y, brick.z);
+                    handleKey = key;
+                }
+
+                glm::uvec3 local = voxel - brick * BrickSize + Border;
+                size_t index = ((static_cast<size_t>(local.z) * PaddedSize + local.y) * PaddedSize + local.x) * TexelSize;
+                memcpy(texels, handle.GetData() + index, TexelSize);
+                texels += TexelSize;
+            }
+        }
+    }
+}
+
+void BrickStore::BeginFrame(const VolumeView& view)
+{
+    std::lock_guard lock(Mutex);
+    View = view;
+    HasView = true;
+
+    uint32_t requests = FrameHits + FrameMisses;
+    Stats.Hits = FrameHits;
+    Stats.Misses = FrameMisses;
+    Stats.HitRate = requests > 0 ? static_cast<float>(FrameHits) / static_cast<float>(requests) : 0.0f;
+    Stats.BytesRead = FrameBytesRead.exchange(0, std::memory_order_relaxed);
+    Stats.CachedBytes = CachedBytes;
+
+    uint64_t resolved = Stats.PrefetchUsed + Stats.PrefetchWasted;
+    Stats.PrefetchAccuracy = resolved > 0 ? static_cast<float>(Stats.PrefetchUsed) / static_cast<float>(resolved) : 0.0f;
+
+    FrameHits = 0;
+    FrameMisses = 0;
+}
+
+BrickStoreStats BrickStore::GetStats() const
+{
+    std::lock_guard lock(Mutex);
+    return Stats;
+}
@@ -0,0 +1,182 @@
+/*
+ * Out-of-core volume, streamed from a bricked file mapped into memory.
+ * The file holds every level of detail as padded bricks, so a brick is one contiguous read
+ * and the host never needs the whole volume. Bricks read from the mapping are kept
+ * in an LRU cache within a byte budget. Around every requested brick the ones ahead
+ * of it along the view direction are prefetched by a pool of I/O threads.
+ *
+ * File layout: BrickFileHeader, then from BrickFileHeader::DataOffset bricks of
+ * (BrickSize + 2 * Border)^3 RGBA8 texels. Levels go one after another, from the full
+ * resolution down to a single voxel, bricks of a level are ordered x fastest, z slowest.
+ */
+
+#ifndef BRICKSTORE_H
+#define BRICKSTORE_H
+
+#include "VolumeSource.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct BrickFileHeader
+{
+    static constexpr char Magic[8] = "ETNABRK";
+    static constexpr uint32_t CurrentVersion = 1;
+    // Bricks start page aligned
+    static constexpr uint64_t DataOffset = 4096;
+
+    char Signature[8];
+    uint32_t Version;
+    uint32_t BrickSize;
+    uint32_t Border;
+    uint32_t LevelCount;
+    uint32_t Extent[3];
+    uint32_t TexelSize;
+};
+
+struct BrickStoreSettings
+{
+    // Host memory of the cached bricks, pinned ones may go over it
+    uint64_t CacheBytes = 1024ull * 1024 * 1024;
+    uint32_t IoThreads = 2;
+    // Bricks prefetched ahead of every requested one
+    uint32_t PrefetchDepth = 2;
+    // Prefetches queued or being read at most
+    uint32_t MaxPrefetchesInFlight = 64;
+};
+
+struct BrickStoreStats
+{
+    uint32_t Hits;           // Requests of the last frame served by the cache
+    uint32_t Misses;         // Requests of the last frame, which waited for a read
+    float HitRate;           // Of the last frame
+    uint64_t BytesRead;      // Read from the file during the last frame, prefetches included
+    uint64_t CachedBytes;
+    uint64_t Prefetched;     // Prefetched bricks since the store was opened
+    uint64_t PrefetchUsed;   // Of them, requested before being evicted
+    uint64_t PrefetchWasted; // Of them, evicted before any request
+    float PrefetchAccuracy;  // Used out of the resolved ones
+};
+
+class BrickStore;
+struct BrickCacheEntry;
+struct MappedFile;
+
+/// Keeps a cached brick in memory, so its texels can be copied straight into staging.
+/// Must not outlive the store.
+class BrickHandle
+{
+public:
+    BrickHandle() = default;
+    ~BrickHandle() { Release(); }
+
+    BrickHandle(BrickHandle&& other) noexcept;
+    BrickHandle& operator=(BrickHandle&& other) noexcept;
+    BrickHandle(const BrickHandle&) = delete;
+    BrickHandle& operator=(const BrickHandle&) = delete;
+
+    /// Padded brick, x fastest and z slowest
+    [[nodiscard]] const uint8_t* GetData() const;
+    [[nodiscard]] explicit operator bool() const { return Entry != nullptr; }
+
+    void Release();
+
+private:
+    friend class BrickStore;
+    explicit BrickHandle(BrickCacheEntry* entry) : Entry(entry) {}
+
+private:
+    BrickCacheEntry* Entry = nullptr;
+};
+
+class BrickStore : public VolumeSource
+{
+public:
+    /// Maps the file, throws if it isn't a brick file
+    explicit BrickStore(const std::string& path, const BrickStoreSettings& settings = {});
+    ~BrickStore() override;
+
+    BrickStore(const BrickStore&) = delete;
+    BrickStore& operator=(const BrickStore&) = delete;
+
+    /// Write every level of the source into a brick file
+    static void Write(const std::string& path, VolumeSource& source, uint32_t brickSize, uint32_t border = 1);
+
+    /// Brick of the level, read on the calling thread if it isn't cached or being prefetched
+    BrickHandle GetBrick(uint32_t level, uint32_t x, uint32_t y, uint32_t z);
+
+    [[nodiscard]] glm::uvec3 GetExtent() const override { return Extent; }
+    /// Boxes matching a padded brick are one copy, any other box is gathered texel by texel
+    void Read(uint32_t lod, glm::ivec3 origin, glm::uvec3 size, uint8_t* texels) override;
+    /// Latches the view for prefetching and the last frame's stats
+    void BeginFrame(const VolumeView& view) override;
+
+    [[nodiscard]] uint32_t GetBrickSize() const { return BrickSize; }
+    [[nodiscard]] uint32_t GetBorder() const { return Border; }
+    [[nodiscard]] uint32_t GetLevelCount() const { return static_cast<uint32_t>(Levels.size()); }
+    [[nodiscard]] BrickStoreStats GetStats() const;
+
+private:
+    struct Level
+    {
+        glm::uvec3 Extent;
+        glm::uvec3 Grid;
+        uint64_t FirstBrick;
+    };
+
+    [[nodiscard]] uint64_t GetKey(uint32_t level, glm::uvec3 brick) const;
+
+    /// Copy the brick out of the mapping
+    std::unique_ptr<uint8_t[]> ReadBrick(uint64_t key);
+    /// Mark the entry ready, wake the waiting readers
+    void Complete(BrickCacheEntry* entry, std::unique_ptr<uint8_t[]> data);
+    void Touch(BrickCacheEntry* entry);
+    /// Drop least recently used bricks until the cache fits its budget. Mutex is held.
+    void Evict();
+
+    /// Queue the bricks, which the view reaches after this one
+    void PrefetchAhead(uint32_t level, glm::uvec3 brick);
+
+private:
+    BrickStoreSettings Settings;
+
+    // Read only mapping of the whole file
+    std::unique_ptr<MappedFile> File;
+
+    glm::uvec3 Extent;
+    uint32_t BrickSize;
+    uint32_t Border;
+    uint32_t PaddedSize;
+    uint64_t BrickBytes;
+    std::vector<Level> Levels;
+
+    mutable std::mutex Mutex;
+    std::condition_variable Loaded;
+    std::unordered_map<uint64_t, std::unique_ptr<BrickCacheEntry>> Entries;
+    // Most recently used at the front
+    std::list<BrickCacheEntry*> Recent;
+    uint64_t CachedBytes = 0;
+
+    VolumeView View = {};
+    bool HasView = false;
+    uint32_t PrefetchesInFlight = 0;
+    std::atomic<bool> Stopping = false;
+
+    // Counters of the current frame, latched by BeginFrame
+    uint32_t FrameHits = 0;
+    uint32_t FrameMisses = 0;
+    std::atomic<uint64_t> FrameBytesRead = 0;
+    BrickStoreStats Stats = {};
+
+    // Last member, so it's joined before anything its tasks touch goes away
+    ThreadPool Io;
+};
+
+#endif //BRICKSTORE_H
@@ -0,0 +1,179 @@
+#include "ExrWriter.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    void PushBytes(std::vector<uint8_t>& out, const void* data, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    // EXR is little endian, so is every platform this builds on
+    template<typename T>
+    void Push(std::vector<uint8_t>& out, T value)
+    {
+        PushBytes(out, &value, sizeof(T));
+    }
+
+    void PushString(std::vector<uint8_t>& out, const char* text)
+    {
+        PushBytes(out, text, std::strlen(text) + 1);
+    }
+
+    void PushAttribute(std::vector<uint8_t>& out, const char* name, const char* type, const std::vector<uint8_t>& value)
+    {
+        PushString(out, name);
+        PushString(out, type);
+        Push<int32_t>(out, static_cast<int32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    std::vector<uint8_t> Box(int32_t xMax, int32_t yMax)
+    {
+        std::vector<uint8_t> box;
+        Push<int32_t>(box, 0);
+        Push<int32_t>(box, 0);
+        Push<int32_t>(box, xMax);
+        Push<int32_t>(box, yMax);
+        return box;
+    }
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // Inf and NaN, NaN keeps a mantissa bit
+    if (exponent == 0xFF)
+    {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+    if (halfExponent >= 0x1F)
+    {
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+
+    if (halfExponent <= 0)
+    {
+        // Denormal or zero
+        if (halfExponent < -10)
+        {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    // Carry might overflow into the exponent, which is still correct rounding
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return static_cast<uint16_t>(half);
+}
+
+bool WriteExr(const std::string& path, uint32_t width, uint32_t height, const float* pixels)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        ErrorNoThrow("Failed to open %s for writing.", path.c_str());
+        return false;
+    }
+
+    // Channels have to be sorted by name, so the order is ABGR
+    const char* channelNames[] = {"A", "B", "G", "R"};
+    const int channelSources[] = {3, 2, 1, 0};
+
+    std::vector<uint8_t> header;
+    Push<uint32_t>(header, 20000630); // Magic
+    Push<uint32_t>(header, 2);        // Version 2, single part scanline
+
+    std::vector<uint8_t> channels;
+    for (const char* name : channelNames)
+    {
+        PushString(channels, name);
+        Push<int32_t>(channels, 1);   // HALF
+        Push<uint8_t>(channels, 0);   // pLinear
+        Push<uint8_t>(channels, 0);   // Reserved
+        Push<uint8_t>(channels, 0);
+        Push<uint8_t>(channels, 0);
+        Push<int32_t>(channels, 1);   // xSampling
+        Push<int32_t>(channels, 1);   // ySampling
+    }
+    Push<uint8_t>(channels, 0);
+
+    auto xMax = static_cast<int32_t>(width) - 1;
+    auto yMax = static_cast<int32_t>(height) - 1;
+
+    std::vector<uint8_t> value;
+    PushAttribute(header, "channels", "chlist", channels);
+    PushAttribute(header, "compression", "compression", {0}); // NO_COMPRESSION
+    PushAttribute(header, "dataWindow", "box2i", Box(xMax, yMax));
+    PushAttribute(header, "displayWindow", "box2i", Box(xMax, yMax));
+    PushAttribute(header, "lineOrder", "lineOrder", {0});     // INCREASING_Y
+    value.clear();
+    Push<float>(value, 1.0f);
+    PushAttribute(header, "pixelAspectRatio", "float", value);
+    value.clear();
+    Push<float>(value, 0.0f);
+    Push<float>(value, 0.0f);
+    PushAttribute(header, "screenWindowCenter", "v2f", value);
+    value.clear();
+    Push<float>(value, 1.0f);
+    PushAttribute(header, "screenWindowWidth", "float", value);
+    Push<uint8_t>(header, 0);
+
+    // One scanline per chunk without compression
+    uint64_t lineDataSize = static_cast<uint64_t>(width) * 4 * sizeof(uint16_t);
+    uint64_t chunkSize = sizeof(int32_t) * 2 + lineDataSize;
+    uint64_t firstChunk = header.size() + static_cast<uint64_t>(height) * sizeof(uint64_t);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        Push<uint64_t>(header, firstChunk + y * chunkSize);
+    }
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+    std::vector<uint8_t> chunk;
+    chunk.reserve(chunkSize);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        chunk.clear();
+        Push<int32_t>(chunk, static_cast<int32_t>(y));
+        Push<int32_t>(chunk, static_cast<int32_t>(lineDataSize));
+
+        const float* row = pixels + static_cast<size_t>(y) * width * 4;
+        for (int source : channelSources)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                Push<uint16_t>(chunk, FloatToHalf(row[x * 4 + source]));
+            }
+        }
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    return file.good();
+}
@@ -0,0 +1,18 @@
+/*
+ * Minimal OpenEXR encoder.
+ * Scanline image of half float RGBA channels, without compression.
+ */
+
+#ifndef EXRWRITER_H
+#define EXRWRITER_H
+
+#include <cstdint>
+#include <string>
+
+/// Pixels are linear RGBA floats, rows top to bottom
+bool WriteExr(const std::string& path, uint32_t width, uint32_t height, const float* pixels);
+
+/// IEEE 754 binary16 with round to nearest even
+uint16_t FloatToHalf(float value);
+
+#endif //EXRWRITER_H
@@ -0,0 +1,160 @@
+#include "FrameSink.h"
+#include "ExrWriter.h"
+#include "PngWriter.h"
+#include "Utils.h"
+
+#include <cmath>
+#include <utility>
+
+static void ToRgba(const FrameData& frame, std::vector<uint8_t>& rgba)
+{
+    size_t size = static_cast<size_t>(frame.Width) * frame.Height * 4;
+    rgba.assign(frame.Pixels, frame.Pixels + size);
+    if (frame.Bgra)
+    {
+        for (size_t i = 0; i < size; i += 4)
+        {
+            std::swap(rgba[i], rgba[i + 2]);
+        }
+    }
+}
+
+static float SrgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+std::string GetFramePath(const std::string& prefix, uint64_t frameNumber, const char* extension)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "_%06llu.", static_cast<unsigned long long>(frameNumber));
+    return prefix + number + extension;
+}
+
+std::unique_ptr<FrameSink> CreateFrameSink(const std::string& type, const std::string& path)
+{
+    if (type == "png")
+    {
+        return std::make_unique<PngFrameSink>(path);
+    }
+    if (type == "exr")
+    {
+        return std::make_unique<ExrFrameSink>(path);
+    }
+    if (type == "raw")
+    {
+        return std::make_unique<RawFrameSink>(path);
+    }
+    Error("Unknown frame sink %s, expected png, exr or raw.", type.c_str());
+}
+
+CallbackFrameSink::CallbackFrameSink(std::function<void(const FrameData&)> callback)
+    : Callback(std::move(callback))
+{
+}
+
+void CallbackFrameSink::Consume(const FrameData& frame)
+{
+    Callback(frame);
+}
+
+PngFrameSink::PngFrameSink(std::string pathPrefix)
+    : PathPrefix(std::move(pathPrefix))
+{
+}
+
+void PngFrameSink::Consume(const FrameData& frame)
+{
+    // sRGB values are written as they are, PNG is sRGB anyway
+    const uint8_t* pixels = frame.Pixels;
+    if (frame.Bgra)
+    {
+        ToRgba(frame, Rgba);
+        pixels = Rgba.data();
+    }
+    WritePng(GetFramePath(PathPrefix, frame.FrameNumber, "png"), frame.Width, frame.Height, 4, pixels);
+}
+
+ExrFrameSink::ExrFrameSink(std::string pathPrefix)
+    : PathPrefix(std::move(pathPrefix))
+{
+}
+
+void ExrFrameSink::Consume(const FrameData& frame)
+{
+    // Decoding table, there are only 256 possible values
+    float decode[256];
+    for (int i = 0; i < 256; i++)
+    {
+        float value = static_cast<float>(i) / 255.0f;
+        decode[i] = frame.Srgb ? SrgbToLinear(value) : value;
+    }
+
+    size_t pixelCount = static_cast<size_t>(frame.Width) * frame.Height;
+    Linear.resize(pixelCount * 4);
+    int red = frame.Bgra ? 2 : 0;
+    int blue = frame.Bgra ? 0 : 2;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        const uint8_t* pixel = frame.Pixels + i * 4;
+        Linear[i * 4 + 0] = decode[pixel[red]];
+        Linear[i * 4 + 1] = decode[pixel[1]];
+        Linear[i * 4 + 2] = decode[pixel[blue]];
+        Linear[i * 4 + 3] = static_cast<float>(pixel[3]) / 255.0f; // Alpha is always linear
+    }
+
+    WriteExr(GetFramePath(PathPrefix, frame.FrameNumber, "exr"), frame.Width, frame.Height, Linear.data());
+}
+
+RawFrameSink::RawFrameSink(const std::string& path)
+{
+    if (path == "-")
+    {
+        File = stdout;
+        return;
+    }
+
+    File = fopen(path.c_str(), "wb");
+    if (!File)
+    {
+        Error("Failed to open %s for writing.", path.c_str());
+    }
+    OwnsFile = true;
+}
+
+RawFrameSink::~RawFrameSink()
+{
+    if (OwnsFile)
+    {
+        fclose(File);
+    }
+    else
+    {
+        fflush(File);
+    }
+}
+
+void RawFrameSink::Consume(const FrameData& frame)
+{
+    if (Width == 0)
+    {
+        Width = frame.Width;
+        Height = frame.Height;
+        InfoLog("Raw frame stream is %ux%u rgba", Width, Height);
+    }
+    else if (frame.Width != Width || frame.Height != Height)
+    {
+        // Stream has no headers, so a resized frame would garble everything after it
+        WarningLimited("Frame %llu is %ux%u, stream is %ux%u. Skipped.",
+                static_cast<unsigned long long>(frame.FrameNumber), frame.Width, frame.Height, Width, Height);
+        return;
+    }
+
+    const uint8_t* pixels = frame.Pixels;
+    if (frame.Bgra)
+    {
+        ToRgba(frame, Rgba);
+        pixels = Rgba.data();
+    }
+    fwrite(pixels, 4, static_cast<size_t>(frame.Width) * frame.Height, File);
+}
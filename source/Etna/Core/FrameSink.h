@@ -0,0 +1,98 @@
+/*
+ * Consumers of frames read back from the GPU.
+ * Sinks are called on the readback worker thread, one frame at a time
+ * in submission order, and never see any Vulkan.
+ */
+
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Frame, as it was rendered. Pixels are only valid during the Consume call.
+struct FrameData
+{
+    uint64_t FrameNumber;
+    uint32_t Width;
+    uint32_t Height;
+    const uint8_t* Pixels; // 4 bytes per pixel, rows are tightly packed
+
+    bool Bgra; // Channel order of the target, RGBA otherwise
+    bool Srgb; // Values are sRGB encoded
+};
+
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+    virtual void Consume(const FrameData& frame) = 0;
+};
+
+/// Calls the function with every frame
+class CallbackFrameSink : public FrameSink
+{
+public:
+    explicit CallbackFrameSink(std::function<void(const FrameData&)> callback);
+    void Consume(const FrameData& frame) override;
+
+private:
+    std::function<void(const FrameData&)> Callback;
+};
+
+/// Every frame to its own <prefix>_<frame>.png
+class PngFrameSink : public FrameSink
+{
+public:
+    explicit PngFrameSink(std::string pathPrefix);
+    void Consume(const FrameData& frame) override;
+
+private:
+    std::string PathPrefix;
+    std::vector<uint8_t> Rgba;
+};
+
+/// Every frame to its own <prefix>_<frame>.exr, linear half floats
+class ExrFrameSink : public FrameSink
+{
+public:
+    explicit ExrFrameSink(std::string pathPrefix);
+    void Consume(const FrameData& frame) override;
+
+private:
+    std::string PathPrefix;
+    std::vector<float> Linear;
+};
+
+/// All frames back to back into a single RGBA8 stream, "-" is stdout.
+/// Suits ffmpeg's rawvideo input, as long as resolution does not change.
+class RawFrameSink : public FrameSink
+{
+public:
+    explicit RawFrameSink(const std::string& path);
+    ~RawFrameSink() override;
+
+    RawFrameSink(const RawFrameSink&) = delete;
+    RawFrameSink& operator=(const RawFrameSink&) = delete;
+
+    void Consume(const FrameData& frame) override;
+
+private:
+    FILE* File = nullptr;
+    bool OwnsFile = false;
+    std::vector<uint8_t> Rgba;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+};
+
+/// Sink by name: png, exr or raw. Path is a prefix for image sequences, a file for raw streams.
+std::unique_ptr<FrameSink> CreateFrameSink(const std::string& type, const std::string& path);
+
+/// Name of the frame's file, e.g. frames/shot_000042.png
+std::string GetFramePath(const std::string& prefix, uint64_t frameNumber, const char* extension);
+
+#endif //FRAMESINK_H
@@ -0,0 +1,340 @@
+#include "Log.h"
+#include "Exception.h"
+
+#include <loguru.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Record
+    {
+        const char* File;
+        uint32_t Line;
+        uint32_t Suppressed;
+        LogLevel Level;
+        char Text[Log::MaxMessageLength];
+    };
+
+    // Bounded multi producer queue: a slot's sequence tells whose turn it is to touch it.
+    // Producers claim slots with a CAS on the tail, the writer is the only consumer.
+    struct Slot
+    {
+        std::atomic<uint64_t> Sequence;
+        Record Data;
+    };
+
+    struct Queue
+    {
+        std::vector<Slot> Slots = std::vector<Slot>(Log::QueueCapacity);
+        alignas(64) std::atomic<uint64_t> Tail = 0;
+        alignas(64) uint64_t Head = 0;
+        std::atomic<uint64_t> Dropped = 0;
+
+        Queue()
+        {
+            for (uint64_t i = 0; i < Slots.size(); i++)
+            {
+                Slots[i].Sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        Slot* Claim()
+        {
+            uint64_t position = Tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                Slot& slot = Slots[position & (Log::QueueCapacity - 1)];
+                int64_t difference = static_cast<int64_t>(slot.Sequence.load(std::memory_order_acquire))
+                                   - static_cast<int64_t>(position);
+                if (difference == 0)
+                {
+                    if (Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        return &slot;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    Dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                else
+                {
+                    position = Tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Sequence of a claimed slot is one behind its position until it's published
+        static void Publish(Slot& slot)
+        {
+            slot.Sequence.store(slot.Sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        Slot* Peek()
+        {
+            Slot& slot = Slots[Head & (Log::QueueCapacity - 1)];
+            if (slot.Sequence.load(std::memory_order_acquire) != Head + 1)
+            {
+                return nullptr;
+            }
+            return &slot;
+        }
+
+        void Release(Slot& slot)
+        {
+            slot.Sequence.store(Head + Log::QueueCapacity, std::memory_order_release);
+            Head++;
+        }
+    };
+
+    struct Writer
+    {
+        Queue Records;
+
+        std::thread Thread;
+        std::mutex Mutex;
+        // Queue has a single consumer, either the writer thread or an error written in place
+        std::mutex DrainMutex;
+        std::condition_variable Wake;
+        bool Stopping = false;
+        uint64_t ReportedDrops = 0;
+        std::atomic<FILE*> Console = stdout;
+
+        // Batches are written at this period
+        static constexpr auto Period = std::chrono::milliseconds(20);
+
+        // Whatever is logged during the static destruction is lost
+        ~Writer()
+        {
+            Stop();
+        }
+
+        void Stop()
+        {
+            if (!Thread.joinable())
+            {
+                return;
+            }
+
+            {
+                std::lock_guard lock(Mutex);
+                Stopping = true;
+            }
+            Wake.notify_one();
+            Thread.join();
+        }
+
+        void Loop()
+        {
+            while (true)
+            {
+                bool stopping;
+                {
+                    std::unique_lock lock(Mutex);
+                    Wake.wait_for(lock, Period, [this]() { return Stopping; });
+                    stopping = Stopping;
+                }
+
+                Drain();
+                if (stopping)
+                {
+                    return;
+                }
+            }
+        }
+
+        void Drain()
+        {
+            std::lock_guard lock(DrainMutex);
+            DrainLocked();
+        }
+
+        // Errors skip the queue. Whatever was queued before them is written first, so the order holds.
+        void WriteNow(const Record& record)
+        {
+            std::lock_guard lock(DrainMutex);
+            DrainLocked();
+
+            std::string console;
+            Emit(record, console);
+            WriteConsole(console);
+        }
+
+        void WriteConsole(const std::string& console)
+        {
+            FILE* file = Console.load(std::memory_order_relaxed);
+            fwrite(console.data(), 1, console.size(), file);
+            fflush(file);
+        }
+
+        static void Emit(const Record& record, std::string& console)
+        {
+            loguru::Verbosity verbosity = record.Level == LogLevel::Error ? loguru::Verbosity_ERROR
+                                        : record.Level == LogLevel::Warning ? loguru::Verbosity_WARNING
+                                        : loguru::Verbosity_INFO;
+            if (record.Suppressed > 0)
+            {
+                loguru::log(verbosity, record.File, record.Line, "%s (%u similar suppressed)",
+                            record.Text, record.Suppressed);
+            }
+            else
+            {
+                loguru::log(verbosity, record.File, record.Line, "%s", record.Text);
+            }
+
+            console += record.Text;
+            if (record.Suppressed > 0)
+            {
+                console += " (" + std::to_string(record.Suppressed) + " similar suppressed)";
+            }
+            console += '\n';
+        }
+
+        void DrainLocked()
+        {
+            std::string console;
+            while (Slot* slot = Records.Peek())
+            {
+                Emit(slot->Data, console);
+                Records.Release(*slot);
+            }
+
+            uint64_t dropped = Records.Dropped.load(std::memory_order_relaxed);
+            if (dropped != ReportedDrops)
+            {
+                loguru::log(loguru::Verbosity_WARNING, __FILE__, __LINE__,
+                            "Log queue is full, %llu messages dropped.",
+                            static_cast<unsigned long long>(dropped - ReportedDrops));
+                ReportedDrops = dropped;
+            }
+
+            if (!console.empty())
+            {
+                WriteConsole(console);
+            }
+        }
+    };
+
+    Writer& GetWriter()
+    {
+        static Writer writer;
+        return writer;
+    }
+
+    int64_t CurrentSecond()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Push(LogLevel level, const char* file, uint32_t line, uint32_t suppressed, const char* format, va_list args,
+              bool inPlace = false)
+    {
+        auto& writer = GetWriter();
+
+        // Errors usually come right before a throw or an exit, so they are written before returning
+        // and never dropped. So are reports, they are what the user ran the tool for.
+        if (level == LogLevel::Error || inPlace)
+        {
+            Record record{file, line, suppressed, level, {}};
+            vsnprintf(record.Text, Log::MaxMessageLength, format, args);
+            writer.WriteNow(record);
+            return;
+        }
+
+        Slot* slot = writer.Records.Claim();
+        if (!slot)
+        {
+            return;
+        }
+
+        slot->Data.File = file;
+        slot->Data.Line = line;
+        slot->Data.Suppressed = suppressed;
+        slot->Data.Level = level;
+        vsnprintf(slot->Data.Text, Log::MaxMessageLength, format, args);
+        Queue::Publish(*slot);
+    }
+}
+
+bool LogRateLimit::Allow()
+{
+    int64_t second = CurrentSecond();
+    int64_t current = Second.load(std::memory_order_relaxed);
+    if (current != second && Second.compare_exchange_strong(current, second, std::memory_order_relaxed))
+    {
+        Count.store(0, std::memory_order_relaxed);
+    }
+
+    if (Count.fetch_add(1, std::memory_order_relaxed) < MessagesPerSecond)
+    {
+        return true;
+    }
+    Suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Log::Start()
+{
+    auto& writer = GetWriter();
+    if (writer.Thread.joinable())
+    {
+        return;
+    }
+    writer.Stopping = false;
+    writer.Thread = std::thread(&Writer::Loop, &writer);
+}
+
+void Log::Stop()
+{
+    GetWriter().Stop();
+}
+
+void Log::SetConsole(FILE* file)
+{
+    GetWriter().Console.store(file, std::memory_order_relaxed);
+}
+
+void Log::Write(LogLevel level, const char* file, uint32_t line, uint32_t suppressed, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Push(level, file, line, suppressed, format, args);
+    va_end(args);
+}
+
+void Log::Report(const char* file, uint32_t line, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Push(LogLevel::Info, file, line, 0, format, args, true);
+    va_end(args);
+}
+
+void Log::Fail(const char* file, uint32_t line, const char* format, ...)
+{
+    char message[MaxMessageLength];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+#if ETNA_LOG_LEVEL <= ETNA_LOG_LEVEL_ERROR
+    Write(LogLevel::Error, file, line, 0, "%s", message);
+#endif
+    throw Exception(static_cast<int>(line), file, message);
+}
+
+uint64_t Log::GetDroppedCount()
+{
+    return GetWriter().Records.Dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+/*
+ * Asynchronous log behind the InfoLog, Warning and Error macros of Utils.h.
+ * A message is formatted once on the calling thread and pushed into a lock-free
+ * queue. A background thread writes it to loguru's file and to stdout,
+ * flushing once per batch. A full queue drops messages rather than block the caller.
+ * Errors are written on the calling thread after everything queued before them,
+ * so the message of a throw is out before the exception leaves.
+ *
+ * Levels below ETNA_LOG_LEVEL are compiled out, except for ReportLog, the results of the tools. Call sites that may fire every frame
+ * use the rate limited InfoLogLimited and WarningLimited, so over the limit a message
+ * costs a clock read.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#define ETNA_LOG_LEVEL_INFO     0
+#define ETNA_LOG_LEVEL_WARNING  1
+#define ETNA_LOG_LEVEL_ERROR    2
+#define ETNA_LOG_LEVEL_NONE     3
+
+// Lowest level compiled in, may come from the build. Everything in Debug, nothing in Release.
+#ifndef ETNA_LOG_LEVEL
+    #if defined(LOGGING) || defined(_DEBUG)
+        #define ETNA_LOG_LEVEL ETNA_LOG_LEVEL_INFO
+    #else
+        #define ETNA_LOG_LEVEL ETNA_LOG_LEVEL_NONE
+    #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define ETNA_PRINTF_LIKE(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+    #define ETNA_PRINTF_LIKE(formatIndex, firstArg)
+#endif
+
+enum class LogLevel : uint8_t
+{
+    Info = ETNA_LOG_LEVEL_INFO,
+    Warning = ETNA_LOG_LEVEL_WARNING,
+    Error = ETNA_LOG_LEVEL_ERROR
+};
+
+/// Static at every limited call site, constant initialized, so it costs no guard
+class LogRateLimit
+{
+public:
+    static constexpr uint32_t MessagesPerSecond = 10;
+
+public:
+    /// Counts the message against this second's budget of the call site
+    bool Allow();
+    /// Messages dropped since the last one allowed
+    uint32_t TakeSuppressed() { return Suppressed.exchange(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> Second = -1;
+    std::atomic<uint32_t> Count = 0;
+    std::atomic<uint32_t> Suppressed = 0;
+};
+
+class Log
+{
+public:
+    // Longer messages are truncated
+    static constexpr uint32_t MaxMessageLength = 480;
+    // Must be a power of two
+    static constexpr uint32_t QueueCapacity = 1024;
+
+public:
+    /// Starts the writer thread. Messages logged before are kept in the queue.
+    static void Start();
+    /// Writes out everything queued and joins the writer, on every exit of the program
+    static void Stop();
+    /// Stream of the console lines, stdout by default. Stderr keeps them out of data written to stdout.
+    static void SetConsole(FILE* file);
+
+    static void Write(LogLevel level, const char* file, uint32_t line, uint32_t suppressed,
+                      const char* format, ...) ETNA_PRINTF_LIKE(5, 6);
+
+    /// Results of the tools, written in place and never compiled out, so Release builds print them too
+    static void Report(const char* file, uint32_t line, const char* format, ...) ETNA_PRINTF_LIKE(3, 4);
+
+    /// Logs the message as an error, then throws it as an Exception
+    [[noreturn]] static void Fail(const char* file, uint32_t line, const char* format, ...) ETNA_PRINTF_LIKE(3, 4);
+
+    /// Messages lost to a full queue so far
+    static uint64_t GetDroppedCount();
+};
+
+#endif //LOG_H
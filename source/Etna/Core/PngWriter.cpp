@@ -0,0 +1,134 @@
+#include "PngWriter.h"
+#include "Utils.h"
+
+#include <array>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    const std::array<uint32_t, 256>& GetCrcTable()
+    {
+        static const std::array<uint32_t, 256> table = []()
+        {
+            std::array<uint32_t, 256> result{};
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                result[n] = c;
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    uint32_t UpdateCrc(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        const auto& table = GetCrcTable();
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void PushU32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void WriteChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(data.size() + 12);
+        PushU32(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+
+        // CRC covers type and data, but not the length
+        uint32_t crc = UpdateCrc(0xFFFFFFFFu, chunk.data() + 4, chunk.size() - 4) ^ 0xFFFFFFFFu;
+        PushU32(chunk, crc);
+
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+}
+
+bool WritePng(const std::string& path, uint32_t width, uint32_t height, uint32_t channels, const uint8_t* pixels)
+{
+    uint8_t colorType;
+    switch (channels)
+    {
+        case 1: colorType = 0; break;
+        case 3: colorType = 2; break;
+        case 4: colorType = 6; break;
+        default:
+            ErrorNoThrow("PNG with %u channels is not supported.", channels);
+            return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        ErrorNoThrow("Failed to open %s for writing.", path.c_str());
+        return false;
+    }
+
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    PushU32(header, width);
+    PushU32(header, height);
+    header.insert(header.end(), {8, colorType, 0, 0, 0});
+    WriteChunk(file, "IHDR", header);
+
+    // Every row starts with filter type 0 (none)
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+    }
+
+    // zlib stream of stored deflate blocks
+    const size_t maxBlock = 65535;
+    std::vector<uint8_t> compressed = {0x78, 0x01};
+    compressed.reserve(raw.size() + raw.size() / maxBlock * 5 + 16);
+    size_t offset = 0;
+    do
+    {
+        size_t blockSize = std::min(maxBlock, raw.size() - offset);
+        bool last = offset + blockSize == raw.size();
+        auto length = static_cast<uint16_t>(blockSize);
+        compressed.push_back(last ? 1 : 0);
+        compressed.push_back(static_cast<uint8_t>(length));
+        compressed.push_back(static_cast<uint8_t>(length >> 8));
+        compressed.push_back(static_cast<uint8_t>(~length));
+        compressed.push_back(static_cast<uint8_t>(~length >> 8));
+        compressed.insert(compressed.end(), raw.begin() + static_cast<std::ptrdiff_t>(offset),
+                          raw.begin() + static_cast<std::ptrdiff_t>(offset + blockSize));
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    PushU32(compressed, (b << 16) | a);
+    WriteChunk(file, "IDAT", compressed);
+
+    WriteChunk(file, "IEND", {});
+
+    return file.good();
+}
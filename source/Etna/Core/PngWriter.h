@@ -0,0 +1,15 @@
+/*
+ * Minimal PNG encoder. Data is stored without compression,
+ * files are big but writing them costs next to nothing.
+ */
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <cstdint>
+#include <string>
+
+/// Write 8 bit per channel image, channels is 1 (gray), 3 (RGB) or 4 (RGBA)
+bool WritePng(const std::string& path, uint32_t width, uint32_t height, uint32_t channels, const uint8_t* pixels);
+
+#endif //PNGWRITER_H
@@ -0,0 +1,219 @@
+#include "Profiler.h"
+#include "Utils.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define PROFILER_USE_TSC 1
+#else
+    #define PROFILER_USE_TSC 0
+#endif
+
+namespace
+{
+    uint64_t SteadyNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Seqlock of a single event: the sequence is odd while the owner writes it, and 2 * (index + 1)
+    // once the event of that index is complete. Fields are relaxed atomics, so reading them
+    // while the owner overwrites the slot is no data race, the sequence tells the copy is torn.
+    struct EventSlot
+    {
+        std::atomic<uint64_t> Sequence = 0;
+        std::atomic<const char*> Name = nullptr;
+        std::atomic<uint64_t> Start = 0;
+        std::atomic<uint64_t> End = 0;
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<EventSlot> Events = std::vector<EventSlot>(Profiler::BufferCapacity);
+        // Total number of events ever written, only the owning thread stores it
+        std::atomic<uint64_t> Head = 0;
+        uint32_t ThreadId = 0;
+        std::string Name;
+    };
+
+    // Buffers are owned here and outlive their threads, so late exports still see them
+    struct Registry
+    {
+        std::mutex Mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+
+        // Reference points to convert raw timestamps into nanoseconds
+        uint64_t BaseTicks = Profiler::Now();
+        uint64_t BaseNs = SteadyNs();
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ThreadBuffer* RegisterThread()
+    {
+        auto& registry = GetRegistry();
+        std::lock_guard lock(registry.Mutex);
+
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->ThreadId = static_cast<uint32_t>(registry.Buffers.size());
+        registry.Buffers.push_back(std::move(buffer));
+        return registry.Buffers.back().get();
+    }
+
+    ThreadBuffer* GetThreadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = RegisterThread();
+        return buffer;
+    }
+
+    /// Copy of the event of the index, false if the slot holds another one or is being written
+    bool ReadEvent(const EventSlot& slot, uint64_t index, Profiler::Event& event)
+    {
+        uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2)
+        {
+            return false;
+        }
+
+        event.Name = slot.Name.load(std::memory_order_relaxed);
+        event.Start = slot.Start.load(std::memory_order_relaxed);
+        event.End = slot.End.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.Sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    void WriteEscaped(std::ofstream& out, const char* str)
+    {
+        for (; *str; str++)
+        {
+            if (*str == '"' || *str == '\\')
+            {
+                out << '\\';
+            }
+            out << *str;
+        }
+    }
+}
+
+uint64_t Profiler::Now()
+{
+#if PROFILER_USE_TSC
+    return __rdtsc();
+#else
+    return SteadyNs();
+#endif
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+    uint64_t head = buffer->Head.load(std::memory_order_relaxed);
+
+    EventSlot& slot = buffer->Events[head & (BufferCapacity - 1)];
+    slot.Sequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Name.store(name, std::memory_order_relaxed);
+    slot.Start.store(start, std::memory_order_relaxed);
+    slot.End.store(end, std::memory_order_relaxed);
+    slot.Sequence.store(2 * head + 2, std::memory_order_release);
+    buffer->Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+    std::lock_guard lock(GetRegistry().Mutex);
+    buffer->Name = name;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+    auto& registry = GetRegistry();
+
+    // Calibrate ticks against the steady clock over the whole run
+    uint64_t ticks = Now() - registry.BaseTicks;
+    uint64_t ns = SteadyNs() - registry.BaseNs;
+    double nsPerTick = (ticks != 0 && ns != 0) ? static_cast<double>(ns) / static_cast<double>(ticks) : 1.0;
+
+    auto toUs = [&](uint64_t timestamp)
+    {
+        // Events recorded before the registry existed would wrap around
+        uint64_t delta = timestamp > registry.BaseTicks ? timestamp - registry.BaseTicks : 0;
+        return static_cast<double>(delta) * nsPerTick * 1e-3;
+    };
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open())
+    {
+        ErrorNoThrow("Failed to open %s for writing.", path.c_str());
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out.precision(3);
+    out << std::fixed;
+
+    size_t written = 0;
+    bool first = true;
+    auto separator = [&]()
+    {
+        if (!first)
+        {
+            out << ",\n";
+        }
+        first = false;
+    };
+
+    std::lock_guard lock(registry.Mutex);
+    for (const auto& buffer : registry.Buffers)
+    {
+        if (!buffer->Name.empty())
+        {
+            separator();
+            out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->ThreadId
+                << R"(,"args":{"name":")";
+            WriteEscaped(out, buffer->Name.c_str());
+            out << "\"}}";
+        }
+
+        // The owner keeps writing while we read, slots it overwrote in the meantime are skipped
+        uint64_t head = buffer->Head.load(std::memory_order_acquire);
+        uint64_t begin = head > BufferCapacity ? head - BufferCapacity : 0;
+
+        for (uint64_t i = begin; i < head; i++)
+        {
+            Event event{};
+            if (!ReadEvent(buffer->Events[i & (BufferCapacity - 1)], i, event)
+                || event.Name == nullptr || event.End < event.Start)
+            {
+                continue;
+            }
+
+            separator();
+            out << "{\"name\":\"";
+            WriteEscaped(out, event.Name);
+            out << R"(","ph":"X","pid":1,"tid":)" << buffer->ThreadId
+                << ",\"ts\":" << toUs(event.Start)
+                << ",\"dur\":" << toUs(event.End) - toUs(event.Start) << "}";
+            written++;
+        }
+    }
+
+    out << "\n]}\n";
+    InfoLog("CPU trace with %zu zones written to %s", written, path.c_str());
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * Scoped CPU zone profiler.
+ * Every thread writes into its own ring buffer, no locks on the hot path.
+ * Export copies the slots out under a per-slot seqlock, while the threads keep recording.
+ * Collected zones are exported in chrome://tracing (Trace Event) format.
+ *
+ * Usage:
+ *      void Foo()
+ *      {
+ *          PROFILE_FUNCTION();
+ *          {
+ *              PROFILE_SCOPE("Foo inner loop");
+ *              ...
+ *          }
+ *      }
+ *
+ * Zone names must be string literals or otherwise outlive the profiler.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(PROFILING) || defined(_DEBUG)
+    #define ENABLE_PROFILING 1
+#else
+    #define ENABLE_PROFILING 0
+#endif
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#if ENABLE_PROFILING
+    #define PROFILE_SCOPE(name)         ProfileZone PROFILER_CONCAT(profileZone, __LINE__)(name)
+    #define PROFILE_FUNCTION()          PROFILE_SCOPE(__func__)
+    #define PROFILE_THREAD_NAME(name)   ::Profiler::SetThreadName(name)
+#else
+    #define PROFILE_SCOPE(name)
+    #define PROFILE_FUNCTION()
+    #define PROFILE_THREAD_NAME(name)
+#endif
+
+class Profiler
+{
+public:
+    struct Event
+    {
+        const char* Name;
+        uint64_t Start;
+        uint64_t End;
+    };
+
+    // Per thread, must be a power of two
+    static constexpr uint32_t BufferCapacity = 1u << 16;
+
+public:
+    /// Raw timestamp: TSC on x86-64, steady clock nanoseconds elsewhere
+    static uint64_t Now();
+
+    static void Record(const char* name, uint64_t start, uint64_t end);
+    static void SetThreadName(const std::string& name);
+
+    /// Write all buffered zones of all threads as chrome://tracing JSON
+    static bool ExportChromeTrace(const std::string& path);
+};
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name) : Name(name), Start(Profiler::Now()) {}
+    ~ProfileZone() { Profiler::Record(Name, Start, Profiler::Now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* Name;
+    uint64_t Start;
+};
+
+#endif //PROFILER_H
@@ -0,0 +1,109 @@
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <numeric>
+
+QualityGovernor::QualityGovernor(const QualitySettings& settings)
+{
+    SetSettings(settings);
+}
+
+void QualityGovernor::SetSettings(const QualitySettings& settings)
+{
+    Settings = settings;
+    if (!Pinned)
+    {
+        Level = {Settings.MaxScale, Settings.MaxSteps};
+    }
+    Samples.clear();
+    CooldownLeft = 0;
+}
+
+void QualityGovernor::Update(float gpuFrameMs)
+{
+    Samples.push_back(gpuFrameMs);
+    while (Samples.size() > Settings.Window)
+    {
+        Samples.pop_front();
+    }
+    AverageMs = std::accumulate(Samples.begin(), Samples.end(), 0.0f) / static_cast<float>(Samples.size());
+
+    if (Pinned)
+    {
+        return;
+    }
+
+    if (CooldownLeft > 0)
+    {
+        CooldownLeft--;
+        return;
+    }
+
+    if (Samples.size() < Settings.Window)
+    {
+        return;
+    }
+
+    if (AverageMs > Settings.TargetFrameMs * Settings.UpperThreshold)
+    {
+        Degrade();
+    }
+    else if (AverageMs < Settings.TargetFrameMs * Settings.LowerThreshold)
+    {
+        Improve();
+    }
+}
+
+void QualityGovernor::Pin(float scale, uint32_t steps)
+{
+    Pinned = true;
+    Level = {scale, steps};
+}
+
+void QualityGovernor::Unpin()
+{
+    Pinned = false;
+    Level.Scale = std::clamp(Level.Scale, Settings.MinScale, Settings.MaxScale);
+    Level.Steps = std::clamp(Level.Steps, Settings.MinSteps, Settings.MaxSteps);
+    Samples.clear();
+}
+
+void QualityGovernor::Degrade()
+{
+    // Resolution goes first, it is the cheapest to lose visually
+    QualityLevel previous = Level;
+    if (Level.Scale > Settings.MinScale)
+    {
+        Level.Scale = std::max(Settings.MinScale, Level.Scale - Settings.ScaleStep);
+    }
+    else if (Level.Steps > Settings.MinSteps)
+    {
+        Level.Steps = std::max(Settings.MinSteps, Level.Steps - Settings.StepsStep);
+    }
+
+    if (previous.Scale != Level.Scale || previous.Steps != Level.Steps)
+    {
+        Samples.clear();
+        CooldownLeft = Settings.Cooldown;
+    }
+}
+
+void QualityGovernor::Improve()
+{
+    // Undo in reverse order
+    QualityLevel previous = Level;
+    if (Level.Steps < Settings.MaxSteps)
+    {
+        Level.Steps = std::min(Settings.MaxSteps, Level.Steps + Settings.StepsStep);
+    }
+    else if (Level.Scale < Settings.MaxScale)
+    {
+        Level.Scale = std::min(Settings.MaxScale, Level.Scale + Settings.ScaleStep);
+    }
+
+    if (previous.Scale != Level.Scale || previous.Steps != Level.Steps)
+    {
+        Samples.clear();
+        CooldownLeft = Settings.Cooldown;
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Keeps GPU frame time inside a budget by trading
+ * render resolution and raymarch step count.
+ * Fed with GPU frame times, read back a few frames late.
+ */
+
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+#include <cstdint>
+#include <deque>
+
+struct QualitySettings
+{
+    float TargetFrameMs = 16.6f;
+
+    // Hysteresis band around the target, as fractions of it.
+    // Quality drops above Upper * target and rises below Lower * target.
+    float UpperThreshold = 0.95f;
+    float LowerThreshold = 0.75f;
+
+    float MinScale = 0.5f;
+    float MaxScale = 1.0f;
+    float ScaleStep = 0.05f;
+
+    uint32_t MinSteps = 32;
+    uint32_t MaxSteps = 128;
+    uint32_t StepsStep = 16;
+
+    // Number of GPU samples averaged before a decision is made
+    uint32_t Window = 16;
+    // Frames to wait after an adjustment, so its effect can show up in the timings
+    uint32_t Cooldown = 8;
+};
+
+struct QualityLevel
+{
+    float Scale;
+    uint32_t Steps;
+};
+
+class QualityGovernor
+{
+public:
+    explicit QualityGovernor(const QualitySettings& settings = {});
+
+    /// Feed GPU time of one finished frame
+    void Update(float gpuFrameMs);
+
+    /// Freeze quality level, used by benchmarks and offline rendering. Renderer applies it from the next BeginFrame.
+    void Pin(float scale, uint32_t steps);
+    void Unpin();
+
+    void SetSettings(const QualitySettings& settings);
+
+    [[nodiscard]] bool IsPinned() const { return Pinned; }
+    [[nodiscard]] QualityLevel GetLevel() const { return Level; }
+    [[nodiscard]] float GetAverageFrameMs() const { return AverageMs; }
+    [[nodiscard]] const QualitySettings& GetSettings() const { return Settings; }
+
+private:
+    void Degrade();
+    void Improve();
+
+private:
+    QualitySettings Settings;
+    QualityLevel Level{1.0f, 128};
+
+    std::deque<float> Samples;
+    float AverageMs = 0.0f;
+    uint32_t CooldownLeft = 0;
+    bool Pinned = false;
+};
+
+#endif //QUALITYGOVERNOR_H
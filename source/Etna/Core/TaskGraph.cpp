@@ -0,0 +1,188 @@
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Utils.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+TaskGraph::TaskGraph(Timepoint origin)
+    : Origin(origin)
+{
+}
+
+TaskGraph::TaskId TaskGraph::Add(const std::string& name, std::function<void()> task,
+                                 const std::vector<TaskId>& dependencies, TaskAffinity affinity)
+{
+    auto id = static_cast<TaskId>(Tasks.size());
+    for (TaskId dependency : dependencies)
+    {
+        if (dependency >= id)
+        {
+            Error("Task %s depends on a task, which is not added yet.", name.c_str());
+        }
+        Tasks[dependency].Dependants.push_back(id);
+    }
+
+    Tasks.push_back({std::move(task), {}, static_cast<uint32_t>(dependencies.size()), affinity});
+    Timings.push_back({name, affinity, 0.0, 0.0});
+    return id;
+}
+
+double TaskGraph::GetElapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - Origin).count();
+}
+
+void TaskGraph::Run(ThreadPool& pool)
+{
+    PROFILE_FUNCTION();
+
+    // Workers only report what they have finished, the scheduling is done by this thread
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<TaskId> finished;
+    std::exception_ptr failure;
+
+    std::deque<TaskId> mainReady;
+    std::vector<uint32_t> dependencies(Tasks.size());
+    std::vector<bool> skipped(Tasks.size(), false);
+    size_t done = 0;
+
+    auto execute = [this](TaskId id)
+    {
+        Timings[id].Start = GetElapsed();
+        Tasks[id].Function();
+        Timings[id].End = GetElapsed();
+    };
+
+    auto schedule = [&](TaskId id)
+    {
+        if (Tasks[id].Affinity == TaskAffinity::MainThread)
+        {
+            mainReady.push_back(id);
+            return;
+        }
+
+        pool.Submit([&, id]()
+        {
+            std::exception_ptr exception;
+            try
+            {
+                execute(id);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            std::lock_guard lock(mutex);
+            if (exception && !failure)
+            {
+                failure = exception;
+            }
+            finished.push_back(id);
+            condition.notify_one();
+        });
+    };
+
+    // Dependants of a failed task are never run, but still counted as done
+    std::function<void(TaskId)> complete = [&](TaskId id)
+    {
+        done++;
+        for (TaskId dependant : Tasks[id].Dependants)
+        {
+            skipped[dependant] = skipped[dependant] || skipped[id] || failure;
+            if (--dependencies[dependant] != 0)
+            {
+                continue;
+            }
+
+            if (skipped[dependant])
+            {
+                complete(dependant);
+            }
+            else
+            {
+                schedule(dependant);
+            }
+        }
+    };
+
+    for (TaskId id = 0; id < Tasks.size(); id++)
+    {
+        dependencies[id] = Tasks[id].Dependencies;
+    }
+    for (TaskId id = 0; id < Tasks.size(); id++)
+    {
+        if (dependencies[id] == 0)
+        {
+            schedule(id);
+        }
+    }
+
+    while (done < Tasks.size())
+    {
+        if (!mainReady.empty())
+        {
+            TaskId id = mainReady.front();
+            mainReady.pop_front();
+
+            bool failed = false;
+            {
+                std::lock_guard lock(mutex);
+                failed = static_cast<bool>(failure);
+            }
+            if (failed)
+            {
+                skipped[id] = true;
+            }
+            else
+            {
+                try
+                {
+                    execute(id);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(mutex);
+                    failure = std::current_exception();
+                    skipped[id] = true;
+                }
+            }
+
+            std::lock_guard lock(mutex);
+            complete(id);
+            continue;
+        }
+
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [&]() { return !finished.empty(); });
+        auto batch = std::move(finished);
+        finished.clear();
+        for (TaskId id : batch)
+        {
+            complete(id);
+        }
+    }
+
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+void TaskGraph::LogReport(const char* title, const char* endName, double end) const
+{
+    ReportLog("%s:", title);
+    for (auto& timing : Timings)
+    {
+        ReportLog("    %-20s %-6s %8.1f .. %8.1f ms (%.1f ms)",
+                  timing.Name.c_str(),
+                  timing.Affinity == TaskAffinity::MainThread ? "main" : "worker",
+                  timing.Start * 1000.0, timing.End * 1000.0, (timing.End - timing.Start) * 1000.0);
+    }
+    ReportLog("    %-20s %8.1f ms", endName, end * 1000.0);
+}
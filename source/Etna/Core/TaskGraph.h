@@ -0,0 +1,75 @@
+/*
+ * One-shot graph of tasks with dependencies, used to overlap the startup phases.
+ * Worker tasks go to a thread pool, main thread tasks (window, Vulkan, ImGui)
+ * are run by the thread calling Run(), as soon as their dependencies are done.
+ * Timings of every task are kept for the startup report.
+ */
+
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+enum class TaskAffinity
+{
+    Worker,
+    MainThread
+};
+
+struct TaskTiming
+{
+    std::string Name;
+    TaskAffinity Affinity;
+    // Seconds since the origin of the graph
+    double Start;
+    double End;
+};
+
+class TaskGraph
+{
+public:
+    using TaskId = uint32_t;
+    using Timepoint = std::chrono::steady_clock::time_point;
+
+public:
+    /// Timings are measured from the origin, e.g. the process start
+    explicit TaskGraph(Timepoint origin = std::chrono::steady_clock::now());
+
+    /// Dependencies have to be added before the task
+    TaskId Add(const std::string& name, std::function<void()> task,
+               const std::vector<TaskId>& dependencies = {},
+               TaskAffinity affinity = TaskAffinity::Worker);
+
+    /// Blocks until every task is done. Tasks of a failed one are skipped,
+    /// its exception is rethrown once the tasks in flight are over.
+    void Run(ThreadPool& pool);
+
+    /// In the order of addition
+    [[nodiscard]] const std::vector<TaskTiming>& GetTimings() const { return Timings; }
+    [[nodiscard]] double GetElapsed() const;
+
+    /// Table of the task timings, closed by the given moment (e.g. the first presented frame). Printed in every build.
+    void LogReport(const char* title, const char* endName, double end) const;
+
+private:
+    struct Task
+    {
+        std::function<void()> Function;
+        std::vector<TaskId> Dependants;
+        uint32_t Dependencies = 0;
+        TaskAffinity Affinity;
+    };
+
+private:
+    Timepoint Origin;
+    std::vector<Task> Tasks;
+    std::vector<TaskTiming> Timings;
+};
+
+#endif //TASKGRAPH_H
@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    Workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(Mutex);
+        Stopping = true;
+    }
+    Condition.notify_all();
+
+    for (auto& worker : Workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()>&& task)
+{
+    {
+        std::lock_guard lock(Mutex);
+        Tasks.push(std::move(task));
+    }
+    Condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop(uint32_t index)
+{
+    PROFILE_THREAD_NAME("Worker " + std::to_string(index));
+    UNUSED(index);
+
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(Mutex);
+            Condition.wait(lock, [this]() { return Stopping || !Tasks.empty(); });
+
+            // Queue is drained before stopping
+            if (Tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(Tasks.front());
+            Tasks.pop();
+        }
+
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Helpers may start after the loop is over, so the state outlives this call
+    struct State
+    {
+        std::atomic<uint32_t> Next = 0;
+        std::atomic<uint32_t> Done = 0;
+        uint32_t Count;
+        const std::function<void(uint32_t)>* Body;
+        std::mutex Mutex;
+        std::condition_variable Finished;
+    };
+
+    auto state = std::make_shared<State>();
+    state->Count = count;
+    state->Body = &body;
+
+    auto work = [](State& s)
+    {
+        for (uint32_t index = s.Next.fetch_add(1); index < s.Count; index = s.Next.fetch_add(1))
+        {
+            (*s.Body)(index);
+            if (s.Done.fetch_add(1) + 1 == s.Count)
+            {
+                std::lock_guard lock(s.Mutex);
+                s.Finished.notify_all();
+            }
+        }
+    };
+
+    uint32_t helpers = std::min(GetThreadCount(), count - 1);
+    for (uint32_t i = 0; i < helpers; i++)
+    {
+        Enqueue([state, work]() { work(*state); });
+    }
+
+    work(*state);
+
+    std::unique_lock lock(state->Mutex);
+    state->Finished.wait(lock, [&]() { return state->Done.load() == count; });
+}
@@ -0,0 +1,64 @@
+/*
+ * Fixed size pool of worker threads.
+ * Tasks are taken from a single shared queue in submission order.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    /// Zero picks one thread per hardware thread
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<class F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<F>>;
+
+    /// Calls body(index) for every index in [0, count) and blocks until all of them are done.
+    /// Calling thread takes part in the work, so it is safe to nest.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body);
+
+    [[nodiscard]] uint32_t GetThreadCount() const { return static_cast<uint32_t>(Workers.size()); }
+
+private:
+    void Enqueue(std::function<void()>&& task);
+    void WorkerLoop(uint32_t index);
+
+private:
+    std::vector<std::thread> Workers;
+    std::queue<std::function<void()>> Tasks;
+
+    std::mutex Mutex;
+    std::condition_variable Condition;
+    bool Stopping = false;
+};
+
+template<class F>
+auto ThreadPool::Submit(F&& task) -> std::future<std::invoke_result_t<F>>
+{
+    using Result = std::invoke_result_t<F>;
+
+    // std::function has to be copyable, packaged_task is not
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    Enqueue([packaged]() { (*packaged)(); });
+
+    return future;
+}
+
+#endif //THREADPOOL_H
@@ -1,49 +1,70 @@
-#pragma once
-#include <loguru.hpp>
-
-#include "Exception.h"
-
-#include <vector>
-#include <string>
-#include <iostream>
-#if defined(LOGGING) || defined(_DEBUG)
-	#define ENABLE_LOGGING 1
-#else
-	#define ENABLE_LOGGING 0
-#endif
-
-#if ENABLE_LOGGING
-	#define InfoLog(...)		LOG_F(INFO, __VA_ARGS__); \
-                                std::cout << loguru::textprintf(__VA_ARGS__).c_str() << std::endl
-	#define Warning(...)		LOG_F(WARNING, __VA_ARGS__); \
-                                std::cout << loguru::textprintf(__VA_ARGS__).c_str() << std::endl
-	#define ErrorNoThrow(...)	LOG_F(ERROR, __VA_ARGS__);; \
-                                std::cout << loguru::textprintf(__VA_ARGS__).c_str() << std::endl
-	#define Error(...)			LOG_F(ERROR, __VA_ARGS__); \
-								throw EXCEPTION(loguru::textprintf(__VA_ARGS__).c_str()); \
-								std::cout << loguru::textprintf(__VA_ARGS__).c_str() << std::endl
-#else
-	#define InfoLog(...)
-	#define Warning(...)
-	#define ErrorNoThrow(...)	
-	#define Error(...)			throw EXCEPTION(loguru::textprintf(__VA_ARGS__).c_str())
-#endif
-
-#if !defined(NDEBUG)
-	#define CheckVK(exp)		if ((exp) != VK_SUCCESS) Error("Vulkan error occurred.")
-#else
-	#define CheckVK(exp)		exp
-#endif
-
-/*
- * Attributes
- */
-
-#define UNUSED(x) (void)(x)
-
-// Set loguru configurations
-void LogsInit();
-
-// Read binary file
-void ReadFile(const std::string& filename, std::vector<char>& buffer);
-
+#pragma once
+#include "Exception.h"
+#include "Log.h"
+
+#include <vector>
+#include <string>
+
+#define ETNA_LOG(level, ...)    Log::Write(level, __FILE__, __LINE__, 0, __VA_ARGS__)
+
+// Compiled out level, arguments are still checked and count as used, but never evaluated
+#define ETNA_LOG_DISCARD(level, ...) \
+                                do { if (false) ETNA_LOG(level, __VA_ARGS__); } while (false)
+
+// For call sites that may fire every frame, see LogRateLimit
+#define ETNA_LOG_LIMITED(level, ...) \
+                                do { \
+                                    static LogRateLimit etnaLogRate; \
+                                    if (etnaLogRate.Allow()) \
+                                        Log::Write(level, __FILE__, __LINE__, etnaLogRate.TakeSuppressed(), __VA_ARGS__); \
+                                } while (false)
+
+#if ETNA_LOG_LEVEL <= ETNA_LOG_LEVEL_INFO
+	#define InfoLog(...)		ETNA_LOG(LogLevel::Info, __VA_ARGS__)
+	#define InfoLogLimited(...)	ETNA_LOG_LIMITED(LogLevel::Info, __VA_ARGS__)
+#else
+	#define InfoLog(...)		ETNA_LOG_DISCARD(LogLevel::Info, __VA_ARGS__)
+	#define InfoLogLimited(...)	ETNA_LOG_DISCARD(LogLevel::Info, __VA_ARGS__)
+#endif
+
+#if ETNA_LOG_LEVEL <= ETNA_LOG_LEVEL_WARNING
+	#define Warning(...)		ETNA_LOG(LogLevel::Warning, __VA_ARGS__)
+	#define WarningLimited(...)	ETNA_LOG_LIMITED(LogLevel::Warning, __VA_ARGS__)
+#else
+	#define Warning(...)		ETNA_LOG_DISCARD(LogLevel::Warning, __VA_ARGS__)
+	#define WarningLimited(...)	ETNA_LOG_DISCARD(LogLevel::Warning, __VA_ARGS__)
+#endif
+
+#if ETNA_LOG_LEVEL <= ETNA_LOG_LEVEL_ERROR
+	#define ErrorNoThrow(...)	ETNA_LOG(LogLevel::Error, __VA_ARGS__)
+#else
+	#define ErrorNoThrow(...)	ETNA_LOG_DISCARD(LogLevel::Error, __VA_ARGS__)
+#endif
+
+// Never compiled out or rate limited, for what a tool reports as its result
+#define ReportLog(...)			Log::Report(__FILE__, __LINE__, __VA_ARGS__)
+
+// Never compiled out or rate limited, the message is thrown either way
+#define Error(...)				Log::Fail(__FILE__, __LINE__, __VA_ARGS__)
+
+#if !defined(NDEBUG)
+	#define CheckVK(exp)		if ((exp) != VK_SUCCESS) Error("Vulkan error occurred.")
+#else
+	#define CheckVK(exp)		exp
+#endif
+
+/*
+ * Attributes
+ */
+
+#define UNUSED(x) (void)(x)
+
+// Set loguru configurations, start the log writer
+void LogsInit();
+
+// Read binary file
+void ReadFile(const std::string& filename, std::vector<char>& buffer);
+
+// File in the user's cache directory, which is created if needed. Empty if there is no such directory.
+std::string GetUserCachePath(const std::string& filename);
+
@@ -0,0 +1,100 @@
+#include "VolumeSource.h"
+#include "Profiler.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+glm::uvec3 VolumeSource::GetLevelExtent(glm::uvec3 extent, uint32_t lod)
+{
+    glm::uvec3 scale(1u << lod);
+    return glm::max((extent + scale - 1u) / scale, glm::uvec3(1));
+}
+
+DenseVolumeSource::DenseVolumeSource(std::vector<uint8_t> texels, uint32_t size)
+{
+    PROFILE_FUNCTION();
+
+    if (texels.size() != static_cast<size_t>(size) * size * size * TexelSize)
+    {
+        Error("Volume data doesn't match the size %u.", size);
+    }
+    Levels.push_back({glm::uvec3(size), std::move(texels)});
+
+    // Odd edges are clamped, so the last texel of a row is averaged with itself
+    while (glm::any(glm::greaterThan(Levels.back().Extent, glm::uvec3(1))))
+    {
+        const Level& fine = Levels.back();
+        Level coarse;
+        coarse.Extent = GetLevelExtent(fine.Extent, 1);
+        coarse.Texels.resize(static_cast<size_t>(coarse.Extent.x) * coarse.Extent.y * coarse.Extent.z * TexelSize);
+
+        auto fineIndex = [&](uint32_t x, uint32_t y, uint32_t z)
+        {
+            x = std::min(x, fine.Extent.x - 1);
+            y = std::min(y, fine.Extent.y - 1);
+            z = std::min(z, fine.Extent.z - 1);
+            return ((static_cast<size_t>(z) * fine.Extent.y + y) * fine.Extent.x + x) * TexelSize;
+        };
+
+        uint8_t* out = coarse.Texels.data();
+        for (uint32_t z = 0; z < coarse.Extent.z; z++)
+        {
+            for (uint32_t y = 0; y < coarse.Extent.y; y++)
+            {
+                for (uint32_t x = 0; x < coarse.Extent.x; x++)
+                {
+                    uint32_t sum[TexelSize] = {};
+                    for (uint32_t corner = 0; corner < 8; corner++)
+                    {
+                        size_t index = fineIndex(x * 2 + (corner & 1), y * 2 + ((corner >> 1) & 1), z * 2 + (corner >> 2));
+                        for (uint32_t c = 0; c < TexelSize; c++)
+                        {
+                            sum[c] += fine.Texels[index + c];
+                        }
+                    }
+                    for (uint32_t c = 0; c < TexelSize; c++)
+                    {
+                        *out++ = static_cast<uint8_t>((sum[c] + 4) / 8);
+                    }
+                }
+            }
+        }
+        Levels.push_back(std::move(coarse));
+    }
+}
+
+void DenseVolumeSource::Read(uint32_t lod, glm::ivec3 origin, glm::uvec3 size, uint8_t* texels)
+{
+    const Level& level = Levels[std::min<size_t>(lod, Levels.size() - 1)];
+    glm::ivec3 last = glm::ivec3(level.Extent) - 1;
+
+    for (uint32_t z = 0; z < size.z; z++)
+    {
+        int32_t sourceZ = std::clamp(origin.z + static_cast<int32_t>(z), 0, last.z);
+        for (uint32_t y = 0; y < size.y; y++)
+        {
+            int32_t sourceY = std::clamp(origin.y + static_cast<int32_t>(y), 0, last.y);
+            const uint8_t* row = level.Texels.data()
+                + (static_cast<size_t>(sourceZ) * level.Extent.y + sourceY) * level.Extent.x * TexelSize;
+
+            // Middle of the row is copied at once, clamped edges a texel at a time
+            for (uint32_t x = 0; x < size.x;)
+            {
+                int32_t sourceX = origin.x + static_cast<int32_t>(x);
+                if (sourceX >= 0 && sourceX <= last.x)
+                {
+                    uint32_t run = std::min<uint32_t>(size.x - x, static_cast<uint32_t>(last.x - sourceX + 1));
+                    memcpy(texels, row + static_cast<size_t>(sourceX) * TexelSize, static_cast<size_t>(run) * TexelSize);
+                    texels += static_cast<size_t>(run) * TexelSize;
+                    x += run;
+                    continue;
+                }
+
+                memcpy(texels, row + static_cast<size_t>(std::clamp(sourceX, 0, last.x)) * TexelSize, TexelSize);
+                texels += TexelSize;
+                x++;
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * Voxel data a virtual volume streams from, a box of texels at a time.
+ * Level of detail l halves the resolution of level l - 1, level 0 is the full volume.
+ * Texels are RGBA8, as GenerateNoiseVolume packs them.
+ */
+
+#ifndef VOLUMESOURCE_H
+#define VOLUMESOURCE_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// Camera in volume coordinates, [0, 1] spans the volume on every axis
+struct VolumeView
+{
+    glm::vec3 Eye;
+    glm::vec3 Direction; // Normalized
+};
+
+class VolumeSource
+{
+public:
+    static constexpr uint32_t TexelSize = 4;
+
+public:
+    virtual ~VolumeSource() = default;
+
+    /// Voxels per axis at level 0
+    [[nodiscard]] virtual glm::uvec3 GetExtent() const = 0;
+
+    /// Texels of the box [origin, origin + size) at the level, x fastest and z slowest.
+    /// Texels outside of the level are clamped to its edge, so bricks get their borders.
+    virtual void Read(uint32_t lod, glm::ivec3 origin, glm::uvec3 size, uint8_t* texels) = 0;
+
+    /// Called once a frame before its reads, sources may prefetch what's ahead of the view
+    virtual void BeginFrame(const VolumeView&) {}
+
+    /// Voxels per axis at the level, rounded up
+    [[nodiscard]] static glm::uvec3 GetLevelExtent(glm::uvec3 extent, uint32_t lod);
+};
+
+/// Whole volume in memory, with its levels built up front by averaging 2^3 texels
+class DenseVolumeSource : public VolumeSource
+{
+public:
+    /// Texels of a size^3 volume
+    DenseVolumeSource(std::vector<uint8_t> texels, uint32_t size);
+
+    [[nodiscard]] glm::uvec3 GetExtent() const override { return Levels.front().Extent; }
+    void Read(uint32_t lod, glm::ivec3 origin, glm::uvec3 size, uint8_t* texels) override;
+
+private:
+    struct Level
+    {
+        glm::uvec3 Extent;
+        std::vector<uint8_t> Texels;
+    };
+
+private:
+    std::vector<Level> Levels;
+};
+
+#endif //VOLUMESOURCE_H
@@ -0,0 +1,135 @@
+#include "VulkanBindlessTable.h"
+#include "VulkanContext.h"
+
+#include "Etna/Core/Utils.h"
+
+namespace vkc
+{
+    void BindlessTextureTable::Init()
+    {
+        if (!Context::SupportsDescriptorIndexing())
+        {
+            InfoLog("No descriptor indexing, volumes are bound per set.");
+            return;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(Context::GetPhysicalDevice(), &properties);
+
+        if (indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers < Capacity ||
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages < Capacity ||
+            indexingProperties.maxDescriptorSetUpdateAfterBindSamplers < Capacity ||
+            indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages < Capacity)
+        {
+            InfoLog("Device allows less than %u update after bind samplers, volumes are bound per set.", Capacity);
+            return;
+        }
+
+        VkDevice device = Context::GetDevice();
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = Capacity;
+        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        // Slots are written while other slots are in use by frames in flight
+        VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = 1;
+        bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, Context::GetAllocator(), &Layout) != VK_SUCCESS)
+        {
+            Error("Failed to create bindless descriptor set layout.");
+        }
+
+        VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Capacity};
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        if (vkCreateDescriptorPool(device, &poolInfo, Context::GetAllocator(), &Pool) != VK_SUCCESS)
+        {
+            Error("Failed to create bindless descriptor pool.");
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = Pool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &Layout;
+        if (vkAllocateDescriptorSets(device, &allocInfo, &Set) != VK_SUCCESS)
+        {
+            Error("Failed to allocate bindless descriptor set.");
+        }
+
+        FreeIndices.resize(Capacity);
+        for (uint32_t i = 0; i < Capacity; i++)
+        {
+            FreeIndices[i] = Capacity - 1 - i;
+        }
+    }
+
+    void BindlessTextureTable::Shutdown()
+    {
+        if (Layout == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        vkDestroyDescriptorPool(Context::GetDevice(), Pool, Context::GetAllocator());
+        vkDestroyDescriptorSetLayout(Context::GetDevice(), Layout, Context::GetAllocator());
+        Pool = VK_NULL_HANDLE;
+        Layout = VK_NULL_HANDLE;
+        Set = VK_NULL_HANDLE;
+        FreeIndices.clear();
+    }
+
+    uint32_t BindlessTextureTable::Register(const Texture3D& texture)
+    {
+        if (FreeIndices.empty())
+        {
+            Error("Bindless table is full, %u textures are registered.", Capacity);
+        }
+        uint32_t index = FreeIndices.back();
+        FreeIndices.pop_back();
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = texture.GetView();
+        imageInfo.sampler = texture.GetSampler();
+
+        VkWriteDescriptorSet writeSet{};
+        writeSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeSet.dstSet = Set;
+        writeSet.dstBinding = 0;
+        writeSet.dstArrayElement = index;
+        writeSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writeSet.descriptorCount = 1;
+        writeSet.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(Context::GetDevice(), 1, &writeSet, 0, nullptr);
+
+        return index;
+    }
+
+    void BindlessTextureTable::Unregister(uint32_t index)
+    {
+        // Partially bound, so the stale descriptor is fine as long as no shader reads it
+        FreeIndices.push_back(index);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Bindless table of volume textures.
+ * One partially bound, update after bind array of sampler3D in a single set.
+ * Textures register once and keep their index, shaders pick one by a per-draw integer,
+ * so drawing different volumes needs no descriptor set rebinding.
+ * Requires descriptor indexing, see Context::SupportsDescriptorIndexing.
+ */
+
+#ifndef VULKANBINDLESSTABLE_H
+#define VULKANBINDLESSTABLE_H
+
+#include "VulkanHeader.h"
+#include "VulkanTexture.h"
+
+#include <vector>
+
+namespace vkc
+{
+    class BindlessTextureTable
+    {
+    public:
+        /// Has to match BINDLESS_VOLUME_CAPACITY in the shaders
+        static constexpr uint32_t Capacity = 1024;
+
+    public:
+        BindlessTextureTable() = default;
+        ~BindlessTextureTable() = default;
+
+        BindlessTextureTable(const BindlessTextureTable&) = delete;
+        BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+
+        /// Stays disabled when the device lacks descriptor indexing or the limits are too low
+        void Init();
+        void Shutdown();
+
+        [[nodiscard]] bool IsEnabled() const { return Set != VK_NULL_HANDLE; }
+
+        /// Write the texture into a free slot. Index stays valid until it's unregistered.
+        uint32_t Register(const Texture3D& texture);
+        /// Slot might still be read by frames in flight, wait for them first
+        void Unregister(uint32_t index);
+
+        [[nodiscard]] VkDescriptorSetLayout GetLayout() const { return Layout; }
+        [[nodiscard]] VkDescriptorSet GetSet() const { return Set; }
+        [[nodiscard]] uint32_t GetCount() const { return Capacity - static_cast<uint32_t>(FreeIndices.size()); }
+
+    private:
+        VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+        VkDescriptorPool Pool = VK_NULL_HANDLE;
+        VkDescriptorSet Set = VK_NULL_HANDLE;
+
+        // Popped from the back, so lower indices are handed out first
+        std::vector<uint32_t> FreeIndices;
+    };
+}
+
+#endif //VULKANBINDLESSTABLE_H
@@ -0,0 +1,186 @@
+#include "VulkanBrickProxy.h"
+#include "VulkanRenderer.h"
+#include "VulkanContext.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/Utils.h"
+
+namespace vkc
+{
+    // Has to match local_size_x of shaders/cull_bricks.glsl
+    static constexpr uint32_t CullGroupSize = 64;
+
+    BrickProxy::BrickProxy(Renderer& renderer, uint32_t indexCount)
+        : Owner(renderer), IndexCount(indexCount)
+    {
+        CreateBuffer(
+            sizeof(VkDrawIndexedIndirectCommand),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Arguments, ArgumentsMemory
+        );
+
+        CullLayout = DescriptorSetLayout::Builder()
+            .AddBinding(0, DescriptorType::StorageBuffer, ShaderStage::Compute)
+            .AddBinding(1, DescriptorType::StorageBuffer, ShaderStage::Compute)
+            .AddBinding(2, DescriptorType::StorageBuffer, ShaderStage::Compute)
+            .Build();
+        DrawLayout = DescriptorSetLayout::Builder()
+            .AddBinding(0, DescriptorType::StorageBuffer, ShaderStage::Vertex)
+            .AddBinding(1, DescriptorType::StorageBuffer, ShaderStage::Vertex)
+            .Build();
+
+        Culling = ComputePipelineBuilder()
+            .SetComputeShader("shaders/cull_bricks.spv")
+            .AddDescriptorSetLayout(CullLayout->Handle)
+            .AddPushConstantRange({VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants)})
+            .Build(Owner.GetPipelineCompiler().GetCache());
+    }
+
+    BrickProxy::~BrickProxy()
+    {
+        VkDevice device = Context::GetDevice();
+        auto allocator = Context::GetAllocator();
+
+        DestroyBoxes();
+        vkDestroyBuffer(device, Arguments, allocator);
+        vkFreeMemory(device, ArgumentsMemory, allocator);
+
+        vkDestroyPipeline(device, Culling.Handle, allocator);
+        vkDestroyPipelineLayout(device, Culling.Layout, allocator);
+        vkDestroyDescriptorSetLayout(device, CullLayout->Handle, allocator);
+        vkDestroyDescriptorSetLayout(device, DrawLayout->Handle, allocator);
+    }
+
+    void BrickProxy::DestroyBoxes()
+    {
+        VkDevice device = Context::GetDevice();
+        auto allocator = Context::GetAllocator();
+
+        vkDestroyBuffer(device, Boxes, allocator);
+        vkFreeMemory(device, BoxesMemory, allocator);
+        vkDestroyBuffer(device, Visible, allocator);
+        vkFreeMemory(device, VisibleMemory, allocator);
+        Boxes = VK_NULL_HANDLE;
+        BoxesMemory = VK_NULL_HANDLE;
+        Visible = VK_NULL_HANDLE;
+        VisibleMemory = VK_NULL_HANDLE;
+        BoxCount = 0;
+    }
+
+    void BrickProxy::SetBoxes(const std::vector<ProxyBox>& boxes)
+    {
+        PROFILE_FUNCTION();
+
+        // Buffers and the cached sets might still be in use
+        vkDeviceWaitIdle(Context::GetDevice());
+        Owner.GetDescriptorAllocator().ClearCache();
+        DestroyBoxes();
+        if (boxes.empty())
+        {
+            return;
+        }
+
+        VkDeviceSize boxesSize = boxes.size() * sizeof(ProxyBox);
+        CreateBuffer(
+            boxesSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Boxes, BoxesMemory
+        );
+        CreateBuffer(
+            boxes.size() * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Visible, VisibleMemory
+        );
+
+        VkBuffer uploadBuffer;
+        VkDeviceMemory uploadMemory;
+        CreateBuffer(
+            boxesSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            uploadBuffer, uploadMemory
+        );
+        FillBuffer(uploadMemory, const_cast<ProxyBox*>(boxes.data()), boxesSize);
+        CopyBuffer(uploadBuffer, Boxes, boxesSize);
+        vkDestroyBuffer(Context::GetDevice(), uploadBuffer, Context::GetAllocator());
+        vkFreeMemory(Context::GetDevice(), uploadMemory, Context::GetAllocator());
+
+        BoxCount = static_cast<uint32_t>(boxes.size());
+    }
+
+    void BrickProxy::RecordCulling(VkCommandBuffer commandBuffer, const glm::mat4& modelViewProjection)
+    {
+        if (BoxCount == 0)
+        {
+            return;
+        }
+
+        // Draw of the previous frame has to be done with the arguments and the list
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        // Instances are counted up by the culling
+        VkDrawIndexedIndirectCommand reset = {IndexCount, 0, 0, 0, 0};
+        vkCmdUpdateBuffer(commandBuffer, Arguments, 0, sizeof(reset), &reset);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        DescriptorSetWriter writer{*CullLayout, Owner.GetDescriptorAllocator(), DescriptorLifetime::Cached};
+        writer.WriteBuffer(0, Boxes, 0, VK_WHOLE_SIZE);
+        writer.WriteBuffer(1, Visible, 0, VK_WHOLE_SIZE);
+        writer.WriteBuffer(2, Arguments, 0, VK_WHOLE_SIZE);
+        VkDescriptorSet set = writer.Write();
+
+        CullConstants constants = {modelViewProjection, BoxCount};
+        Culling.Bind(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Culling.Layout, 0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, Culling.Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (BoxCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void BrickProxy::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+    {
+        if (BoxCount == 0)
+        {
+            Error("Brick proxy has no boxes to bind.");
+        }
+
+        DescriptorSetWriter writer{*DrawLayout, Owner.GetDescriptorAllocator(), DescriptorLifetime::Cached};
+        writer.WriteBuffer(0, Boxes, 0, VK_WHOLE_SIZE);
+        writer.WriteBuffer(1, Visible, 0, VK_WHOLE_SIZE);
+        VkDescriptorSet set = writer.Write();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                                setIndex, 1, &set, 0, nullptr);
+    }
+
+    void BrickProxy::Draw(VkCommandBuffer commandBuffer)
+    {
+        if (BoxCount == 0)
+        {
+            return;
+        }
+
+        // Instance count was written by the culling, the visible list maps instances to boxes
+        vkCmdDrawIndexedIndirect(commandBuffer, Arguments, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Tight proxy geometry of a sparse volume: one box per occupied brick instead of one around all of it.
+ * Every frame a compute pass culls the boxes against the view frustum, appends the visible ones
+ * to a list and counts them into the instances of an indexed indirect draw. Vertex shader of the
+ * draw scales the unit cube to the box of its instance, see shaders/vert_bricks.glsl.
+ * Boxes are disjoint, so premultiplied segments of a ray composite into the whole ray.
+ */
+
+#ifndef VULKANBRICKPROXY_H
+#define VULKANBRICKPROXY_H
+
+#include "VulkanDescriptors.h"
+#include "VulkanPipeline.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace vkc
+{
+    class Renderer;
+
+    /// Has to match shaders/cull_bricks.glsl and shaders/include/BrickProxyVertex.glsl, w of both corners is unused
+    struct ProxyBox
+    {
+        glm::vec4 Min;
+        glm::vec4 Max;
+    };
+
+    class BrickProxy
+    {
+    public:
+        /// Set layouts are valid right away, the draw is of the index count per box
+        BrickProxy(Renderer& renderer, uint32_t indexCount);
+        ~BrickProxy();
+
+        BrickProxy(const BrickProxy&) = delete;
+        BrickProxy& operator=(const BrickProxy&) = delete;
+
+        /// Replace the boxes. Waits for the device to idle.
+        void SetBoxes(const std::vector<ProxyBox>& boxes);
+
+        /// Cull the boxes against the clip space of the matrix, outside of any render pass
+        void RecordCulling(VkCommandBuffer commandBuffer, const glm::mat4& modelViewProjection);
+        /// Set of the vertex stage, needs at least one box
+        void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex);
+        /// Visible boxes, inside of a pass that follows the culling
+        void Draw(VkCommandBuffer commandBuffer);
+
+        /// Boxes and the visible list for the vertex stage
+        [[nodiscard]] const DescriptorSetLayout& GetLayout() const { return *DrawLayout; }
+        [[nodiscard]] uint32_t GetBoxCount() const { return BoxCount; }
+
+    private:
+        struct CullConstants
+        {
+            glm::mat4 ModelViewProjection;
+            uint32_t BoxCount;
+        };
+
+        void DestroyBoxes();
+
+    private:
+        Renderer& Owner;
+        uint32_t IndexCount;
+
+        // Device local, both of them sized for every box
+        VkBuffer Boxes = VK_NULL_HANDLE;
+        VkDeviceMemory BoxesMemory = VK_NULL_HANDLE;
+        VkBuffer Visible = VK_NULL_HANDLE;
+        VkDeviceMemory VisibleMemory = VK_NULL_HANDLE;
+        uint32_t BoxCount = 0;
+
+        // VkDrawIndexedIndirectCommand, reset before every culling
+        VkBuffer Arguments = VK_NULL_HANDLE;
+        VkDeviceMemory ArgumentsMemory = VK_NULL_HANDLE;
+
+        std::unique_ptr<DescriptorSetLayout> CullLayout;
+        std::unique_ptr<DescriptorSetLayout> DrawLayout;
+        Pipeline Culling = {};
+    };
+}
+
+#endif //VULKANBRICKPROXY_H
@@ -10,7 +10,7 @@ namespace vkc
 {
     Context* Context::Singleton = nullptr;
 
-    void Context::Create()
+    void Context::Create(ContextMode mode)
     {
         if (Singleton != nullptr)
         {
@@ -18,14 +18,27 @@ namespace vkc
         }
 
         Singleton = new Context();
+        Singleton->GMode = mode;
+        Singleton->GWindow = nullptr;
+        Singleton->GSurface = VK_NULL_HANDLE;
 
         // Create window with Vulkan context
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        Singleton->GWindow = glfwCreateWindow(1280, 720, "Etna App", nullptr, nullptr);
+        if (mode == ContextMode::Windowed)
+        {
+            if (!glfwInit())
+            {
+                Error("Failed to initialize GLFW.");
+            }
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+            Singleton->GWindow = glfwCreateWindow(1280, 720, "Etna App", nullptr, nullptr);
+        }
 
         // Don't change initialization order!
         Singleton->GInstance = InstanceBuilder{}.Build();
-        Singleton->GSurface = CreateSurface(Context::GetWindow());
+        if (mode == ContextMode::Windowed)
+        {
+            Singleton->GSurface = CreateSurface(Context::GetWindow());
+        }
         Singleton->GDevice = DeviceBuilder{}.Build();
 
         auto indices = GetQueueFamilies(Context::GetPhysicalDevice(), Context::GetSurface());
@@ -84,6 +97,26 @@ namespace vkc
         return Get().GWindow;
     }
 
+    bool Context::IsHeadless()
+    {
+        return Get().GMode == ContextMode::Headless;
+    }
+
+    bool Context::SupportsDescriptorIndexing()
+    {
+        return Get().GDevice.DescriptorIndexing;
+    }
+
+    bool Context::SupportsFragmentStores()
+    {
+        return Get().GDevice.FragmentStores;
+    }
+
+    bool Context::SupportsPipelineStatistics()
+    {
+        return Get().GDevice.PipelineStatistics;
+    }
+
     VkQueue Context::GetTransferQueue()
     {
         return Get().GDevice.TransferQueue;
@@ -103,4 +136,14 @@ namespace vkc
     {
         return Get().GTransferCommandPool;
     }
+
+    GpuProfiler* Context::GetGpuProfiler()
+    {
+        return Get().GProfiler;
+    }
+
+    void Context::SetGpuProfiler(GpuProfiler* profiler)
+    {
+        Get().GProfiler = profiler;
+    }
 }
@@ -15,10 +15,20 @@
 
 namespace vkc
 {
+    class GpuProfiler;
+
+    enum class ContextMode
+    {
+        // GLFW window, surface and swapchain
+        Windowed,
+        // No window system at all, rendering goes to offscreen targets only
+        Headless,
+    };
+
     class Context
     {
     public:
-        static void Create();
+        static void Create(ContextMode mode = ContextMode::Windowed);
         static void Destroy();
         static Context &Get();
 
@@ -32,6 +42,13 @@ namespace vkc
         static VkSurfaceKHR             GetSurface();
         static VkAllocationCallbacks*   GetAllocator();
         static GLFWwindow*              GetWindow();
+        static bool                     IsHeadless();
+        /// Whether the device has partially bound, update after bind sampled image arrays
+        static bool                     SupportsDescriptorIndexing();
+        /// Whether fragment shaders may write storage buffers
+        static bool                     SupportsFragmentStores();
+        /// Whether pipeline statistics queries may be used
+        static bool                     SupportsPipelineStatistics();
 
         static VkQueue GetTransferQueue();
         static VkQueue GetGraphicsQueue();
@@ -39,10 +56,15 @@ namespace vkc
 
         static VkCommandPool GetTransferCommandPool();
 
+        /// Profiler used to time one-shot uploads, may be null
+        static GpuProfiler* GetGpuProfiler();
+        static void SetGpuProfiler(GpuProfiler* profiler);
+
     private:
         Context() = default;
 
     private:
+        ContextMode     GMode;
         Instance        GInstance;
         VkSurfaceKHR    GSurface;
         Device          GDevice;
@@ -51,6 +73,7 @@ namespace vkc
         GLFWwindow*     GWindow;
 
         VkCommandPool GTransferCommandPool;
+        GpuProfiler* GProfiler = nullptr;
 
     private:
         static Context *Singleton;
@@ -1,6 +1,7 @@
 #include "VulkanCore.h"
 
 #include "Etna/Core/Utils.h"
+#include "VulkanGpuProfiler.h"
 
 #include <cstring>
 #include <vector>
@@ -31,11 +32,11 @@ namespace vkc
             Error("Debug messenger: %s", pCallbackData->pMessage);
         }else if (DebugMessengerSeverity & messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
         {
-            Warning("Debug messenger: %s", pCallbackData->pMessage);
+            WarningLimited("Debug messenger: %s", pCallbackData->pMessage);
         }else if (DebugMessengerSeverity & messageSeverity &
                   (VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT))
         {
-            InfoLog("Debug messenger: %s", pCallbackData->pMessage);
+            InfoLogLimited("Debug messenger: %s", pCallbackData->pMessage);
         }
 
         return VK_FALSE;
@@ -150,6 +151,7 @@ namespace vkc
     QueueFamilyIndices GetQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
     {
         QueueFamilyIndices indices;
+        indices.PresentationRequired = surface != VK_NULL_HANDLE;
 
         uint32_t queueFamilyCount = 0;
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
@@ -166,17 +168,25 @@ namespace vkc
                 indices.GraphicsFamily = i;
             }
 
+            if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)
+            {
+                indices.ComputeFamily = i;
+            }
+
             if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
             {
                 indices.TransferFamily = i;
             }
 
-            VkBool32 presentationFamilySupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationFamilySupport);
-
-            if (presentationFamilySupport)
+            if (indices.PresentationRequired)
             {
-                indices.PresentationFamily = i;
+                VkBool32 presentationFamilySupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationFamilySupport);
+
+                if (presentationFamilySupport)
+                {
+                    indices.PresentationFamily = i;
+                }
             }
 
             if (indices.IsValid())
@@ -259,6 +269,16 @@ namespace vkc
     }
 
     uint32_t ChooseMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    {
+        uint32_t typeIndex;
+        if (!TryChooseMemoryType(typeFilter, properties, typeIndex))
+        {
+            Error("Failed to find suitable memory type.");
+        }
+        return typeIndex;
+    }
+
+    bool TryChooseMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& typeIndex)
     {
         VkPhysicalDeviceMemoryProperties memProperties;
         vkGetPhysicalDeviceMemoryProperties(Context::GetPhysicalDevice(), &memProperties);
@@ -267,11 +287,12 @@ namespace vkc
         {
             if (typeFilter & (1u << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties )
             {
-                return i;
+                typeIndex = i;
+                return true;
             }
         }
 
-        Error("Failed to find suitable memory type.");
+        return false;
     }
 
     void CreateBuffer(
@@ -365,7 +386,7 @@ namespace vkc
 
     void CopyBuffer(VkBuffer src, VkBuffer dest, VkDeviceSize size)
     {
-        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool());
+        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool(), "Upload: Buffer");
             VkBufferCopy copyRegion{};
             copyRegion.srcOffset = 0;
             copyRegion.dstOffset = 0;
@@ -379,7 +400,7 @@ namespace vkc
         return FindSupportedFormat(
             {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
             VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
     }
 
     bool HasStencilComponent(VkFormat format)
@@ -506,7 +527,7 @@ namespace vkc
         CreateImage(width, height, 1, VK_IMAGE_TYPE_2D, format, tiling, usage, properties, image, imageMemory);
     }
 
-    VkCommandBuffer BeginSingleTimeCommands(VkCommandPool commandPool)
+    VkCommandBuffer BeginSingleTimeCommands(VkCommandPool commandPool, const char* label)
     {
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -523,11 +544,22 @@ namespace vkc
 
         vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
+        if (auto profiler = Context::GetGpuProfiler())
+        {
+            profiler->BeginUpload(commandBuffer, label);
+        }
+
         return commandBuffer;
     }
 
     void EndSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool)
     {
+        auto profiler = Context::GetGpuProfiler();
+        if (profiler)
+        {
+            profiler->EndUpload(commandBuffer);
+        }
+
         vkEndCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo{};
@@ -538,11 +570,16 @@ namespace vkc
         vkQueueSubmit(Context::GetTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE);
         vkQueueWaitIdle(Context::GetTransferQueue());
         vkFreeCommandBuffers(Context::GetDevice(), commandPool, 1, &commandBuffer);
+
+        if (profiler)
+        {
+            profiler->ResolveUpload();
+        }
     }
 
     void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
     {
-        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool());
+        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool(), "Upload: Layout transition");
 
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -620,7 +657,7 @@ namespace vkc
 
     void CopyBufferImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth)
     {
-        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool());
+        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool(), "Upload: Image");
 
         VkBufferImageCopy region{};
         region.bufferOffset = 0;
@@ -709,6 +746,39 @@ namespace vkc
         return sampler;
     }
 
+    VkSampler CreateDepthSampler()
+    {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.mipLodBias = 0.0f;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = 0.0f;
+
+        VkSampler sampler;
+        if (vkCreateSampler(Context::GetDevice(), &samplerInfo, Context::GetAllocator(), &sampler) != VK_SUCCESS)
+        {
+            Error("Failed to create depth sampler.");
+        }
+
+        return sampler;
+    }
+
     VkDescriptorSetLayoutBinding CreateDescriptorSetLayoutBinding(
         uint32_t binding,
         uint32_t count,
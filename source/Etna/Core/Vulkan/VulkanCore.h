@@ -60,12 +60,17 @@ namespace vkc
     {
         bool IsValid()
         {
-            return GraphicsFamily.has_value() && PresentationFamily.has_value() && TransferFamily.has_value();
+            return GraphicsFamily.has_value() && ComputeFamily.has_value() && TransferFamily.has_value()
+                && (!PresentationRequired || PresentationFamily.has_value());
         }
 
         std::optional<uint32_t> TransferFamily;
         std::optional<uint32_t> GraphicsFamily;
+        std::optional<uint32_t> ComputeFamily;
         std::optional<uint32_t> PresentationFamily;
+
+        // There is nothing to present to in headless mode
+        bool PresentationRequired = true;
     };
 
     /// Holds swapchain support details obtained from device properties
@@ -94,13 +99,15 @@ namespace vkc
     /// Copy buffer contents into an image
     void CopyBufferImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t depth = 1);
 
-    /// For executing single time commands like buffer coping or layout transition
-    VkCommandBuffer BeginSingleTimeCommands(VkCommandPool commandPool);
+    /// For executing single time commands like buffer coping or layout transition.
+    /// Label names the upload in the GPU profiler and debug tools.
+    VkCommandBuffer BeginSingleTimeCommands(VkCommandPool commandPool, const char* label = "Upload");
     void EndSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool);
 
     void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
-    /// Returns queue family indices on given GPU
+    /// Returns queue family indices on given GPU.
+    /// Presentation support is not queried, if surface is VK_NULL_HANDLE.
     QueueFamilyIndices GetQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 
     /// Fills debug messenger creation structure.
@@ -125,6 +132,7 @@ namespace vkc
         VkDescriptorSet *sets,
         uint32_t count = 1);
 
+    /// Depth format, which can be both rendered to and sampled
     VkFormat FindDepthFormat();
 
     bool HasStencilComponent(VkFormat format);
@@ -178,6 +186,9 @@ namespace vkc
 
     uint32_t ChooseMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+    /// Same as ChooseMemoryType, but lets the caller fall back to other properties
+    bool TryChooseMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& typeIndex);
+
     void CreateSemaphores(VkSemaphore *semaphores, uint32_t count = 1);
 
     void CreateFences(VkFence *fences, uint32_t count = 1);
@@ -189,6 +200,8 @@ namespace vkc
         VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT);
 
     VkSampler CreateSampler();
+    /// Nearest and clamped, for fetching depth
+    VkSampler CreateDepthSampler();
 
     VkDescriptorSetLayout CreateDescriptorSetLayout(
         const std::vector<VkDescriptorSetLayoutBinding>& bindings);
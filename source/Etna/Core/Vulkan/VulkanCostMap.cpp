@@ -0,0 +1,163 @@
+#include "VulkanCostMap.h"
+#include "VulkanRenderer.h"
+#include "VulkanContext.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/Utils.h"
+
+#include <cstring>
+
+namespace vkc
+{
+    static constexpr VkFormat CostFormat = VK_FORMAT_R32_UINT;
+
+    CostMap::CostMap(Renderer& renderer)
+        : Owner(renderer)
+    {
+        if (!Context::SupportsFragmentStores())
+        {
+            Error("Cost map needs fragment shader stores.");
+        }
+
+        // Same size as the depth buffer, so any render area fits
+        VkExtent2D extent = Owner.GetDepthBuffer().GetExtent();
+        CreateImage2D(
+            extent.width, extent.height,
+            CostFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Image, ImageMemory
+        );
+        ImageView = CreateImageView(Image, CostFormat);
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(Context::GetPhysicalDevice(), &properties);
+        VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+        TotalsRegionBytes = (sizeof(ShaderTotals) + alignment - 1) / alignment * alignment;
+
+        uint32_t framesCount = Owner.GetFramesCount();
+        CreateBuffer(
+            TotalsRegionBytes * framesCount,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            Totals, TotalsMemory
+        );
+        void* mapped;
+        vkMapMemory(Context::GetDevice(), TotalsMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        TotalsMapped = static_cast<uint8_t*>(mapped);
+        memset(TotalsMapped, 0, TotalsRegionBytes * framesCount);
+        TotalsWritten.assign(framesCount, false);
+
+        // Totals are dynamic, so one set serves every frame in flight
+        Layout = DescriptorSetLayout::Builder()
+            .AddBinding(0, DescriptorType::StorageImage, ShaderStage::Fragment)
+            .AddBinding(1, DescriptorType::StorageBufferDynamic, ShaderStage::Fragment)
+            .Build();
+    }
+
+    CostMap::~CostMap()
+    {
+        VkDevice device = Context::GetDevice();
+        auto allocator = Context::GetAllocator();
+
+        vkDestroyBuffer(device, Totals, allocator);
+        vkFreeMemory(device, TotalsMemory, allocator);
+
+        vkDestroyImageView(device, ImageView, allocator);
+        vkDestroyImage(device, Image, allocator);
+        vkFreeMemory(device, ImageMemory, allocator);
+
+        vkDestroyDescriptorSetLayout(device, Layout->Handle, allocator);
+    }
+
+    void CostMap::Update()
+    {
+        PROFILE_FUNCTION();
+
+        uint32_t frameIndex = Owner.GetCurrentFrame();
+        ReadTotals(frameIndex);
+
+        // Earlier frames wrote the image, its old counts are discarded
+        VkImage image = Image;
+        Owner.EnqueueCommands(CommandStage::BeforePasses,
+            [image](VkCommandBuffer commandBuffer, uint32_t)
+            {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+                VkClearColorValue zero = {};
+                vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL, &zero, 1, &barrier.subresourceRange);
+
+                barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+            });
+
+        // Totals of this frame are read when its fence comes around again
+        VkBuffer totals = Totals;
+        VkDeviceSize offset = frameIndex * TotalsRegionBytes;
+        Owner.EnqueueCommands(CommandStage::AfterPasses,
+            [totals, offset](VkCommandBuffer commandBuffer, uint32_t)
+            {
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = totals;
+                barrier.offset = offset;
+                barrier.size = sizeof(ShaderTotals);
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                                     0, 0, nullptr, 1, &barrier, 0, nullptr);
+            });
+        TotalsWritten[frameIndex] = true;
+    }
+
+    void CostMap::ReadTotals(uint32_t frameIndex)
+    {
+        if (!TotalsWritten[frameIndex])
+        {
+            return;
+        }
+        TotalsWritten[frameIndex] = false;
+
+        // Region is zeroed for the next use, host writes are visible to the frame's submit
+        auto totals = reinterpret_cast<ShaderTotals*>(TotalsMapped + frameIndex * TotalsRegionBytes);
+        Stats.Pixels = totals->Pixels;
+        Stats.Samples = (static_cast<uint64_t>(totals->SamplesHigh) << 32) | totals->SamplesLow;
+        Stats.Fetches = (static_cast<uint64_t>(totals->FetchesHigh) << 32) | totals->FetchesLow;
+        Stats.MaxSamples = totals->MaxSamples;
+        Stats.Frames++;
+        *totals = {};
+    }
+
+    void CostMap::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+    {
+        // Offset of the totals is supplied at bind time
+        DescriptorSetWriter writer{*Layout, Owner.GetDescriptorAllocator(), DescriptorLifetime::Cached};
+        writer.WriteImage(0, ImageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+        writer.WriteBuffer(1, Totals, 0, sizeof(ShaderTotals));
+        VkDescriptorSet set = writer.Write();
+
+        auto offset = static_cast<uint32_t>(Owner.GetCurrentFrame() * TotalsRegionBytes);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                                setIndex, 1, &set, 1, &offset);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Per-pixel cost of the raymarch, written by the instrumented fragment shaders.
+ * Every pixel's density samples and texture fetches go into an R32UI storage image,
+ * samples in the low and fetches in the high 16 bits. The image is cleared before
+ * the passes of every frame and keeps the raw counts for capture tools.
+ * Totals of the frame are added up atomically into a host visible region of
+ * the frame in flight, which is read when its fence comes around again.
+ * Samples and fetches are 64-bit, added as low and high words with a carry.
+ * Written by fragment shaders, see Context::SupportsFragmentStores.
+ */
+
+#ifndef VULKANCOSTMAP_H
+#define VULKANCOSTMAP_H
+
+#include "VulkanDescriptors.h"
+
+#include <memory>
+#include <vector>
+
+namespace vkc
+{
+    class Renderer;
+
+    struct CostMapStats
+    {
+        uint32_t Pixels;     // Pixels, whose ray took a sample
+        uint64_t Samples;    // Density samples of all of them
+        uint64_t Fetches;    // Texture fetches of all of them
+        uint32_t MaxSamples; // Of the most expensive pixel
+        uint64_t Frames;     // Frames read back so far
+    };
+
+    class CostMap
+    {
+    public:
+        /// Storage buffer of the shaders, has to match shaders/include/MarchCost.glsl
+        struct ShaderTotals
+        {
+            uint32_t Pixels;
+            uint32_t SamplesLow;
+            uint32_t SamplesHigh;
+            uint32_t FetchesLow;
+            uint32_t FetchesHigh;
+            uint32_t MaxSamples;
+        };
+
+    public:
+        /// Image covers the renderer's oversized targets, the set layout is valid right away
+        explicit CostMap(Renderer& renderer);
+        ~CostMap();
+
+        CostMap(const CostMap&) = delete;
+        CostMap& operator=(const CostMap&) = delete;
+
+        /// Read the totals of this frame in flight, record the clear of the image.
+        /// Must be called between BeginFrame and EndFrame of every frame, which draws with the set.
+        void Update();
+
+        /// Bind the set with this frame's dynamic offset
+        void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex);
+
+        [[nodiscard]] const DescriptorSetLayout& GetLayout() const { return *Layout; }
+        /// Totals of the latest frame read back
+        [[nodiscard]] const CostMapStats& GetStats() const { return Stats; }
+
+    private:
+        void ReadTotals(uint32_t frameIndex);
+
+    private:
+        Renderer& Owner;
+
+        // Always in GENERAL while the passes run
+        VkImage Image = VK_NULL_HANDLE;
+        VkDeviceMemory ImageMemory = VK_NULL_HANDLE;
+        VkImageView ImageView = VK_NULL_HANDLE;
+
+        // Host visible, a region per frame in flight bound with a dynamic offset
+        VkBuffer Totals = VK_NULL_HANDLE;
+        VkDeviceMemory TotalsMemory = VK_NULL_HANDLE;
+        uint8_t* TotalsMapped = nullptr;
+        VkDeviceSize TotalsRegionBytes = 0;
+        std::vector<bool> TotalsWritten;
+
+        std::unique_ptr<DescriptorSetLayout> Layout;
+        CostMapStats Stats = {};
+    };
+}
+
+#endif //VULKANCOSTMAP_H
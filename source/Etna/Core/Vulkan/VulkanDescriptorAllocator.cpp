@@ -0,0 +1,207 @@
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanContext.h"
+
+#include "Etna/Core/Utils.h"
+
+#include <algorithm>
+
+namespace vkc
+{
+    // Descriptors of a type per set in a pool, covers what the scenes and the GUI bind
+    static const std::vector<std::pair<VkDescriptorType, float>> PoolRatios = {
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f},
+    };
+
+    void DescriptorAllocator::Init(uint32_t framesInFlight)
+    {
+        FrameChains.resize(framesInFlight);
+        CurrentFrame = 0;
+    }
+
+    void DescriptorAllocator::Shutdown()
+    {
+        for (auto& chain : FrameChains)
+        {
+            DestroyChain(chain);
+        }
+        FrameChains.clear();
+        DestroyChain(CacheChain);
+        Cache.clear();
+    }
+
+    void DescriptorAllocator::BeginFrame(uint32_t frameIndex)
+    {
+        CurrentFrame = frameIndex;
+        ResetChain(FrameChains[frameIndex]);
+
+        uint32_t pools = static_cast<uint32_t>(CacheChain.Pools.size());
+        for (auto& chain : FrameChains)
+        {
+            pools += static_cast<uint32_t>(chain.Pools.size());
+        }
+
+        LastFrameStats = FrameStats;
+        LastFrameStats.Pools = pools;
+        FrameStats = {};
+    }
+
+    VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, DescriptorLifetime lifetime)
+    {
+        FrameStats.SetsAllocated++;
+        if (lifetime == DescriptorLifetime::Cached)
+        {
+            return Allocate(CacheChain, layout);
+        }
+        return Allocate(FrameChains[CurrentFrame], layout);
+    }
+
+    VkDescriptorSet DescriptorAllocator::FindCached(const DescriptorCacheKey& key)
+    {
+        auto cached = Cache.find(key);
+        if (cached == Cache.end())
+        {
+            return VK_NULL_HANDLE;
+        }
+        FrameStats.CacheHits++;
+        return cached->second.Set;
+    }
+
+    void DescriptorAllocator::AddCached(DescriptorCacheKey key, VkDescriptorSet set)
+    {
+        // Set has just come out of the current pool of the chain
+        Cache.emplace(std::move(key), CachedSet{set, CacheChain.Pools[CacheChain.Current]});
+    }
+
+    void DescriptorAllocator::ClearCache()
+    {
+        Cache.clear();
+        ResetChain(CacheChain);
+    }
+
+    void DescriptorAllocator::EvictCached(uint64_t handle)
+    {
+        bool freed = false;
+        std::erase_if(Cache, [handle, &freed](const auto& entry)
+        {
+            const DescriptorCacheKey& key = entry.first;
+            for (size_t word = 2; word < key.size(); word += 4)
+            {
+                if (key[word] == handle)
+                {
+                    vkFreeDescriptorSets(Context::GetDevice(), entry.second.Pool, 1, &entry.second.Set);
+                    freed = true;
+                    return true;
+                }
+            }
+            return false;
+        });
+
+        // Allocations try the chain from its first pool again, so the freed sets are reused
+        if (freed)
+        {
+            CacheChain.Current = 0;
+        }
+    }
+
+    VkDescriptorSet DescriptorAllocator::Allocate(PoolChain& chain, VkDescriptorSetLayout layout)
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        // Full pools stay in the chain until it's reset, so each one is only tried once
+        while (true)
+        {
+            bool fresh = chain.Current == chain.Pools.size();
+            if (fresh)
+            {
+                CreatePool(chain);
+            }
+
+            VkDescriptorSet set;
+            allocInfo.descriptorPool = chain.Pools[chain.Current];
+            VkResult result = vkAllocateDescriptorSets(Context::GetDevice(), &allocInfo, &set);
+            if (result == VK_SUCCESS)
+            {
+                return set;
+            }
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+            {
+                Error("Failed to allocate descriptor set.");
+            }
+
+            // Set that doesn't fit into an empty pool never will
+            if (fresh)
+            {
+                Error("Descriptor set doesn't fit into an empty descriptor pool.");
+            }
+            chain.Current++;
+        }
+    }
+
+    VkDescriptorPool DescriptorAllocator::CreatePool(PoolChain& chain)
+    {
+        uint32_t sets = std::min(chain.NextSetsPerPool, MaxSetsPerPool);
+        chain.NextSetsPerPool = sets * 2;
+
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        for (auto& [type, ratio] : PoolRatios)
+        {
+            poolSizes.push_back({type, std::max(static_cast<uint32_t>(ratio * static_cast<float>(sets)), 1u)});
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        // Only cached sets are freed one by one, frame pools are always reset whole
+        poolInfo.flags = &chain == &CacheChain ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+        poolInfo.maxSets = sets;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(Context::GetDevice(), &poolInfo, Context::GetAllocator(), &pool) != VK_SUCCESS)
+        {
+            Error("Failed to create descriptor pool.");
+        }
+        chain.Pools.push_back(pool);
+        return pool;
+    }
+
+    void DescriptorAllocator::ResetChain(PoolChain& chain)
+    {
+        for (auto pool : chain.Pools)
+        {
+            vkResetDescriptorPool(Context::GetDevice(), pool, 0);
+        }
+        chain.Current = 0;
+    }
+
+    void DescriptorAllocator::DestroyChain(PoolChain& chain)
+    {
+        for (auto pool : chain.Pools)
+        {
+            vkDestroyDescriptorPool(Context::GetDevice(), pool, Context::GetAllocator());
+        }
+        chain = {};
+    }
+
+    size_t DescriptorAllocator::KeyHash::operator()(const DescriptorCacheKey& key) const
+    {
+        // FNV-1a over the 64 bit words
+        uint64_t hash = 14695981039346656037ull;
+        for (uint64_t word : key)
+        {
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+}
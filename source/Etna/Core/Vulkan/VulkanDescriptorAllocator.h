@@ -0,0 +1,103 @@
+/*
+ * Descriptor sets without sizing pools up front.
+ * Sets come out of chains of pools, a new pool is added whenever the last one runs out.
+ * Frame sets live until the frame's fence: their pools are reset whole, never freed set by set.
+ * Cached sets are keyed by the layout and everything written into them,
+ * so writing the same resources again returns the existing set without an update.
+ * Evicted cached sets are freed back to their pools, which later sets reuse.
+ */
+
+#ifndef VULKANDESCRIPTORALLOCATOR_H
+#define VULKANDESCRIPTORALLOCATOR_H
+
+#include "VulkanHeader.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace vkc
+{
+    enum class DescriptorLifetime
+    {
+        Frame,  // Valid until the frame in flight comes around again
+        Cached, // Valid until ClearCache, shared by identical writes
+    };
+
+    /// Layout handle followed by every write: binding, buffer or view handle and two more words
+    using DescriptorCacheKey = std::vector<uint64_t>;
+
+    struct DescriptorAllocatorStats
+    {
+        uint32_t SetsAllocated; // New sets of the last frame, frame and cached ones
+        uint32_t CacheHits;     // Writes of the last frame, served by the cache
+        uint32_t Pools;         // Pools of every chain
+    };
+
+    class DescriptorAllocator
+    {
+    public:
+        /// Sets of the first pool of a chain, every next one is twice as big
+        static constexpr uint32_t InitialSetsPerPool = 64;
+        static constexpr uint32_t MaxSetsPerPool = 4096;
+
+    public:
+        DescriptorAllocator() = default;
+        ~DescriptorAllocator() = default;
+
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        void Init(uint32_t framesInFlight);
+        void Shutdown();
+
+        /// Reset pools of the frame's sets. Must be called after the frame's fence.
+        void BeginFrame(uint32_t frameIndex);
+
+        VkDescriptorSet Allocate(VkDescriptorSetLayout layout, DescriptorLifetime lifetime);
+
+        /// Null if nothing was written with the key yet
+        VkDescriptorSet FindCached(const DescriptorCacheKey& key);
+        void AddCached(DescriptorCacheKey key, VkDescriptorSet set);
+        /// Drop every cached set, when resources they point to go away. Device has to be idle.
+        void ClearCache();
+        /// Free cached sets with the buffer or view written into them, once no frame in flight uses them
+        void EvictCached(uint64_t handle);
+
+        [[nodiscard]] DescriptorAllocatorStats GetStats() const { return LastFrameStats; }
+
+    private:
+        struct PoolChain
+        {
+            std::vector<VkDescriptorPool> Pools;
+            uint32_t Current = 0;
+            uint32_t NextSetsPerPool = InitialSetsPerPool;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const DescriptorCacheKey& key) const;
+        };
+
+        struct CachedSet
+        {
+            VkDescriptorSet Set;
+            VkDescriptorPool Pool;
+        };
+
+        VkDescriptorSet Allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+        VkDescriptorPool CreatePool(PoolChain& chain);
+        void ResetChain(PoolChain& chain);
+        void DestroyChain(PoolChain& chain);
+
+    private:
+        uint32_t CurrentFrame = 0;
+        std::vector<PoolChain> FrameChains;
+        PoolChain CacheChain;
+        std::unordered_map<DescriptorCacheKey, CachedSet, KeyHash> Cache;
+
+        DescriptorAllocatorStats FrameStats = {};
+        DescriptorAllocatorStats LastFrameStats = {};
+    };
+}
+
+#endif //VULKANDESCRIPTORALLOCATOR_H
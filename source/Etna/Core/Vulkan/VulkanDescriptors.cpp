@@ -102,13 +102,21 @@ namespace vkc
 
     DescriptorSetWriter::DescriptorSetWriter(DescriptorSetLayout &layout, DescriptorSetPool &pool)
         : Layout(layout)
-        , Pool(pool)
     {
-        Set = Pool.AllocateSet(Layout);
+        Set = pool.AllocateSet(Layout);
         ImageInfos.reserve(16); // -_-
         BufferInfos.reserve(16);
     }
 
+    DescriptorSetWriter::DescriptorSetWriter(DescriptorSetLayout &layout, DescriptorAllocator &allocator, DescriptorLifetime lifetime)
+        : Layout(layout)
+        , Allocator(&allocator)
+        , Lifetime(lifetime)
+    {
+        ImageInfos.reserve(16);
+        BufferInfos.reserve(16);
+    }
+
     DescriptorSetWriter &DescriptorSetWriter::WriteBuffer(
         uint32_t binding,
         VkBuffer buffer,
@@ -143,7 +151,8 @@ namespace vkc
     DescriptorSetWriter& DescriptorSetWriter::WriteImage(
         uint32_t binding,
         VkImageView view,
-        VkSampler sampler)
+        VkSampler sampler,
+        VkImageLayout layout)
     {
         auto pLayoutBinding = Layout.Bindings.find(binding);
         if (pLayoutBinding == Layout.Bindings.end())
@@ -152,7 +161,7 @@ namespace vkc
         }
 
         VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageLayout = layout;
         imageInfo.imageView = view;
         imageInfo.sampler = sampler;
         ImageInfos.push_back(imageInfo);
@@ -172,8 +181,55 @@ namespace vkc
 
     VkDescriptorSet DescriptorSetWriter::Write()
     {
+        if (Allocator)
+        {
+            if (Lifetime == DescriptorLifetime::Cached)
+            {
+                auto key = BuildCacheKey();
+                if (VkDescriptorSet cached = Allocator->FindCached(key))
+                {
+                    return cached;
+                }
+                Set = Allocator->Allocate(Layout.Handle, Lifetime);
+                Allocator->AddCached(std::move(key), Set);
+            }
+            else
+            {
+                Set = Allocator->Allocate(Layout.Handle, Lifetime);
+            }
+
+            for (auto& writeSet : WriteSets)
+            {
+                writeSet.dstSet = Set;
+            }
+        }
+
         vkUpdateDescriptorSets(Context::GetDevice(), WriteSets.size(), WriteSets.data(), 0, nullptr);
 
         return Set;
     }
+
+    DescriptorCacheKey DescriptorSetWriter::BuildCacheKey() const
+    {
+        DescriptorCacheKey key;
+        key.reserve(1 + WriteSets.size() * 4);
+        key.push_back(reinterpret_cast<uint64_t>(Layout.Handle));
+        for (auto& writeSet : WriteSets)
+        {
+            key.push_back(writeSet.dstBinding);
+            if (writeSet.pBufferInfo)
+            {
+                key.push_back(reinterpret_cast<uint64_t>(writeSet.pBufferInfo->buffer));
+                key.push_back(writeSet.pBufferInfo->offset);
+                key.push_back(writeSet.pBufferInfo->range);
+            }
+            else
+            {
+                key.push_back(reinterpret_cast<uint64_t>(writeSet.pImageInfo->imageView));
+                key.push_back(reinterpret_cast<uint64_t>(writeSet.pImageInfo->sampler));
+                key.push_back(writeSet.pImageInfo->imageLayout);
+            }
+        }
+        return key;
+    }
 }
\ No newline at end of file
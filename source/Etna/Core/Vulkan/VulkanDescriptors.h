@@ -2,6 +2,8 @@
 #define VULKANDESCRIPTORS_H
 
 #include "VulkanCore.h"
+#include "VulkanDescriptorAllocator.h"
+
 #include <memory>
 #include <map>
 
@@ -53,20 +55,28 @@ namespace vkc
     {
     public:
         DescriptorSetWriter(vkc::DescriptorSetLayout& layout, vkc::DescriptorSetPool& pool);
+        /// Set is allocated on Write, cached sets are only allocated and updated on a cache miss
+        DescriptorSetWriter(vkc::DescriptorSetLayout& layout, vkc::DescriptorAllocator& allocator, DescriptorLifetime lifetime);
 
         DescriptorSetWriter& WriteBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
-        DescriptorSetWriter& WriteImage(uint32_t binding, VkImageView view, VkSampler sampler);
+        /// Layout the image is in while the set is used, e.g. a depth buffer read during a pass
+        DescriptorSetWriter& WriteImage(uint32_t binding, VkImageView view, VkSampler sampler,
+                                        VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
         VkDescriptorSet Write();
 
+    private:
+        DescriptorCacheKey BuildCacheKey() const;
+
     private:
         std::vector<VkDescriptorBufferInfo> BufferInfos;
         std::vector<VkDescriptorImageInfo> ImageInfos;
         std::vector<VkWriteDescriptorSet> WriteSets;
-        VkDescriptorSet Set;
+        VkDescriptorSet Set = VK_NULL_HANDLE;
 
         vkc::DescriptorSetLayout& Layout;
-        vkc::DescriptorSetPool& Pool;
+        vkc::DescriptorAllocator* Allocator = nullptr;
+        DescriptorLifetime Lifetime = DescriptorLifetime::Frame;
     };
 }
 
@@ -4,6 +4,7 @@
 #include "VulkanContext.h"
 #include "Etna/Core/Utils.h"
 
+#include <cstring>
 #include <set>
 
 namespace vkc
@@ -20,6 +21,14 @@ namespace vkc
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
+    // Headless devices (lavapipe on render nodes) are not asked for a swapchain
+    static const std::vector<const char*> HeadlessDeviceExtensions = {};
+
+    static const std::vector<const char*>& GetDeviceExtensions()
+    {
+        return Context::IsHeadless() ? HeadlessDeviceExtensions : DeviceExtensions;
+    }
+
     Device DeviceBuilder::Build()
     {
         Device device{};
@@ -69,9 +78,12 @@ namespace vkc
             QueueFamilyIndices indices = GetQueueFamilies(device.Physical, surface);
             std::set<uint32_t> queueFamilyIndices = {
                 indices.GraphicsFamily.value(),
-                indices.PresentationFamily.value(),
                 indices.TransferFamily.value()
             };
+            if (indices.PresentationFamily.has_value())
+            {
+                queueFamilyIndices.insert(indices.PresentationFamily.value());
+            }
             std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
             float priority = 1.0f;
@@ -86,16 +98,43 @@ namespace vkc
                 queueCreateInfos.push_back(queueCreateInfo);
             }
 
+            auto extensions = GetDeviceExtensions();
+
+            // Optional, bindless textures fall back to a set per texture without it
+            bool needsExtension = false;
+            device.DescriptorIndexing = CheckDescriptorIndexingSupport(device.Physical, needsExtension);
+            if (device.DescriptorIndexing && needsExtension)
+            {
+                // Maintenance3 is a dependency of the extension
+                extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+                extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            }
+
+            VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+            indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+            indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
             VkDeviceCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+            createInfo.pNext = device.DescriptorIndexing ? &indexingFeatures : nullptr;
             createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
             createInfo.pQueueCreateInfos = queueCreateInfos.data();
-            createInfo.enabledExtensionCount = static_cast<uint32_t>(DeviceExtensions.size());
-            createInfo.ppEnabledExtensionNames = DeviceExtensions.data();
+            createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+            createInfo.ppEnabledExtensionNames = extensions.data();
             createInfo.enabledLayerCount = 0;
 
+            VkPhysicalDeviceFeatures supportedFeatures{};
+            vkGetPhysicalDeviceFeatures(device.Physical, &supportedFeatures);
+            device.FragmentStores = supportedFeatures.fragmentStoresAndAtomics;
+            device.PipelineStatistics = supportedFeatures.pipelineStatisticsQuery;
+
             VkPhysicalDeviceFeatures deviceFeatures{};
             deviceFeatures.samplerAnisotropy = VK_TRUE;
+            deviceFeatures.fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics;
+            deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+            // Bindless fragment shader indexes the table with a dynamically uniform index
+            deviceFeatures.shaderSampledImageArrayDynamicIndexing = device.DescriptorIndexing ? VK_TRUE : VK_FALSE;
 
             createInfo.pEnabledFeatures = &deviceFeatures;
 
@@ -106,7 +145,11 @@ namespace vkc
 
             vkGetDeviceQueue(device.Logical, indices.TransferFamily.value(), 0, &device.TransferQueue);
             vkGetDeviceQueue(device.Logical, indices.GraphicsFamily.value(), 0, &device.GraphicsQueue);
-            vkGetDeviceQueue(device.Logical, indices.PresentationFamily.value(), 0, &device.PresentationQueue);
+            device.PresentationQueue = VK_NULL_HANDLE;
+            if (indices.PresentationFamily.has_value())
+            {
+                vkGetDeviceQueue(device.Logical, indices.PresentationFamily.value(), 0, &device.PresentationQueue);
+            }
         }
 
         return device;
@@ -120,7 +163,8 @@ namespace vkc
         std::vector<VkExtensionProperties> availableExtensions(extensionsCount);
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, availableExtensions.data());
 
-        std::set<std::string> requiredExtensions(DeviceExtensions.begin(), DeviceExtensions.end());
+        auto& extensions = GetDeviceExtensions();
+        std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
         for (const auto& extension : availableExtensions)
         {
@@ -130,12 +174,58 @@ namespace vkc
         return requiredExtensions.empty();
     }
 
+    bool DeviceBuilder::CheckDescriptorIndexingSupport(VkPhysicalDevice device, bool& needsExtension)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+
+        // Core since 1.2, older devices need the extension
+        needsExtension = properties.apiVersion < VK_API_VERSION_1_2;
+        if (needsExtension)
+        {
+            uint32_t extensionsCount = 0;
+            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+            std::vector<VkExtensionProperties> availableExtensions(extensionsCount);
+            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, availableExtensions.data());
+
+            bool foundIndexing = false;
+            bool foundMaintenance = false;
+            for (const auto& extension : availableExtensions)
+            {
+                foundIndexing |= strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+                foundMaintenance |= strcmp(extension.extensionName, VK_KHR_MAINTENANCE3_EXTENSION_NAME) == 0;
+            }
+            if (!foundIndexing || !foundMaintenance)
+            {
+                return false;
+            }
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return features.features.shaderSampledImageArrayDynamicIndexing
+            && indexingFeatures.descriptorBindingPartiallyBound
+            && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+    }
+
     bool DeviceBuilder::CheckDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
     {
         // Check whether needed queues are supported
         auto indices = GetQueueFamilies(device, surface);
 
         bool extensionsSupported = CheckDeviceExtensionsSupport(device);
+
+        // Graphics and compute are enough to render offscreen
+        if (surface == VK_NULL_HANDLE)
+        {
+            return extensionsSupported && indices.IsValid();
+        }
+
         bool swapChainAdequate = false;
         if (extensionsSupported)
         {
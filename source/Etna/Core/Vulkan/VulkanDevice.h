@@ -24,6 +24,13 @@ namespace vkc
         VkQueue             TransferQueue;
         VkQueue             GraphicsQueue;
         VkQueue             PresentationQueue;
+
+        // Partially bound, update after bind sampled image arrays are enabled
+        bool                DescriptorIndexing = false;
+        // Fragment shaders may write storage buffers, e.g. streaming feedback
+        bool                FragmentStores = false;
+        // Pipeline statistics queries, e.g. fragment shader invocations per pass
+        bool                PipelineStatistics = false;
     };
 
     /*
@@ -42,6 +49,7 @@ namespace vkc
     private:
         bool CheckDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
         bool CheckDeviceExtensionsSupport(VkPhysicalDevice device);
+        bool CheckDescriptorIndexingSupport(VkPhysicalDevice device, bool& needsExtension);
     };
 }
 
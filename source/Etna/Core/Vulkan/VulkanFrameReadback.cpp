@@ -0,0 +1,284 @@
+#include "VulkanFrameReadback.h"
+#include "VulkanContext.h"
+#include "VulkanCore.h"
+
+#include "Etna/Core/Utils.h"
+#include "Etna/Core/Profiler.h"
+
+#include <algorithm>
+
+namespace vkc
+{
+    void FrameReadback::Init(uint32_t framesInFlight, VkExtent2D maxExtent, VkFormat format)
+    {
+        FramesInFlight = framesInFlight;
+        MaxExtent = maxExtent;
+        Format = format;
+    }
+
+    void FrameReadback::Shutdown()
+    {
+        Flush();
+        Worker.reset();
+        Sink.reset();
+
+        for (uint32_t i = 0; i < SlotCount; i++)
+        {
+            vkUnmapMemory(Context::GetDevice(), Slots[i].Memory);
+            vkDestroyBuffer(Context::GetDevice(), Slots[i].Buffer, Context::GetAllocator());
+            vkFreeMemory(Context::GetDevice(), Slots[i].Memory, Context::GetAllocator());
+        }
+        Slots.reset();
+        SlotCount = 0;
+    }
+
+    void FrameReadback::SetSink(std::unique_ptr<FrameSink> sink)
+    {
+        if (Sink)
+        {
+            vkDeviceWaitIdle(Context::GetDevice());
+            Flush();
+        }
+
+        Sink = std::move(sink);
+        if (Sink && !Slots)
+        {
+            AllocateSlots();
+            Worker = std::make_unique<ThreadPool>(1);
+        }
+    }
+
+    void FrameReadback::AllocateSlots()
+    {
+        VkDevice device = Context::GetDevice();
+        VkDeviceSize size = static_cast<VkDeviceSize>(MaxExtent.width) * MaxExtent.height * 4;
+
+        SlotCount = FramesInFlight + ExtraSlots;
+        Slots = std::make_unique<Slot[]>(SlotCount);
+        for (uint32_t i = 0; i < SlotCount; i++)
+        {
+            auto& slot = Slots[i];
+
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = size;
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateBuffer(device, &bufferInfo, Context::GetAllocator(), &slot.Buffer) != VK_SUCCESS)
+            {
+                Error("Failed to create readback buffer.");
+            }
+
+            VkMemoryRequirements requirements;
+            vkGetBufferMemoryRequirements(device, slot.Buffer, &requirements);
+
+            // CPU reads every byte, so cached memory is worth an explicit invalidate
+            uint32_t typeIndex;
+            if (TryChooseMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, typeIndex))
+            {
+                Coherent = true;
+            }
+            else if (TryChooseMemoryType(requirements.memoryTypeBits,
+                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, typeIndex))
+            {
+                Coherent = false;
+            }
+            else
+            {
+                if (i == 0)
+                {
+                    Warning("No host cached memory, frame readback will be slow.");
+                }
+                typeIndex = ChooseMemoryType(requirements.memoryTypeBits,
+                                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+                Coherent = true;
+            }
+
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = requirements.size;
+            allocInfo.memoryTypeIndex = typeIndex;
+            if (vkAllocateMemory(device, &allocInfo, Context::GetAllocator(), &slot.Memory) != VK_SUCCESS)
+            {
+                Error("Failed to allocate readback memory.");
+            }
+            vkBindBufferMemory(device, slot.Buffer, slot.Memory, 0);
+
+            void* mapped;
+            if (vkMapMemory(device, slot.Memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+            {
+                Error("Failed to map readback memory.");
+            }
+            slot.Mapped = static_cast<uint8_t*>(mapped);
+        }
+    }
+
+    void FrameReadback::BeginFrame(uint32_t frameIndex)
+    {
+        for (uint32_t i = 0; i < SlotCount; i++)
+        {
+            auto& slot = Slots[i];
+            if (slot.State.load() == SlotState::Pending && slot.FrameIndex == frameIndex)
+            {
+                Deliver(slot);
+            }
+        }
+    }
+
+    void FrameReadback::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkImage image, VkRect2D area)
+    {
+        uint64_t frameNumber = FrameNumber++;
+
+        Slot* slot = FindFreeSlot();
+        if (!slot && Lossless)
+        {
+            // Pending slots are at most frames in flight, so the rest is on the worker and frees up soon
+            PROFILE_SCOPE("WaitForSink");
+            Waits++;
+            std::unique_lock lock(FreedMutex);
+            Freed.wait(lock, [&]() { return (slot = FindFreeSlot()) != nullptr; });
+        }
+
+        // Sink is behind, the frame is skipped rather than stalling the GPU
+        if (!slot)
+        {
+            Dropped++;
+            return;
+        }
+
+        area.extent.width = std::min(area.extent.width, MaxExtent.width);
+        area.extent.height = std::min(area.extent.height, MaxExtent.height);
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier
+        );
+
+        VkBufferImageCopy copyRegion{};
+        copyRegion.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        copyRegion.imageOffset = {area.offset.x, area.offset.y, 0};
+        copyRegion.imageExtent = {area.extent.width, area.extent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->Buffer, 1, &copyRegion);
+
+        // Back to the layout the GUI samples it in
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+
+        VkBufferMemoryBarrier hostBarrier{};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        hostBarrier.buffer = slot->Buffer;
+        hostBarrier.offset = 0;
+        hostBarrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+            0, 0, nullptr, 1, &hostBarrier, 1, &barrier
+        );
+
+        slot->FrameIndex = frameIndex;
+        slot->FrameNumber = frameNumber;
+        slot->Extent = area.extent;
+        slot->State = SlotState::Pending;
+        Captured++;
+    }
+
+    FrameReadback::Slot* FrameReadback::FindFreeSlot()
+    {
+        for (uint32_t i = 0; i < SlotCount; i++)
+        {
+            auto& candidate = Slots[(NextSlot + i) % SlotCount];
+            if (candidate.State.load() == SlotState::Free)
+            {
+                NextSlot = (NextSlot + i + 1) % SlotCount;
+                return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    void FrameReadback::Deliver(Slot& slot)
+    {
+        if (!Coherent)
+        {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = slot.Memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(Context::GetDevice(), 1, &range);
+        }
+
+        slot.State = SlotState::Consuming;
+
+        FrameData frame{};
+        frame.FrameNumber = slot.FrameNumber;
+        frame.Width = slot.Extent.width;
+        frame.Height = slot.Extent.height;
+        frame.Pixels = slot.Mapped;
+        frame.Bgra = Format == VK_FORMAT_B8G8R8A8_UNORM || Format == VK_FORMAT_B8G8R8A8_SRGB;
+        frame.Srgb = Format == VK_FORMAT_R8G8B8A8_SRGB || Format == VK_FORMAT_B8G8R8A8_SRGB;
+
+        FrameSink* sink = Sink.get();
+        Worker->Submit([this, &slot, sink, frame]()
+        {
+            PROFILE_SCOPE("ConsumeFrame");
+            sink->Consume(frame);
+            Delivered++;
+            {
+                std::lock_guard lock(FreedMutex);
+                slot.State = SlotState::Free;
+            }
+            Freed.notify_one();
+        });
+    }
+
+    void FrameReadback::Flush()
+    {
+        if (!Worker)
+        {
+            return;
+        }
+
+        // Sink sees frames in order, whichever slots they landed in
+        std::vector<Slot*> pending;
+        for (uint32_t i = 0; i < SlotCount; i++)
+        {
+            if (Slots[i].State.load() == SlotState::Pending)
+            {
+                pending.push_back(&Slots[i]);
+            }
+        }
+        std::sort(pending.begin(), pending.end(), [](const Slot* a, const Slot* b) { return a->FrameNumber < b->FrameNumber; });
+        for (Slot* slot : pending)
+        {
+            Deliver(*slot);
+        }
+
+        // Single worker runs tasks in order, so this one is the last
+        Worker->Submit([]() {}).wait();
+    }
+
+    FrameReadbackStats FrameReadback::GetStats() const
+    {
+        return {Captured.load(), Delivered.load(), Dropped.load(), Waits.load()};
+    }
+}
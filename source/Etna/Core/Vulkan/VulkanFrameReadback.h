@@ -0,0 +1,121 @@
+/*
+ * Asynchronous readback of rendered frames.
+ * Copy of the viewport target is recorded at the end of the frame's command buffer
+ * into one of a ring of persistently mapped host buffers. When the frame's fence
+ * is waited for again, the buffer goes to a worker thread, which feeds it to the sink.
+ * Nothing ever waits: if every buffer is still busy, the frame is dropped and counted.
+ * Lossless mode waits for the sink instead, which offline rendering relies on.
+ */
+
+#ifndef VULKANFRAMEREADBACK_H
+#define VULKANFRAMEREADBACK_H
+
+#include "VulkanHeader.h"
+
+#include "Etna/Core/FrameSink.h"
+#include "Etna/Core/ThreadPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vkc
+{
+    struct FrameReadbackStats
+    {
+        uint64_t Captured;  // Copies recorded
+        uint64_t Delivered; // Frames consumed by the sink
+        uint64_t Dropped;   // Frames skipped, because no buffer was free
+        uint64_t Waits;     // Times a lossless readback waited for the sink
+    };
+
+    class FrameReadback
+    {
+    public:
+        /// Slots beyond the frames in flight, they absorb a slow sink
+        static constexpr uint32_t ExtraSlots = 2;
+
+    public:
+        FrameReadback() = default;
+        ~FrameReadback() = default;
+
+        FrameReadback(const FrameReadback&) = delete;
+        FrameReadback& operator=(const FrameReadback&) = delete;
+
+        /// Buffers are allocated lazily, once there is a sink
+        void Init(uint32_t framesInFlight, VkExtent2D maxExtent, VkFormat format);
+        void Shutdown();
+
+        /// Start streaming frames into the sink, null stops it.
+        /// Frames already read back are delivered to the previous sink first.
+        void SetSink(std::unique_ptr<FrameSink> sink);
+        [[nodiscard]] bool IsActive() const { return Sink != nullptr; }
+
+        /// Wait for the sink to free a buffer instead of dropping the frame.
+        /// Never waits for the GPU, there are more buffers than frames in flight.
+        void SetLossless(bool lossless) { Lossless = lossless; }
+
+        /// Hand frames, which were recorded on this slot, to the worker.
+        /// Must be called after the slot's fence.
+        void BeginFrame(uint32_t frameIndex);
+
+        /// Record a copy of the image's area. Image must be in READ_ONLY_OPTIMAL, as render passes leave it,
+        /// and stays in it afterwards.
+        void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkImage image, VkRect2D area);
+
+        /// Deliver everything in flight and wait for the sink. Device has to be idle.
+        void Flush();
+
+        [[nodiscard]] FrameReadbackStats GetStats() const;
+
+    private:
+        enum class SlotState : uint32_t
+        {
+            Free,
+            Pending,    // Copy is submitted
+            Consuming,  // Worker owns it
+        };
+
+        struct Slot
+        {
+            VkBuffer Buffer = VK_NULL_HANDLE;
+            VkDeviceMemory Memory = VK_NULL_HANDLE;
+            uint8_t* Mapped = nullptr;
+
+            std::atomic<SlotState> State = SlotState::Free;
+            uint32_t FrameIndex = 0;
+            uint64_t FrameNumber = 0;
+            VkExtent2D Extent = {};
+        };
+
+        void AllocateSlots();
+        Slot* FindFreeSlot();
+        void Deliver(Slot& slot);
+
+    private:
+        uint32_t FramesInFlight = 0;
+        VkExtent2D MaxExtent = {};
+        VkFormat Format = VK_FORMAT_UNDEFINED;
+        bool Coherent = true;
+        bool Lossless = false;
+
+        std::unique_ptr<Slot[]> Slots;
+        uint32_t SlotCount = 0;
+        uint32_t NextSlot = 0;
+        uint64_t FrameNumber = 0;
+
+        std::unique_ptr<FrameSink> Sink;
+        std::unique_ptr<ThreadPool> Worker;
+        std::mutex FreedMutex;
+        std::condition_variable Freed;
+
+        std::atomic<uint64_t> Captured = 0;
+        std::atomic<uint64_t> Delivered = 0;
+        std::atomic<uint64_t> Dropped = 0;
+        std::atomic<uint64_t> Waits = 0;
+    };
+}
+
+#endif //VULKANFRAMEREADBACK_H
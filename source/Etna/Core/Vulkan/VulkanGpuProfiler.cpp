@@ -0,0 +1,461 @@
+#include "VulkanGpuProfiler.h"
+
+#include "Etna/Core/Utils.h"
+#include "VulkanContext.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+
+namespace vkc
+{
+    static uint64_t ValidBitsMask(uint32_t validBits)
+    {
+        return validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+    }
+
+    void GpuProfiler::Init(uint32_t framesInFlight, uint32_t graphicsFamily, uint32_t transferFamily)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(Context::GetPhysicalDevice(), &properties);
+        TimestampPeriod = properties.limits.timestampPeriod;
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(Context::GetPhysicalDevice(), &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(Context::GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+        uint32_t validBits = queueFamilies[graphicsFamily].timestampValidBits;
+        Enabled = validBits > 0;
+        TimestampMask = ValidBitsMask(validBits);
+
+        // Query reset has to be recorded, which transfer-only queues can't do
+        const auto& transferQueue = queueFamilies[transferFamily];
+        UploadsEnabled = transferQueue.timestampValidBits > 0 &&
+                         (transferQueue.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+        UploadMask = ValidBitsMask(transferQueue.timestampValidBits);
+
+        // Labels don't need timestamps, so they stay on even without the query pools
+        CmdBeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetInstanceProcAddr(Context::GetInstance(), "vkCmdBeginDebugUtilsLabelEXT");
+        CmdEndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetInstanceProcAddr(Context::GetInstance(), "vkCmdEndDebugUtilsLabelEXT");
+
+        Context::SetGpuProfiler(this);
+
+        if (!Enabled)
+        {
+            Warning("Graphics queue doesn't support timestamps, GPU profiler is disabled.");
+            UploadsEnabled = false;
+            return;
+        }
+
+        // Fragment counts are optional, timings work without them
+        StatisticsEnabled = Context::SupportsPipelineStatistics();
+
+        Frames.resize(framesInFlight);
+        for (auto& frame : Frames)
+        {
+            frame.Pool = CreateTimestampPool(2 * MaxZonesPerFrame);
+            if (StatisticsEnabled)
+            {
+                frame.StatisticsPool = CreateStatisticsPool(MaxZonesPerFrame);
+            }
+            frame.Zones.reserve(MaxZonesPerFrame);
+        }
+
+        if (UploadsEnabled)
+        {
+            UploadPool = CreateTimestampPool(2);
+        }
+    }
+
+    void GpuProfiler::Shutdown()
+    {
+        Context::SetGpuProfiler(nullptr);
+
+        for (auto& frame : Frames)
+        {
+            vkDestroyQueryPool(Context::GetDevice(), frame.Pool, Context::GetAllocator());
+            if (frame.StatisticsPool != VK_NULL_HANDLE)
+            {
+                vkDestroyQueryPool(Context::GetDevice(), frame.StatisticsPool, Context::GetAllocator());
+            }
+        }
+        Frames.clear();
+
+        if (UploadPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(Context::GetDevice(), UploadPool, Context::GetAllocator());
+            UploadPool = VK_NULL_HANDLE;
+        }
+    }
+
+    bool GpuProfiler::BeginFrame(uint32_t frameIndex)
+    {
+        CurrentFrame = frameIndex;
+        if (!Enabled)
+        {
+            return false;
+        }
+
+        auto& frame = Frames[frameIndex];
+        bool resolved = false;
+        if (frame.Recorded && frame.QueryCount > 0)
+        {
+            // Frame is N frames old and its fence has signaled, no waiting here
+            std::vector<uint64_t> timestamps(frame.QueryCount);
+            VkResult result = vkGetQueryPoolResults(
+                Context::GetDevice(), frame.Pool,
+                0, frame.QueryCount,
+                timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT);
+
+            if (result == VK_SUCCESS)
+            {
+                for (const auto& zone : frame.Zones)
+                {
+                    if (zone.EndQuery != InvalidZone)
+                    {
+                        PushSample(zone.Name, TicksToMs(timestamps[zone.BeginQuery], timestamps[zone.EndQuery]));
+                    }
+                }
+                resolved = true;
+                ResolvedFrames++;
+            }
+        }
+
+        // A single statistic is counted, so every query is one value
+        if (frame.Recorded && frame.StatisticsCount > 0)
+        {
+            std::vector<uint64_t> fragments(frame.StatisticsCount);
+            VkResult result = vkGetQueryPoolResults(
+                Context::GetDevice(), frame.StatisticsPool,
+                0, frame.StatisticsCount,
+                fragments.size() * sizeof(uint64_t), fragments.data(), sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT);
+
+            if (result == VK_SUCCESS)
+            {
+                for (const auto& zone : frame.Zones)
+                {
+                    if (zone.StatisticsQuery != InvalidZone && zone.EndQuery != InvalidZone)
+                    {
+                        auto& history = Histories[zone.Name];
+                        history.HasFragments = true;
+                        history.Fragments = fragments[zone.StatisticsQuery];
+                    }
+                }
+            }
+        }
+
+        frame.Zones.clear();
+        frame.QueryCount = 0;
+        frame.StatisticsCount = 0;
+        frame.Recorded = false;
+
+        return resolved;
+    }
+
+    void GpuProfiler::Reset(VkCommandBuffer commandBuffer)
+    {
+        if (!Enabled)
+        {
+            return;
+        }
+
+        auto& frame = Frames[CurrentFrame];
+        vkCmdResetQueryPool(commandBuffer, frame.Pool, 0, 2 * MaxZonesPerFrame);
+        if (frame.StatisticsPool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(commandBuffer, frame.StatisticsPool, 0, MaxZonesPerFrame);
+        }
+        frame.Recorded = true;
+    }
+
+    uint32_t GpuProfiler::BeginZone(VkCommandBuffer commandBuffer, const std::string& name, bool statistics)
+    {
+        BeginLabel(commandBuffer, name.c_str());
+
+        if (!Enabled)
+        {
+            return InvalidZone;
+        }
+
+        auto& frame = Frames[CurrentFrame];
+        if (frame.Zones.size() >= MaxZonesPerFrame)
+        {
+            return InvalidZone;
+        }
+
+        uint32_t query = frame.QueryCount++;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.Pool, query);
+
+        uint32_t statisticsQuery = InvalidZone;
+        if (statistics && StatisticsEnabled)
+        {
+            statisticsQuery = frame.StatisticsCount++;
+            vkCmdBeginQuery(commandBuffer, frame.StatisticsPool, statisticsQuery, 0);
+        }
+        frame.Zones.push_back({name, query, InvalidZone, statisticsQuery});
+
+        return static_cast<uint32_t>(frame.Zones.size() - 1);
+    }
+
+    void GpuProfiler::EndZone(VkCommandBuffer commandBuffer, uint32_t zone)
+    {
+        EndLabel(commandBuffer);
+
+        if (!Enabled || zone == InvalidZone)
+        {
+            return;
+        }
+
+        auto& frame = Frames[CurrentFrame];
+        if (frame.Zones[zone].StatisticsQuery != InvalidZone)
+        {
+            vkCmdEndQuery(commandBuffer, frame.StatisticsPool, frame.Zones[zone].StatisticsQuery);
+        }
+
+        uint32_t query = frame.QueryCount++;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.Pool, query);
+        frame.Zones[zone].EndQuery = query;
+    }
+
+    void GpuProfiler::BeginUpload(VkCommandBuffer commandBuffer, const char* name)
+    {
+        BeginLabel(commandBuffer, name);
+        if (!UploadsEnabled)
+        {
+            return;
+        }
+
+        UploadName = name;
+        UploadOpen = true;
+        vkCmdResetQueryPool(commandBuffer, UploadPool, 0, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, UploadPool, 0);
+    }
+
+    void GpuProfiler::EndUpload(VkCommandBuffer commandBuffer)
+    {
+        EndLabel(commandBuffer);
+        if (UploadOpen)
+        {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, UploadPool, 1);
+        }
+    }
+
+    void GpuProfiler::ResolveUpload()
+    {
+        if (!UploadOpen)
+        {
+            return;
+        }
+        UploadOpen = false;
+
+        // Queue has already been idled by the caller
+        uint64_t timestamps[2] = {};
+        VkResult result = vkGetQueryPoolResults(
+            Context::GetDevice(), UploadPool, 0, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS)
+        {
+            uint64_t ticks = (timestamps[1] - timestamps[0]) & UploadMask;
+            PushSample(UploadName, static_cast<float>(static_cast<double>(ticks) * TimestampPeriod * 1e-6));
+        }
+    }
+
+    bool GpuProfiler::GetLastMs(const std::string& name, float& ms) const
+    {
+        auto history = Histories.find(name);
+        if (history == Histories.end() || history->second.Count == 0)
+        {
+            return false;
+        }
+
+        ms = history->second.Last;
+        return true;
+    }
+
+    bool GpuProfiler::GetLastFragments(const std::string& name, uint64_t& fragments) const
+    {
+        auto history = Histories.find(name);
+        if (history == Histories.end() || !history->second.HasFragments)
+        {
+            return false;
+        }
+
+        fragments = history->second.Fragments;
+        return true;
+    }
+
+    std::vector<GpuZoneStats> GpuProfiler::GetStats() const
+    {
+        std::vector<GpuZoneStats> stats;
+        std::vector<float> sorted;
+        for (const auto& [name, history] : Histories)
+        {
+            if (history.Count == 0)
+            {
+                continue;
+            }
+
+            sorted.assign(history.Samples.begin(), history.Samples.begin() + history.Count);
+            std::sort(sorted.begin(), sorted.end());
+            auto p99Index = static_cast<size_t>(0.99f * static_cast<float>(sorted.size() - 1));
+
+            stats.push_back({
+                .Name = name,
+                .Samples = history.Count,
+                .LastMs = history.Last,
+                .MinMs = sorted.front(),
+                .AvgMs = std::accumulate(sorted.begin(), sorted.end(), 0.0f) / static_cast<float>(sorted.size()),
+                .P99Ms = sorted[p99Index],
+                .HasFragments = history.HasFragments,
+                .Fragments = history.Fragments
+            });
+        }
+
+        return stats;
+    }
+
+    void GpuProfiler::RenderTable() const
+    {
+        if (!ImGui::BeginTable("GpuProfiler", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            return;
+        }
+
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Last, ms");
+        ImGui::TableSetupColumn("Min, ms");
+        ImGui::TableSetupColumn("Avg, ms");
+        ImGui::TableSetupColumn("P99, ms");
+        ImGui::TableSetupColumn("Fragments");
+        ImGui::TableHeadersRow();
+
+        for (const auto& zone : GetStats())
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(zone.Name.c_str());
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.LastMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.MinMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.AvgMs);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.P99Ms);
+            ImGui::TableNextColumn();
+            if (zone.HasFragments)
+            {
+                ImGui::Text("%llu", static_cast<unsigned long long>(zone.Fragments));
+            }
+            else
+            {
+                ImGui::TextUnformatted("-");
+            }
+        }
+
+        ImGui::EndTable();
+    }
+
+    bool GpuProfiler::DumpCsv(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+        {
+            ErrorNoThrow("Failed to open file for GPU profile: %s", path.c_str());
+            return false;
+        }
+
+        // Fragments are left empty for zones, which don't count them
+        file << "zone,samples,last_ms,min_ms,avg_ms,p99_ms,fragments\n";
+        for (const auto& zone : GetStats())
+        {
+            file << zone.Name << ',' << zone.Samples << ','
+                 << zone.LastMs << ',' << zone.MinMs << ','
+                 << zone.AvgMs << ',' << zone.P99Ms << ',';
+            if (zone.HasFragments)
+            {
+                file << zone.Fragments;
+            }
+            file << '\n';
+        }
+
+        InfoLog("GPU profile is written to: %s", path.c_str());
+        return true;
+    }
+
+    void GpuProfiler::PushSample(const std::string& name, float ms)
+    {
+        auto& history = Histories[name];
+        if (history.Samples.empty())
+        {
+            history.Samples.resize(HistorySize);
+        }
+
+        history.Samples[history.Head] = ms;
+        history.Head = (history.Head + 1) % HistorySize;
+        history.Count = std::min(history.Count + 1, HistorySize);
+        history.Last = ms;
+    }
+
+    void GpuProfiler::BeginLabel(VkCommandBuffer commandBuffer, const char* name) const
+    {
+        if (CmdBeginLabel == nullptr)
+        {
+            return;
+        }
+
+        VkDebugUtilsLabelEXT label{};
+        label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+        label.pLabelName = name;
+        CmdBeginLabel(commandBuffer, &label);
+    }
+
+    void GpuProfiler::EndLabel(VkCommandBuffer commandBuffer) const
+    {
+        if (CmdEndLabel != nullptr)
+        {
+            CmdEndLabel(commandBuffer);
+        }
+    }
+
+    float GpuProfiler::TicksToMs(uint64_t begin, uint64_t end) const
+    {
+        uint64_t ticks = (end - begin) & TimestampMask;
+        return static_cast<float>(static_cast<double>(ticks) * TimestampPeriod * 1e-6);
+    }
+
+    VkQueryPool GpuProfiler::CreateTimestampPool(uint32_t count)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = count;
+
+        VkQueryPool pool;
+        if (vkCreateQueryPool(Context::GetDevice(), &queryPoolInfo, Context::GetAllocator(), &pool) != VK_SUCCESS)
+        {
+            Error("Failed to create timestamp query pool.");
+        }
+
+        return pool;
+    }
+
+    VkQueryPool GpuProfiler::CreateStatisticsPool(uint32_t count)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount = count;
+        queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+        VkQueryPool pool;
+        if (vkCreateQueryPool(Context::GetDevice(), &queryPoolInfo, Context::GetAllocator(), &pool) != VK_SUCCESS)
+        {
+            Error("Failed to create pipeline statistics query pool.");
+        }
+
+        return pool;
+    }
+}
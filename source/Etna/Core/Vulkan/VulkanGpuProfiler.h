@@ -0,0 +1,138 @@
+/*
+ * GPU timestamp profiler.
+ * Every frame in flight owns its own query pool, results are read
+ * when the frame's fence is waited for again, so nothing ever stalls.
+ * Zones are also wrapped into debug-utils labels, so external tools
+ * (RenderDoc, Nsight, etc.) show the same names.
+ * Zones, which ask for it, also count fragment shader invocations
+ * with a pipeline statistics query, when the device supports them.
+ */
+
+#ifndef VULKANGPUPROFILER_H
+#define VULKANGPUPROFILER_H
+
+#include "VulkanHeader.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vkc
+{
+    struct GpuZoneStats
+    {
+        std::string Name;
+        uint32_t Samples;
+        float LastMs;
+        float MinMs;
+        float AvgMs;
+        float P99Ms;
+        // Fragment shader invocations of the latest sample, if the zone counts them
+        bool HasFragments;
+        uint64_t Fragments;
+    };
+
+    class GpuProfiler
+    {
+    public:
+        static constexpr uint32_t MaxZonesPerFrame = 64;
+        static constexpr uint32_t HistorySize = 240;
+        static constexpr uint32_t InvalidZone = ~0u;
+
+    public:
+        GpuProfiler() = default;
+        ~GpuProfiler() = default;
+
+        void Init(uint32_t framesInFlight, uint32_t graphicsFamily, uint32_t transferFamily);
+        void Shutdown();
+
+        /// Collect results of the frame, previously recorded on this slot.
+        /// Must be called after the slot's fence. Returns true if new results arrived.
+        bool BeginFrame(uint32_t frameIndex);
+
+        /// Reset queries of the current frame. Has to be the first command of the frame.
+        void Reset(VkCommandBuffer commandBuffer);
+
+        /// Statistics zones must not nest, and have to end in the command buffer they began in
+        uint32_t BeginZone(VkCommandBuffer commandBuffer, const std::string& name, bool statistics = false);
+        void EndZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+        /// One-shot transfers. Results are read right after the queue idles.
+        void BeginUpload(VkCommandBuffer commandBuffer, const char* name);
+        void EndUpload(VkCommandBuffer commandBuffer);
+        void ResolveUpload();
+
+        /// Latest sample of a zone
+        [[nodiscard]] bool GetLastMs(const std::string& name, float& ms) const;
+        /// Fragment shader invocations of the latest sample of a statistics zone
+        [[nodiscard]] bool GetLastFragments(const std::string& name, uint64_t& fragments) const;
+        [[nodiscard]] std::vector<GpuZoneStats> GetStats() const;
+        [[nodiscard]] bool IsEnabled() const { return Enabled; }
+        [[nodiscard]] bool CountsFragments() const { return StatisticsEnabled; }
+        /// Number of frames, whose results were collected so far
+        [[nodiscard]] uint64_t GetResolvedFrames() const { return ResolvedFrames; }
+
+        void RenderTable() const;
+        bool DumpCsv(const std::string& path) const;
+
+    private:
+        struct Zone
+        {
+            std::string Name;
+            uint32_t BeginQuery;
+            uint32_t EndQuery;
+            uint32_t StatisticsQuery;
+        };
+
+        struct FrameQueries
+        {
+            VkQueryPool Pool = VK_NULL_HANDLE;
+            std::vector<Zone> Zones;
+            uint32_t QueryCount = 0;
+            VkQueryPool StatisticsPool = VK_NULL_HANDLE;
+            uint32_t StatisticsCount = 0;
+            bool Recorded = false;
+        };
+
+        struct History
+        {
+            std::vector<float> Samples;
+            uint32_t Head = 0;
+            uint32_t Count = 0;
+            float Last = 0.0f;
+            bool HasFragments = false;
+            uint64_t Fragments = 0;
+        };
+
+        void PushSample(const std::string& name, float ms);
+        void BeginLabel(VkCommandBuffer commandBuffer, const char* name) const;
+        void EndLabel(VkCommandBuffer commandBuffer) const;
+        [[nodiscard]] float TicksToMs(uint64_t begin, uint64_t end) const;
+
+        static VkQueryPool CreateTimestampPool(uint32_t count);
+        static VkQueryPool CreateStatisticsPool(uint32_t count);
+
+    private:
+        bool Enabled = false;
+        bool UploadsEnabled = false;
+        bool StatisticsEnabled = false;
+        float TimestampPeriod = 1.0f;
+        uint64_t TimestampMask = ~0ull;
+
+        uint32_t CurrentFrame = 0;
+        std::vector<FrameQueries> Frames;
+        uint64_t ResolvedFrames = 0;
+
+        VkQueryPool UploadPool = VK_NULL_HANDLE;
+        uint64_t UploadMask = ~0ull;
+        std::string UploadName;
+        bool UploadOpen = false;
+
+        std::map<std::string, History> Histories;
+
+        PFN_vkCmdBeginDebugUtilsLabelEXT CmdBeginLabel = nullptr;
+        PFN_vkCmdEndDebugUtilsLabelEXT CmdEndLabel = nullptr;
+    };
+}
+
+#endif //VULKANGPUPROFILER_H
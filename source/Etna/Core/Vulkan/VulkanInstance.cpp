@@ -2,6 +2,7 @@
 
 #include "Etna/Core/Utils.h"
 #include "VulkanCore.h"
+#include "VulkanContext.h"
 
 #include <cstring>
 
@@ -55,16 +56,31 @@ namespace vkc
 
     std::vector<const char*> InstanceBuilder::GetRequiredExtensions()
     {
-        uint32_t glfwExtensionsCount = 0;
-        const char** ppGlfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+        std::vector<const char*> instanceExtensions;
 
-        std::vector<const char*> instanceExtensions(ppGlfwExtensions, ppGlfwExtensions + glfwExtensionsCount);
+        // Surface extensions are of no use without a window
+        if (!Context::IsHeadless())
+        {
+            uint32_t glfwExtensionsCount = 0;
+            const char** ppGlfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+            instanceExtensions.assign(ppGlfwExtensions, ppGlfwExtensions + glfwExtensionsCount);
+        }
 
         if (c_EnableValidationLayers)
         {
             instanceExtensions.push_back("VK_EXT_debug_report");
         }
 
+        // Optional: debug labels for the GPU profiler and external tools
+        uint32_t extensionsCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionsCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensions.data());
+        if (IsExtensionAvailable(extensions, VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
+        {
+            instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        }
+
         return instanceExtensions;
     }
 
@@ -26,7 +26,7 @@ namespace vkc
 
     void Pipeline::Bind(VkCommandBuffer commandBuffer, uint32_t imageIndex)
     {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Handle);
+        vkCmdBindPipeline(commandBuffer, BindPoint, Handle);
     }
 
     PipelineBuilder& PipelineBuilder::SetVertexLayout(const vkc::VertexLayout& vertexLayout)
@@ -66,7 +66,7 @@ namespace vkc
         return *this;
     }
 
-    Pipeline PipelineBuilder::Build()
+    Pipeline PipelineBuilder::Build(VkPipelineCache cache)
     {
         auto vertexShaderModule = VertexShader(VertexShaderPath);
         auto fragmentShaderModule = FragmentShader(FragmentShaderPath);
@@ -128,7 +128,7 @@ namespace vkc
         {
             depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
             depthStencilInfo.depthTestEnable = VK_TRUE;
-            depthStencilInfo.depthWriteEnable = VK_TRUE;
+            depthStencilInfo.depthWriteEnable = DepthWritesEnabled ? VK_TRUE : VK_FALSE;
             depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
             depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
             depthStencilInfo.minDepthBounds = 0.0f; // Optional
@@ -138,15 +138,16 @@ namespace vkc
             depthStencilInfo.back = {}; // Optional
         }
 
-        // Blending is disabled
+        // Blending is disabled, unless the output is premultiplied: src + dst * (1 - src.a)
+        VkBlendFactor dstBlendFactor = BlendingEnabled ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
+        colorBlendAttachment.blendEnable = BlendingEnabled ? VK_TRUE : VK_FALSE;
         colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachment.dstColorBlendFactor = dstBlendFactor;
         colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
         colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachment.dstAlphaBlendFactor = dstBlendFactor;
         colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
         VkPipelineColorBlendStateCreateInfo colorBlendInfo{};
@@ -191,7 +192,7 @@ namespace vkc
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(Context::GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, Context::GetAllocator(), &pipeline.Handle) != VK_SUCCESS)
+        if (vkCreateGraphicsPipelines(Context::GetDevice(), cache, 1, &pipelineInfo, Context::GetAllocator(), &pipeline.Handle) != VK_SUCCESS)
         {
             Error("Failed to create graphics pipeline.");
         }
@@ -204,4 +205,68 @@ namespace vkc
         DepthTestingEnabled = flag;
         return *this;
     }
+
+    PipelineBuilder &PipelineBuilder::EnableDepthWrites(bool flag)
+    {
+        DepthWritesEnabled = flag;
+        return *this;
+    }
+
+    PipelineBuilder &PipelineBuilder::EnablePremultipliedBlending(bool flag)
+    {
+        BlendingEnabled = flag;
+        return *this;
+    }
+
+    ComputePipelineBuilder& ComputePipelineBuilder::SetComputeShader(const std::string& path)
+    {
+        ComputeShaderPath = path;
+        return *this;
+    }
+
+    ComputePipelineBuilder& ComputePipelineBuilder::AddDescriptorSetLayout(VkDescriptorSetLayout layout)
+    {
+        if (layout != VK_NULL_HANDLE)
+            DescriptorSetLayouts.push_back(layout);
+        return *this;
+    }
+
+    ComputePipelineBuilder& ComputePipelineBuilder::AddPushConstantRange(VkPushConstantRange range)
+    {
+        PushConstantRanges.push_back(range);
+        return *this;
+    }
+
+    Pipeline ComputePipelineBuilder::Build(VkPipelineCache cache)
+    {
+        auto computeShaderModule = Shader(ShaderStage::Compute, ComputeShaderPath);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(DescriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = DescriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(PushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = PushConstantRanges.data();
+
+        Pipeline pipeline;
+        pipeline.BindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+        if (vkCreatePipelineLayout(Context::GetDevice(), &pipelineLayoutInfo, Context::GetAllocator(), &pipeline.Layout) != VK_SUCCESS)
+        {
+            Error("Failed to create pipeline layout.");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = computeShaderModule.GetShaderStageCreateInfo();
+        pipelineInfo.layout = pipeline.Layout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+
+        if (vkCreateComputePipelines(Context::GetDevice(), cache, 1, &pipelineInfo, Context::GetAllocator(), &pipeline.Handle) != VK_SUCCESS)
+        {
+            Error("Failed to create compute pipeline.");
+        }
+
+        return pipeline;
+    }
 }
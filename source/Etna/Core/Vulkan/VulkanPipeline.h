@@ -34,6 +34,7 @@ namespace vkc
     public:
         VkPipeline Handle;
         VkPipelineLayout Layout;
+        VkPipelineBindPoint BindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     };
 
     class PipelineBuilder
@@ -49,12 +50,19 @@ namespace vkc
         PipelineBuilder& AddDescriptorSetLayout(VkDescriptorSetLayout layout);
         PipelineBuilder& AddPushConstantRange(VkPushConstantRange range);
         PipelineBuilder& EnableDepthTesting(bool flag);
+        /// Tested fragments write their depth, unless the attachment is read only
+        PipelineBuilder& EnableDepthWrites(bool flag);
+        /// Output is premultiplied by its alpha and composited over the target
+        PipelineBuilder& EnablePremultipliedBlending(bool flag);
         
-        Pipeline Build();
+        /// Thread safe, as long as the cache was created without external synchronization
+        Pipeline Build(VkPipelineCache cache = VK_NULL_HANDLE);
 
 
     private:
         bool DepthTestingEnabled = false;
+        bool DepthWritesEnabled = true;
+        bool BlendingEnabled = false;
         VkRenderPass RenderPass;
         VertexLayout VertexLayoutInfo;
         std::string VertexShaderPath;
@@ -62,6 +70,25 @@ namespace vkc
         ::std::vector<VkPushConstantRange> PushConstantRanges;
         ::std::vector<VkDescriptorSetLayout> DescriptorSetLayouts;
     };
+
+    class ComputePipelineBuilder
+    {
+    public:
+        ComputePipelineBuilder() = default;
+        ~ComputePipelineBuilder() = default;
+
+        ComputePipelineBuilder& SetComputeShader(const std::string& path);
+        ComputePipelineBuilder& AddDescriptorSetLayout(VkDescriptorSetLayout layout);
+        ComputePipelineBuilder& AddPushConstantRange(VkPushConstantRange range);
+
+        /// Thread safe, as long as the cache was created without external synchronization
+        Pipeline Build(VkPipelineCache cache = VK_NULL_HANDLE);
+
+    private:
+        std::string ComputeShaderPath;
+        ::std::vector<VkPushConstantRange> PushConstantRanges;
+        ::std::vector<VkDescriptorSetLayout> DescriptorSetLayouts;
+    };
 }
 
 #endif //PIPELINE_H
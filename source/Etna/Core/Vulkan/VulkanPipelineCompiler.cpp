@@ -0,0 +1,118 @@
+#include "VulkanPipelineCompiler.h"
+#include "VulkanContext.h"
+
+#include "Etna/Core/Utils.h"
+#include "Etna/Core/Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace vkc
+{
+    void PipelineCompiler::Init(uint32_t threadCount, const std::string& cachePath)
+    {
+        CachePath = cachePath;
+        LoadCache();
+
+        if (threadCount == 0)
+        {
+            threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+        Workers = std::make_unique<ThreadPool>(threadCount);
+    }
+
+    void PipelineCompiler::Shutdown()
+    {
+        if (Cache == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        // Joins the workers, after they have finished every queued build
+        Workers.reset();
+        StoreCache();
+        vkDestroyPipelineCache(Context::GetDevice(), Cache, Context::GetAllocator());
+        Cache = VK_NULL_HANDLE;
+    }
+
+    std::shared_future<Pipeline> PipelineCompiler::Submit(PipelineBuilder builder)
+    {
+        Pending++;
+        return Workers->Submit([this, builder = std::move(builder)]() mutable
+        {
+            PROFILE_SCOPE("BuildPipeline");
+
+            // Counted down on failure as well, the future carries the exception
+            struct PendingGuard
+            {
+                PipelineCompiler& Compiler;
+                ~PendingGuard()
+                {
+                    std::lock_guard lock(Compiler.IdleMutex);
+                    if (--Compiler.Pending == 0)
+                    {
+                        Compiler.Idle.notify_all();
+                    }
+                }
+            } guard{*this};
+
+            return builder.Build(Cache);
+        }).share();
+    }
+
+    void PipelineCompiler::WaitIdle()
+    {
+        PROFILE_FUNCTION();
+        std::unique_lock lock(IdleMutex);
+        Idle.wait(lock, [this]() { return Pending.load() == 0; });
+    }
+
+    void PipelineCompiler::LoadCache()
+    {
+        std::vector<char> data;
+        if (!CachePath.empty())
+        {
+            std::ifstream file(CachePath, std::ios::binary | std::ios::ate);
+            if (file)
+            {
+                data.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            }
+        }
+
+        // Driver validates the header and ignores data of another device or driver version
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = data.size();
+        cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+        if (vkCreatePipelineCache(Context::GetDevice(), &cacheInfo, Context::GetAllocator(), &Cache) != VK_SUCCESS)
+        {
+            Error("Failed to create pipeline cache.");
+        }
+    }
+
+    void PipelineCompiler::StoreCache()
+    {
+        if (CachePath.empty())
+        {
+            return;
+        }
+
+        size_t size = 0;
+        vkGetPipelineCacheData(Context::GetDevice(), Cache, &size, nullptr);
+        std::vector<char> data(size);
+        if (size == 0 || vkGetPipelineCacheData(Context::GetDevice(), Cache, &size, data.data()) != VK_SUCCESS)
+        {
+            return;
+        }
+
+        std::ofstream file(CachePath, std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), static_cast<std::streamsize>(size)))
+        {
+            Warning("Failed to store pipeline cache to %s.", CachePath.c_str());
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Pipelines are built on worker threads against one shared pipeline cache.
+ * Render passes submit their builders here and poll for the result,
+ * so adding a pass doesn't block on the driver's shader compiler.
+ * The cache is kept on disk between runs.
+ */
+
+#ifndef VULKANPIPELINECOMPILER_H
+#define VULKANPIPELINECOMPILER_H
+
+#include "VulkanPipeline.h"
+
+#include "Etna/Core/ThreadPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace vkc
+{
+    class PipelineCompiler
+    {
+    public:
+        PipelineCompiler() = default;
+        ~PipelineCompiler() = default;
+
+        PipelineCompiler(const PipelineCompiler&) = delete;
+        PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+        /// Zero threads picks one per hardware thread, leaving one for the main thread.
+        /// Empty path keeps the cache in memory only.
+        void Init(uint32_t threadCount, const std::string& cachePath);
+        /// Waits for the builds in flight, then stores the cache
+        void Shutdown();
+
+        /// Exceptions of the build are rethrown by the future
+        std::shared_future<Pipeline> Submit(PipelineBuilder builder);
+        /// Blocks until every submitted build is finished, safe to call from any thread
+        void WaitIdle();
+
+        [[nodiscard]] VkPipelineCache GetCache() const { return Cache; }
+        /// Builds submitted, but not finished yet
+        [[nodiscard]] uint32_t GetPendingCount() const { return Pending.load(); }
+
+    private:
+        void LoadCache();
+        void StoreCache();
+
+    private:
+        std::string CachePath;
+        VkPipelineCache Cache = VK_NULL_HANDLE;
+        std::unique_ptr<ThreadPool> Workers;
+        std::atomic<uint32_t> Pending = 0;
+        std::mutex IdleMutex;
+        std::condition_variable Idle;
+    };
+}
+
+#endif //VULKANPIPELINECOMPILER_H
@@ -1,13 +1,44 @@
 #include "VulkanRenderPass.h"
 
 #include "Etna/Core/Utils.h"
+#include "Etna/Core/Profiler.h"
 #include "VulkanContext.h"
 
+#include <chrono>
 #include <vector>
 
 namespace vkc
 {
-    RenderPass::RenderPass(const RenderPassCreateInfo& initInfo)
+    static void ValidatePushConstantBlocks(const std::vector<PushConstantBlock>& blocks)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(Context::GetPhysicalDevice(), &properties);
+        uint32_t maxSize = properties.limits.maxPushConstantsSize;
+
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            auto& block = blocks[i];
+            if (block.Size == 0 || block.Offset % 4 != 0 || block.Size % 4 != 0)
+            {
+                Error("Push constant block at offset %u of size %u has to be non-empty and 4 byte aligned.",
+                      block.Offset, block.Size);
+            }
+            if (block.Offset + block.Size > maxSize)
+            {
+                Error("Push constant block at offset %u of size %u exceeds the device's limit of %u bytes.",
+                      block.Offset, block.Size, maxSize);
+            }
+            for (size_t j = 0; j < i; j++)
+            {
+                if (block.Offset < blocks[j].Offset + blocks[j].Size && blocks[j].Offset < block.Offset + block.Size)
+                {
+                    Error("Push constant blocks at offsets %u and %u overlap.", blocks[j].Offset, block.Offset);
+                }
+            }
+        }
+    }
+
+    RenderPass::RenderPass(const RenderPassCreateInfo& initInfo, PipelineCompiler* compiler)
     {
         if (initInfo.Type != RenderPassType::Graphic)
         {
@@ -18,14 +49,20 @@ namespace vkc
             {.color = {{0.0f, 0.0f, 0.0f, 1.0f}}}
         };
 
+        if (initInfo.ReadOnlyDepth && (!initInfo.DepthEnabled || initInfo.StoreDepth))
+        {
+            Error("Read only depth needs depth enabled, and can't be stored again.");
+        }
+
+        // Passes leave the target in READ_ONLY_OPTIMAL, so a blending pass picks it up from there
         std::vector<VkAttachmentDescription> attachments(1);
         attachments[0].format = initInfo.TargetFormat;
         attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
-        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].loadOp = initInfo.BlendOverTarget ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].initialLayout = initInfo.BlendOverTarget ? VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         attachments[0].finalLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef{};
@@ -35,7 +72,8 @@ namespace vkc
         // Unused, when initInfo.DepthEnabled == false
         VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 1;
-        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachmentRef.layout = initInfo.ReadOnlyDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                                           : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkSubpassDescription subpass{};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -50,23 +88,34 @@ namespace vkc
             attachments.push_back({});
             attachments[1].format = FindDepthFormat();
             attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
-            attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-            attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachments[1].loadOp = initInfo.ReadOnlyDepth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachments[1].storeOp = initInfo.StoreDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
             attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
             attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-            attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            attachments[1].initialLayout = initInfo.ReadOnlyDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                                                  : VK_IMAGE_LAYOUT_UNDEFINED;
+            attachments[1].finalLayout = initInfo.StoreDepth || initInfo.ReadOnlyDepth
+                                       ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                       : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
             subpass.pDepthStencilAttachment = &depthAttachmentRef;
         }
 
+        // Passes before this one wrote the target and the depth, which this one loads, tests against or samples.
+        // Covers the depth buffer shared by the frames in flight, which the previous frame's passes sampled.
+        VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                              | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                                              | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+                                              | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         VkSubpassDependency dependency{};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.srcStageMask = attachmentStages;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask = attachmentStages;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+                                 | VK_ACCESS_SHADER_READ_BIT;
 
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -87,11 +136,27 @@ namespace vkc
             .SetVertexLayout(initInfo.VertexLayoutInfo)
             .SetVertexShader(initInfo.VertexShaderPath)
             .SetFragmentShader(initInfo.FragmentShaderPath)
-            .EnableDepthTesting(initInfo.DepthEnabled);
+            .EnableDepthTesting(initInfo.DepthEnabled)
+            .EnableDepthWrites(!initInfo.ReadOnlyDepth)
+            .EnablePremultipliedBlending(initInfo.BlendOverTarget);
         for (auto& layout : initInfo.DescriptorSetLayouts)
             pipelineBuilder.AddDescriptorSetLayout(layout);
 
-        RenderPipeline = pipelineBuilder.Build();
+        ValidatePushConstantBlocks(initInfo.PushConstantBlocks);
+        PushConstantBlocks = initInfo.PushConstantBlocks;
+        for (auto& block : PushConstantBlocks)
+            pipelineBuilder.AddPushConstantRange({block.Stages, block.Offset, block.Size});
+
+        RequiredForFirstFrame = initInfo.RequiredForFirstFrame;
+        if (compiler)
+        {
+            PendingPipeline = compiler->Submit(std::move(pipelineBuilder));
+        }
+        else
+        {
+            RenderPipeline = pipelineBuilder.Build();
+            Ready = true;
+        }
     }
 
     void RenderPass::Begin(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, VkRect2D renderArea)
@@ -106,7 +171,10 @@ namespace vkc
 
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        RenderPipeline.Bind(commandBuffer);
+        if (Ready)
+        {
+            RenderPipeline.Bind(commandBuffer);
+        }
     }
 
     void RenderPass::End(VkCommandBuffer commandBuffer)
@@ -114,8 +182,39 @@ namespace vkc
         vkCmdEndRenderPass(commandBuffer);
     }
 
+    bool RenderPass::IsReady()
+    {
+        if (!Ready && PendingPipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            TakePipeline();
+        }
+        return Ready;
+    }
+
+    void RenderPass::WaitUntilReady()
+    {
+        if (!Ready)
+        {
+            PROFILE_SCOPE("WaitForPipeline");
+            PendingPipeline.wait();
+            TakePipeline();
+        }
+    }
+
+    void RenderPass::TakePipeline()
+    {
+        RenderPipeline = PendingPipeline.get();
+        PendingPipeline = {};
+        Ready = true;
+    }
+
     VkPipelineLayout RenderPass::GetLayout() const
     {
         return RenderPipeline.Layout;
     }
+
+    const std::vector<PushConstantBlock>& RenderPass::GetPushConstantBlocks() const
+    {
+        return PushConstantBlocks;
+    }
 }
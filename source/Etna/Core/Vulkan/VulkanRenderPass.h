@@ -3,15 +3,32 @@
 
 #include "VulkanCore.h"
 #include "VulkanPipeline.h"
+#include "VulkanPipelineCompiler.h"
 #include "VulkanAttachment.h"
 #include "VulkanVertexBuffer.h"
 
+#include <future>
 #include <vector>
 #include <memory>
 #include <string>
 
 namespace vkc
 {
+    // Range of push constants, visible to the stages.
+    // Blocks of a pass must not overlap.
+    struct PushConstantBlock
+    {
+        VkShaderStageFlags Stages;
+        uint32_t Offset;
+        uint32_t Size;
+
+        template<class T>
+        static PushConstantBlock Of(VkShaderStageFlags stages, uint32_t offset = 0)
+        {
+            return {stages, offset, static_cast<uint32_t>(sizeof(T))};
+        }
+    };
+
     struct RenderPassCreateInfo
     {
         bool DepthEnabled;
@@ -21,26 +38,52 @@ namespace vkc
         std::string FragmentShaderPath;
         VertexLayout VertexLayoutInfo;
         std::vector<VkDescriptorSetLayout> DescriptorSetLayouts;
+        // Validated against maxPushConstantsSize, only 128 bytes are guaranteed
+        std::vector<PushConstantBlock> PushConstantBlocks;
+        // Renderer waits for the pipeline before recording the pass, instead of skipping it
+        bool RequiredForFirstFrame = true;
+        // Depth is kept after the pass, in DEPTH_STENCIL_READ_ONLY_OPTIMAL, for passes which follow
+        bool StoreDepth = false;
+        // Depth stored by an earlier pass is tested against without writes, so shaders can sample it as well
+        bool ReadOnlyDepth = false;
+        // Target is kept and the premultiplied output is blended over it, instead of clearing it
+        bool BlendOverTarget = false;
     };
 
     class RenderPass
     {
     public:
-        RenderPass(const RenderPassCreateInfo& initInfo);
+        /// Pipeline is built on the compiler's workers, or right away without one
+        RenderPass(const RenderPassCreateInfo& initInfo, PipelineCompiler* compiler = nullptr);
 
     public:
+        /// Pipeline is only bound once it's ready, a pass without one just clears
         void Begin(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, VkRect2D renderArea);
         void End(VkCommandBuffer commandBuffer);
 
     public:
+        /// Whether the pipeline is built. Rethrows the build's exception.
+        [[nodiscard]] bool IsReady();
+        void WaitUntilReady();
+        [[nodiscard]] bool IsRequiredForFirstFrame() const { return RequiredForFirstFrame; }
+
         [[nodiscard]] VkPipelineLayout GetLayout() const;
+        [[nodiscard]] const std::vector<PushConstantBlock>& GetPushConstantBlocks() const;
 
     public:
         VkRenderPass Handle;
 
+    private:
+        /// Move the built pipeline out of the future. Rethrows the build's exception.
+        void TakePipeline();
+
     private:
         vkc::Pipeline RenderPipeline;
+        std::shared_future<Pipeline> PendingPipeline;
+        bool Ready = false;
+        bool RequiredForFirstFrame = true;
         std::vector<VkClearValue> ClearValues;
+        std::vector<PushConstantBlock> PushConstantBlocks;
     };
 }
 
@@ -2,6 +2,7 @@
 
 #include "Etna/Core/Utils.h"
 #include "Etna/Core/ImGuiTheme.h"
+#include "Etna/Core/Profiler.h"
 
 #include "VulkanContext.h"
 #include "VulkanSwapchain.h"
@@ -10,24 +11,35 @@
 #include "backends/imgui_impl_vulkan.h"
 #include "backends/imgui_impl_glfw.h"
 
-static const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+#include <algorithm>
+#include <cmath>
 
 namespace vkc
 {
-    void Renderer::Init()
+    void Renderer::Init(const RendererCreateInfo& createInfo)
     {
-        Context::Create();
+        Context::Create(createInfo.Mode);
+        Headless = createInfo.Mode == ContextMode::Headless;
         CurrentFrame = 0;
-        MaxFramesInFlight = MAX_FRAMES_IN_FLIGHT;
-        GSwapchain = SwapchainBuilder{}.Build();
+        MaxFramesInFlight = createInfo.FramesInFlight;
+        if (!Headless)
+        {
+            GSwapchain = SwapchainBuilder{}.Build();
+        }
 
         FrameFences.resize(MaxFramesInFlight);
-        ImageAvailableSemaphores.resize(MaxFramesInFlight);
-        RenderFinishedSemaphores.resize(MaxFramesInFlight);
-
         CreateFences(FrameFences.data(), MaxFramesInFlight);
-        CreateSemaphores(ImageAvailableSemaphores.data(), MaxFramesInFlight);
-        CreateSemaphores(RenderFinishedSemaphores.data(), MaxFramesInFlight);
+        SubmittedAreas.resize(MaxFramesInFlight);
+        Retired.resize(MaxFramesInFlight);
+
+        // Headless frames are just submitted, there is no image to wait for or to present
+        if (!Headless)
+        {
+            ImageAvailableSemaphores.resize(MaxFramesInFlight);
+            RenderFinishedSemaphores.resize(MaxFramesInFlight);
+            CreateSemaphores(ImageAvailableSemaphores.data(), MaxFramesInFlight);
+            CreateSemaphores(RenderFinishedSemaphores.data(), MaxFramesInFlight);
+        }
 
         auto indices = GetQueueFamilies(Context::GetPhysicalDevice(), Context::GetSurface());
 
@@ -35,6 +47,16 @@ namespace vkc
         GraphicsCommandBuffers.resize(GetFramesCount());
         CreateCommandBuffers(GraphicsCommandPool, GraphicsCommandBuffers.data(), GetFramesCount());
 
+        Profiler.Init(GetFramesCount(), indices.GraphicsFamily.value(), indices.TransferFamily.value());
+        ActiveQuality = Governor.GetLevel();
+        Uniforms.Init(createInfo.UniformBytesPerFrame, GetFramesCount());
+        Descriptors.Init(GetFramesCount());
+        Compiler.Init(createInfo.PipelineThreads, createInfo.PipelineCachePath);
+        if (createInfo.Bindless)
+        {
+            BindlessTable.Init();
+        }
+
         // Initialize ImGui
         {
             IMGUI_CHECKVERSION();
@@ -44,6 +66,40 @@ namespace vkc
             (void) io;
             io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
             io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+
+            // No platform and renderer backends, so clients can still
+            // issue ImGui calls, which are just never drawn
+            if (Headless)
+            {
+                io.DisplaySize = ImVec2(static_cast<float>(createInfo.TargetExtent.width),
+                                        static_cast<float>(createInfo.TargetExtent.height));
+                io.DeltaTime = 1.0f / 60.0f;
+                unsigned char* fontPixels;
+                int fontWidth, fontHeight;
+                io.Fonts->GetTexDataAsRGBA32(&fontPixels, &fontWidth, &fontHeight);
+            }
+        }
+
+        // Render targets
+        {
+            GUI.ViewportExtent = createInfo.TargetExtent;
+
+            // Oversized for the maximal quality scale, so nothing is reallocated when it changes
+            float maxScale = Governor.GetSettings().MaxScale;
+            auto targetWidth = static_cast<uint32_t>(std::ceil(static_cast<float>(GUI.ViewportExtent.width) * maxScale));
+            auto targetHeight = static_cast<uint32_t>(std::ceil(static_cast<float>(GUI.ViewportExtent.height) * maxScale));
+            GUI.ViewportDepthBuffer = Texture2D::CreateDepthBuffer(targetWidth, targetHeight);
+            for (uint32_t i = 0; i < GetFramesCount(); ++i)
+            {
+                GUI.ViewportRenderTargets.emplace_back(Texture2D::CreateRenderTarget(targetWidth, targetHeight, GetTargetFormat()));
+            }
+
+            Readback.Init(GetFramesCount(), {targetWidth, targetHeight}, GetTargetFormat());
+        }
+
+        if (Headless)
+        {
+            return;
         }
 
         // GUI
@@ -71,14 +127,6 @@ namespace vkc
                 VK_NULL_HANDLE, // Do not need depth testing here
                 GUI.Framebuffers.size());
 
-            // TODO: get viewport size from window's area
-            const int vpWidth = 1280, vpHeight = 720;
-            GUI.ViewportDepthBuffer = Texture2D::CreateDepthBuffer(vpWidth, vpHeight);
-            for (uint32_t i = 0; i < GetFramesCount(); ++i)
-            {
-                GUI.ViewportRenderTargets.emplace_back(Texture2D::CreateRenderTarget(vpWidth, vpHeight, GetSwapchainImageFormat()));
-            }
-
             // Init implementations
             ImGui_ImplGlfw_InitForVulkan(Context::GetWindow(), true);
             ImGui_ImplVulkan_InitInfo init_info = {};
@@ -121,58 +169,211 @@ namespace vkc
     {
         // Shutdown ImGui
         {
-            ImGui_ImplVulkan_Shutdown();
-            ImGui_ImplGlfw_Shutdown();
+            if (!Headless)
+            {
+                ImGui_ImplVulkan_Shutdown();
+                ImGui_ImplGlfw_Shutdown();
+            }
             ImGui::DestroyContext();
         }
 
-        GSwapchain.LogStatistics();
+        if (!Headless)
+        {
+            GSwapchain.LogStatistics();
+        }
         vkDeviceWaitIdle(Context::GetDevice());
 
-        for (size_t i = 0; i < MaxFramesInFlight; i++)
+        for (auto& releases : Retired)
+        {
+            for (auto& release : releases)
+            {
+                release();
+            }
+        }
+        Retired.clear();
+
+        for (size_t i = 0; i < ImageAvailableSemaphores.size(); i++)
         {
             vkDestroySemaphore(Context::GetDevice(), ImageAvailableSemaphores[i], Context::GetAllocator());
             vkDestroySemaphore(Context::GetDevice(), RenderFinishedSemaphores[i], Context::GetAllocator());
+        }
+        for (size_t i = 0; i < MaxFramesInFlight; i++)
+        {
             vkDestroyFence(Context::GetDevice(), FrameFences[i], Context::GetAllocator());
         }
 
+        Readback.Shutdown();
+        Uniforms.Shutdown();
+        BindlessTable.Shutdown();
+        Descriptors.Shutdown();
+        Compiler.Shutdown();
+        Profiler.Shutdown();
+
         Context::Destroy();
     }
 
     void Renderer::BeginFrame()
     {
-        vkWaitForFences(Context::GetDevice(), 1, &FrameFences[CurrentFrame], VK_TRUE, UINT64_MAX);
-        vkResetFences(Context::GetDevice(), 1, &FrameFences[CurrentFrame]);
+        PROFILE_FUNCTION();
+        {
+            PROFILE_SCOPE("WaitForFence");
+            vkWaitForFences(Context::GetDevice(), 1, &FrameFences[CurrentFrame], VK_TRUE, UINT64_MAX);
+            vkResetFences(Context::GetDevice(), 1, &FrameFences[CurrentFrame]);
+        }
 
-        if(GSwapchain.AcquireNextImage(ImageAvailableSemaphores[CurrentFrame]))
+        // Every frame before the one last on this slot has been waited for by now
+        for (auto& release : Retired[CurrentFrame])
         {
-            // Recreate swapchain and stuff
+            release();
+        }
+        Retired[CurrentFrame].clear();
+
+        CollectFrameTimings();
+        // Governor's decisions and a pin made since the last frame apply from this one on
+        ActiveQuality = Governor.GetLevel();
+        Readback.BeginFrame(CurrentFrame);
+        Uniforms.BeginFrame(CurrentFrame);
+        Descriptors.BeginFrame(CurrentFrame);
+
+        if (Headless)
+        {
+            ImGui::NewFrame();
             return;
         }
 
+        {
+            PROFILE_SCOPE("AcquireNextImage");
+            if(GSwapchain.AcquireNextImage(ImageAvailableSemaphores[CurrentFrame]))
+            {
+                // Recreate swapchain and stuff
+                return;
+            }
+        }
+
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         GUI.BeginDockingSpace();
-        GUI.RenderViewport(GetCurrentFrame());
+        GUI.RenderViewport(GetCurrentFrame(), GetRenderArea());
+        RenderStatsPanel();
     }
 
     void Renderer::EndFrame()
     {
-        GUI.EndDockingSpace();
+        PROFILE_FUNCTION();
+        if (!Headless)
+        {
+            GUI.EndDockingSpace();
+        }
+        RunFrameUpdate();
         RecordCommandBuffers();
-        if (GSwapchain.PresentImage(RenderFinishedSemaphores[CurrentFrame]))
+        if (!Headless)
         {
-            // Recreate swapchain and stuff
-            return;
+            PROFILE_SCOPE("PresentImage");
+            if (GSwapchain.PresentImage(RenderFinishedSemaphores[CurrentFrame]))
+            {
+                // Recreate swapchain and stuff
+                return;
+            }
         }
 
         CurrentFrame = (CurrentFrame + 1) % MaxFramesInFlight;
     }
 
+    void Renderer::CollectFrameTimings()
+    {
+        // Results are N frames late, so reading them never blocks
+        if (Profiler.BeginFrame(CurrentFrame) && Profiler.GetLastMs("Frame", LastGpuFrameMs))
+        {
+            Governor.Update(LastGpuFrameMs);
+        }
+    }
+
+    void Renderer::RunFrameUpdate()
+    {
+        FrameUpdated = false;
+        if (!FrameUpdate)
+        {
+            return;
+        }
+
+        PROFILE_SCOPE("FrameUpdate");
+        InputSampled = std::chrono::steady_clock::now();
+        FrameUpdate(CurrentFrame);
+        FrameUpdated = true;
+    }
+
+    void Renderer::MeasureInputToSubmit()
+    {
+        if (!FrameUpdated)
+        {
+            return;
+        }
+
+        LastInputToSubmitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - InputSampled).count();
+        // Short window, so a stall still shows up in the average
+        AverageInputToSubmitMs = AverageInputToSubmitMs > 0.0f
+            ? AverageInputToSubmitMs + (LastInputToSubmitMs - AverageInputToSubmitMs) * 0.1f
+            : LastInputToSubmitMs;
+    }
+
+    void Renderer::RenderStatsPanel()
+    {
+        auto& settings = Governor.GetSettings();
+        VkRect2D area = GetRenderArea();
+
+        ImGui::Begin("Stats");
+        ImGui::Text("GPU frame: %.2f ms (avg %.2f ms, target %.2f ms)",
+                    LastGpuFrameMs, Governor.GetAverageFrameMs(), settings.TargetFrameMs);
+        ImGui::Text("Resolution scale: %.2f (%ux%u)", ActiveQuality.Scale, area.extent.width, area.extent.height);
+        ImGui::Text("Raymarch steps: %u", ActiveQuality.Steps);
+        ImGui::Text("Governor: %s", Governor.IsPinned() ? "pinned" : (Profiler.IsEnabled() ? "active" : "no timestamps"));
+        if (FrameUpdate)
+        {
+            ImGui::Text("Input to submit: %.2f ms (avg %.2f ms)", LastInputToSubmitMs, AverageInputToSubmitMs);
+        }
+        if (Readback.IsActive())
+        {
+            auto readback = Readback.GetStats();
+            ImGui::Text("Readback: %llu captured, %llu delivered, %llu dropped",
+                        static_cast<unsigned long long>(readback.Captured),
+                        static_cast<unsigned long long>(readback.Delivered),
+                        static_cast<unsigned long long>(readback.Dropped));
+        }
+
+        ImGui::Text("Uniforms: %llu KiB peak of %llu KiB",
+                    static_cast<unsigned long long>(Uniforms.GetPeakBytes() / 1024),
+                    static_cast<unsigned long long>(Uniforms.GetBytesPerFrame() / 1024));
+
+        auto descriptors = Descriptors.GetStats();
+        ImGui::Text("Descriptor sets: %u allocated, %u cache hits, %u pools",
+                    descriptors.SetsAllocated, descriptors.CacheHits, descriptors.Pools);
+
+        if (Compiler.GetPendingCount() > 0)
+        {
+            ImGui::Text("Pipelines compiling: %u", Compiler.GetPendingCount());
+        }
+
+        ImGui::SeparatorText("GPU passes");
+        Profiler.RenderTable();
+        if (ImGui::Button("Dump CSV"))
+        {
+            Profiler.DumpCsv("gpu_profile.csv");
+        }
+#if ENABLE_PROFILING
+        ImGui::SameLine();
+        if (ImGui::Button("Export CPU trace"))
+        {
+            ::Profiler::ExportChromeTrace("cpu_trace.json");
+        }
+#endif
+        ImGui::End();
+    }
+
     void Renderer::RecordCommandBuffers()
     {
+        PROFILE_FUNCTION();
         auto commandBuffer = GraphicsCommandBuffers[CurrentFrame];
 
         // Record drawing commands
@@ -184,6 +385,17 @@ namespace vkc
             Error("Failed to begin recording command buffer.");
         }
 
+        Profiler.Reset(commandBuffer);
+        // Closed at the end of the GUI command buffer
+        FrameZone = Profiler.BeginZone(commandBuffer, "Frame");
+
+        for (auto& commands : CommandsBeforePasses)
+        {
+            commands(commandBuffer, CurrentFrame);
+        }
+        CommandsBeforePasses.clear();
+
+        bool targetWritten = false;
         while (!ClientRenderQueue.empty())
         {
             auto& passName = ClientRenderQueue.front();
@@ -192,18 +404,72 @@ namespace vkc
             {
                 auto& pass = ptr->second;
                 ClientRenderQueue.pop();
+                targetWritten = true;
 
+                // Passes the frame can't do without are waited for, the rest only clear while compiling
+                if (!pass.Pass->IsReady() && pass.Pass->IsRequiredForFirstFrame())
+                {
+                    pass.Pass->WaitUntilReady();
+                }
+
+                // Passes never nest, so each of them counts its own fragments
+                uint32_t zone = Profiler.BeginZone(commandBuffer, ptr->first, true);
                 pass.Pass->Begin(commandBuffer, pass.Framebuffers[pass.CurrentFramebufferIndex], pass.Area);
-                pass.Delegate({commandBuffer, pass.Pass->GetLayout(), GSwapchain.GetCurrentImage(), CurrentFrame});
+                if (pass.Pass->IsReady())
+                {
+                    pass.Delegate({commandBuffer, pass.Pass->GetLayout(), GetSwapchainCurrentImage(), CurrentFrame,
+                                   &pass.Pass->GetPushConstantBlocks()});
+                }
                 pass.Pass->End(commandBuffer);
+                Profiler.EndZone(commandBuffer, zone);
             }
         }
 
+        for (auto& commands : CommandsAfterPasses)
+        {
+            commands(commandBuffer, CurrentFrame);
+        }
+        CommandsAfterPasses.clear();
+
+        SubmittedAreas[CurrentFrame] = GetRenderArea();
+
+        // Target's layout is only known after a render pass
+        if (Readback.IsActive() && targetWritten)
+        {
+            uint32_t zone = Profiler.BeginZone(commandBuffer, "Readback");
+            Readback.Record(commandBuffer, CurrentFrame, GUI.ViewportRenderTargets[CurrentFrame]->GetImage(), SubmittedAreas[CurrentFrame]);
+            Profiler.EndZone(commandBuffer, zone);
+        }
+
+        if (Headless)
+        {
+            Profiler.EndZone(commandBuffer, FrameZone);
+        }
+
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
         {
             Error("Failed to record command buffer.");
         }
 
+        if (Headless)
+        {
+            // Close ImGui frame, nothing is drawn
+            ImGui::Render();
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+
+            MeasureInputToSubmit();
+            PROFILE_SCOPE("QueueSubmit");
+            if (vkQueueSubmit(Context::GetGraphicsQueue(), 1, &submitInfo, FrameFences[CurrentFrame]) != VK_SUCCESS)
+            {
+                Error("Failed to submit a command.");
+            }
+            return;
+        }
+
         // Record GUI render pass
         RenderGUI();
 
@@ -223,6 +489,8 @@ namespace vkc
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
+        MeasureInputToSubmit();
+        PROFILE_SCOPE("QueueSubmit");
         if (vkQueueSubmit(Context::GetGraphicsQueue(), 1, &submitInfo, FrameFences[CurrentFrame]) != VK_SUCCESS)
         {
             Error("Failed to submit a command.");
@@ -231,7 +499,7 @@ namespace vkc
 
     void Renderer::AddRenderPass(const std::string& name, const RenderPassCreateInfo& initInfo)
     {
-        ClientRenderPassesMap.emplace(name, std::move(RenderPassContainer(initInfo)));
+        ClientRenderPassesMap.emplace(name, std::move(RenderPassContainer(initInfo, &Compiler)));
 
         auto passPtr = ClientRenderPassesMap.find(name);
         if (passPtr == ClientRenderPassesMap.end())
@@ -276,17 +544,39 @@ namespace vkc
 
     VkFormat Renderer::GetSwapchainImageFormat() const
     {
-        return GSwapchain.GetFormat();
+        return Headless ? GetTargetFormat() : GSwapchain.GetFormat();
     }
 
     VkExtent2D Renderer::GetSwapchainExtent() const
     {
-        return GSwapchain.GetExtent();
+        return Headless ? GUI.ViewportExtent : GSwapchain.GetExtent();
     }
 
     uint32_t Renderer::GetSwapchainCurrentImage() const
     {
-        return GSwapchain.GetCurrentImage();
+        return Headless ? 0 : GSwapchain.GetCurrentImage();
+    }
+
+    VkFormat Renderer::GetTargetFormat() const
+    {
+        // Windowed targets are shown in the viewport, so they match the swapchain
+        return Headless ? VK_FORMAT_R8G8B8A8_UNORM : GSwapchain.GetFormat();
+    }
+
+    bool Renderer::IsHeadless() const
+    {
+        return Headless;
+    }
+
+    void Renderer::ReadbackLastFrame(std::vector<uint8_t>& pixels, VkExtent2D& extent)
+    {
+        // Slot of the frame submitted by the last EndFrame
+        uint32_t frame = (CurrentFrame + MaxFramesInFlight - 1) % MaxFramesInFlight;
+        vkWaitForFences(Context::GetDevice(), 1, &FrameFences[frame], VK_TRUE, UINT64_MAX);
+
+        VkRect2D area = SubmittedAreas[frame];
+        GUI.ViewportRenderTargets[frame]->Read(area, pixels);
+        extent = area.extent;
     }
 
     void Renderer::EnqueueRenderPass(const std::string &name,
@@ -313,6 +603,86 @@ namespace vkc
         }
     }
 
+    void Renderer::SetFrameUpdate(FrameUpdateDelegate&& update)
+    {
+        FrameUpdate = std::move(update);
+    }
+
+    void Renderer::Retire(std::function<void()>&& release)
+    {
+        Retired[CurrentFrame].push_back(std::move(release));
+    }
+
+    void Renderer::EnqueueCommands(CommandStage stage, CommandDelegate&& delegate)
+    {
+        if (stage == CommandStage::BeforePasses)
+        {
+            CommandsBeforePasses.push_back(std::move(delegate));
+        }
+        else
+        {
+            CommandsAfterPasses.push_back(std::move(delegate));
+        }
+    }
+
+    const Texture2D& Renderer::GetDepthBuffer() const
+    {
+        return *GUI.ViewportDepthBuffer;
+    }
+
+    VkRect2D Renderer::GetRenderArea() const
+    {
+        // Keep it inside the oversized target, whatever was pinned
+        VkExtent2D targetExtent = GUI.ViewportDepthBuffer->GetExtent();
+        auto width = static_cast<uint32_t>(static_cast<float>(GUI.ViewportExtent.width) * ActiveQuality.Scale);
+        auto height = static_cast<uint32_t>(static_cast<float>(GUI.ViewportExtent.height) * ActiveQuality.Scale);
+
+        return {
+            {0, 0},
+            {std::clamp(width, 1u, targetExtent.width), std::clamp(height, 1u, targetExtent.height)}
+        };
+    }
+
+    uint32_t Renderer::GetRaymarchSteps() const
+    {
+        return ActiveQuality.Steps;
+    }
+
+    QualityGovernor& Renderer::GetQualityGovernor()
+    {
+        return Governor;
+    }
+
+    GpuProfiler& Renderer::GetGpuProfiler()
+    {
+        return Profiler;
+    }
+
+    FrameReadback& Renderer::GetFrameReadback()
+    {
+        return Readback;
+    }
+
+    UniformRing& Renderer::GetUniformRing()
+    {
+        return Uniforms;
+    }
+
+    BindlessTextureTable& Renderer::GetBindlessTable()
+    {
+        return BindlessTable;
+    }
+
+    DescriptorAllocator& Renderer::GetDescriptorAllocator()
+    {
+        return Descriptors;
+    }
+
+    PipelineCompiler& Renderer::GetPipelineCompiler()
+    {
+        return Compiler;
+    }
+
     uint32_t Renderer::GetFramesCount() const
     {
         return MaxFramesInFlight;
@@ -325,7 +695,7 @@ namespace vkc
 
     uint32_t Renderer::GetSwapchainImageCount() const
     {
-        return GSwapchain.GetImageCount();
+        return Headless ? 0 : GSwapchain.GetImageCount();
     }
 
     VkRenderPass Renderer::CreateGUIRenderPass() const
@@ -372,26 +742,17 @@ namespace vkc
 
     VkDescriptorPool Renderer::CreateGUIDescriptorPool() const
     {
-        // o ma gad...
-        uint32_t numDescriptors = 1000;
+        // ImGui only binds textures: the font and the viewport targets.
+        // Client sets come from the descriptor allocator.
+        uint32_t numDescriptors = 16 + GetFramesCount();
         std::vector<VkDescriptorPoolSize> poolSizes = {
-            {VK_DESCRIPTOR_TYPE_SAMPLER, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, numDescriptors},
-            {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, numDescriptors}
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numDescriptors}
         };
 
         VkDescriptorPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-        poolInfo.maxSets = numDescriptors * poolSizes.size();
+        poolInfo.maxSets = numDescriptors;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
 
@@ -407,6 +768,7 @@ namespace vkc
 
     void Renderer::RenderGUI()
     {
+        PROFILE_FUNCTION();
         ImGui::Render();
 
         auto commandBuffer = GUI.CommandBuffers[GetCurrentFrame()];
@@ -417,6 +779,8 @@ namespace vkc
         {
             Error("Failed to begin recording command buffer.");
         }
+        uint32_t zone = Profiler.BeginZone(commandBuffer, "GUI");
+
         // Begin GUI render pass
         auto extent = GetSwapchainExtent();
         VkRenderPassBeginInfo info = {};
@@ -433,6 +797,9 @@ namespace vkc
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
 
         vkCmdEndRenderPass(commandBuffer);
+        Profiler.EndZone(commandBuffer, zone);
+        Profiler.EndZone(commandBuffer, FrameZone);
+
         // Submit command buffer
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
         {
@@ -11,11 +11,21 @@
 #include "VulkanSwapchain.h"
 #include "VulkanRenderPass.h"
 #include "VulkanTexture.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanFrameReadback.h"
+#include "VulkanUniformRing.h"
+#include "VulkanBindlessTable.h"
+#include "VulkanDescriptorAllocator.h"
+
+#include "Etna/Core/QualityGovernor.h"
+#include "Etna/Core/Utils.h"
 
 #include "imgui.h"
 
+#include <chrono>
 #include <map>
 #include <queue>
+#include <string>
 #include <vector>
 #include <functional>
 
@@ -30,19 +40,66 @@ namespace vkc
 
         uint32_t ImageIndex; // Index of an image, acquired by swapchain
         uint32_t FrameIndex; // Index of a frame in flight
+
+        const std::vector<PushConstantBlock>* PushConstantBlocks;
+
+        /// Push the data into the pass' block, which covers it
+        template<class T>
+        void Push(const T& data, uint32_t offset = 0) const
+        {
+            for (auto& block : *PushConstantBlocks)
+            {
+                if (offset >= block.Offset && offset + sizeof(T) <= block.Offset + block.Size)
+                {
+                    vkCmdPushConstants(CommandBuffer, PipelineLayout, block.Stages, offset, sizeof(T), &data);
+                    return;
+                }
+            }
+            Error("No push constant block covers %u bytes at offset %u.", static_cast<uint32_t>(sizeof(T)), offset);
+        }
     };
 
     // Function, which is called between pass.Begin() an pass.End()
     // used for binding resources and making draw calls
     using RenderPassDelegate = std::function<void(RenderPassContext&&)>;
 
+    // Where commands outside of the render passes go, e.g. uploads and barriers
+    enum class CommandStage
+    {
+        BeforePasses,
+        AfterPasses
+    };
+
+    // Records into the frame's command buffer, outside of any render pass
+    using CommandDelegate = std::function<void(VkCommandBuffer commandBuffer, uint32_t frameIndex)>;
+
+    // Client's per frame update, run by EndFrame after the frame's fence and image acquire,
+    // right before its commands are recorded and submitted. Latest point to sample input.
+    using FrameUpdateDelegate = std::function<void(uint32_t frameIndex)>;
+
+    struct RendererCreateInfo
+    {
+        ContextMode Mode = ContextMode::Windowed;
+        uint32_t FramesInFlight = 2;
+        // Nominal size of the render targets, scaled by the quality governor
+        VkExtent2D TargetExtent = {1280, 720};
+        // Size of the uniform ring region of every frame in flight
+        VkDeviceSize UniformBytesPerFrame = 256 * 1024;
+        // Bindless volume table, used when the device supports descriptor indexing
+        bool Bindless = true;
+        // Zero picks one per hardware thread, except the main one
+        uint32_t PipelineThreads = 0;
+        // Empty keeps the pipeline cache in memory only, see GetUserCachePath for one that persists
+        std::string PipelineCachePath;
+    };
+
     struct RenderPassContainer
     {
         RenderPassContainer() = default;
-        RenderPassContainer(const RenderPassCreateInfo& initInfo)
+        RenderPassContainer(const RenderPassCreateInfo& initInfo, PipelineCompiler* compiler)
         {
             Area = {};
-            Pass = Ref<RenderPass>(new RenderPass(initInfo));
+            Pass = Ref<RenderPass>(new RenderPass(initInfo, compiler));
             Delegate = [](RenderPassContext&&){};
             CurrentFramebufferIndex = 0;
         }
@@ -64,14 +121,25 @@ namespace vkc
         /// Dispatch all render passes
         void RecordCommandBuffers();
 
+        /// Read GPU timings of the frame, which has just finished on this slot
+        void CollectFrameTimings();
+
+        /// Run the client's update, if there's one, and note when it started
+        void RunFrameUpdate();
+        /// Time from the frame update to the submit, called right before it
+        void MeasureInputToSubmit();
+
+        void RenderStatsPanel();
+
     public:
-        void Init();
+        void Init(const RendererCreateInfo& createInfo = {});
         void Shutdown();
 
         /// Acquire new image from swapchain, rebuild it if necessary
         void BeginFrame();
 
-        /// Wait for rendering to finish and present result to the screen
+        /// Wait for rendering to finish and present result to the screen.
+        /// Headless renderer only submits the frame.
         void EndFrame();
 
         /// Render ImGui
@@ -86,12 +154,50 @@ namespace vkc
                                const std::vector<std::string>& dependencies = {},
                                RenderPassDelegate&& delegate = [](RenderPassContext){});
 
+        /// Record commands of the current frame before or after all of its render passes
+        void EnqueueCommands(CommandStage stage, CommandDelegate&& delegate);
+
+        /// Run once every frame in flight, which might still use a resource, has finished,
+        /// e.g. to destroy a texture replaced mid-frame. Call between BeginFrame and EndFrame.
+        void Retire(std::function<void()>&& release);
+
+        /// Called by every EndFrame before recording, so uniforms and passes' data are written
+        /// from input sampled as late as possible. Empty delegate removes it.
+        void SetFrameUpdate(FrameUpdateDelegate&& update);
+        /// From the start of the last frame update to the submit of its frame, zero without one
+        [[nodiscard]] float GetInputToSubmitMs() const { return LastInputToSubmitMs; }
 
         [[nodiscard]] VkFormat GetSwapchainImageFormat() const;
         [[nodiscard]] uint32_t GetSwapchainImageCount() const;
         [[nodiscard]] uint32_t GetSwapchainCurrentImage() const;
         [[nodiscard]] VkExtent2D GetSwapchainExtent() const;
 
+        /// Format client passes have to render in
+        [[nodiscard]] VkFormat GetTargetFormat() const;
+        [[nodiscard]] bool IsHeadless() const;
+
+        /// Blocking copy of the last submitted frame's render area, 4 bytes per pixel in GetTargetFormat() order
+        void ReadbackLastFrame(std::vector<uint8_t>& pixels, VkExtent2D& extent);
+
+        /// Depth attachment every client pass shares. Sampled in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+        /// by passes after one, which stores it, see RenderPassCreateInfo::StoreDepth.
+        [[nodiscard]] const Texture2D& GetDepthBuffer() const;
+
+        /// Region of the viewport target to render into, scaled by the quality governor
+        [[nodiscard]] VkRect2D GetRenderArea() const;
+        /// Raymarch step count chosen by the quality governor
+        [[nodiscard]] uint32_t GetRaymarchSteps() const;
+        [[nodiscard]] QualityGovernor& GetQualityGovernor();
+        [[nodiscard]] GpuProfiler& GetGpuProfiler();
+        /// Streams frames to a sink without stalling, see FrameReadback::SetSink
+        [[nodiscard]] FrameReadback& GetFrameReadback();
+        /// Per-draw uniform data of the current frame, bound with dynamic offsets
+        [[nodiscard]] UniformRing& GetUniformRing();
+        /// Check IsEnabled(), clients fall back to a set per texture otherwise
+        [[nodiscard]] BindlessTextureTable& GetBindlessTable();
+        /// Growable pools for the clients' sets, see DescriptorSetWriter
+        [[nodiscard]] DescriptorAllocator& GetDescriptorAllocator();
+        [[nodiscard]] PipelineCompiler& GetPipelineCompiler();
 
         void CreateSwapchainFramebuffers(std::vector<VkFramebuffer>& framebuffers, const std::string& renderPass);
 
@@ -100,10 +206,14 @@ namespace vkc
         [[nodiscard]] uint32_t GetCurrentFrame() const;
 
     private:
+        bool Headless;
         uint32_t MaxFramesInFlight;
         uint32_t CurrentFrame;
         vkc::Swapchain GSwapchain;
 
+        // Render area of every frame in flight, as it was recorded
+        std::vector<VkRect2D> SubmittedAreas;
+
         // Synchronization primitives. One of a type per frame in flight
         std::vector<VkFence> FrameFences;
         std::vector<VkSemaphore> ImageAvailableSemaphores;
@@ -113,11 +223,50 @@ namespace vkc
         std::vector<VkCommandBuffer> GraphicsCommandBuffers;
 
         std::queue<std::string> ClientRenderQueue;
+        std::vector<CommandDelegate> CommandsBeforePasses;
+        std::vector<CommandDelegate> CommandsAfterPasses;
         std::map<std::string, RenderPassContainer> ClientRenderPassesMap;
 
+        // Releases queued during a frame, run after its slot's fence is waited for again
+        std::vector<std::vector<std::function<void()>>> Retired;
+
+        // Dynamic resolution and step count.
+        // Level is latched by BeginFrame, so the client and the GUI agree on it.
+        QualityGovernor Governor;
+        QualityLevel ActiveQuality;
+
+        // Per pass GPU timings, "Frame" zone feeds the quality governor
+        GpuProfiler Profiler;
+        uint32_t FrameZone;
+        float LastGpuFrameMs = 0.0f;
+
+        // Late-latched client update, and how long its input waits for the submit
+        FrameUpdateDelegate FrameUpdate;
+        bool FrameUpdated = false;
+        std::chrono::steady_clock::time_point InputSampled;
+        float LastInputToSubmitMs = 0.0f;
+        float AverageInputToSubmitMs = 0.0f;
+
+        // Copies of the viewport target, delivered frames in flight late
+        FrameReadback Readback;
+
+        // Reset after the frame's fence, allocations live until it is waited for again
+        UniformRing Uniforms;
+
+        BindlessTextureTable BindlessTable;
+
+        // Frame sets are reset after the frame's fence, like the uniform ring
+        DescriptorAllocator Descriptors;
+
+        // Pipelines of the client passes are built in the background
+        PipelineCompiler Compiler;
+
         // GUI data
         struct
         {
+            // Nominal size of the viewport. Render targets are allocated for the
+            // maximal quality scale and only a scissored part of them is used.
+            VkExtent2D ViewportExtent;
             Ref<Texture2D> ViewportDepthBuffer;
             std::vector<Ref<Texture2D>> ViewportRenderTargets;
             std::vector<VkDescriptorSet> ViewportRenderTargetDescriptors;
@@ -168,13 +317,20 @@ namespace vkc
             }
             void EndDockingSpace() { ImGui::End(); }
 
-            void RenderViewport(uint32_t frameIndex)
+            void RenderViewport(uint32_t frameIndex, VkRect2D area)
             {
                 ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
                 ImGui::Begin("Viewport");
 
+                // Show only the part of the target, which was actually rendered
+                VkExtent2D targetExtent = ViewportRenderTargets[frameIndex]->GetExtent();
+                ImVec2 uvMax = {
+                    static_cast<float>(area.extent.width) / static_cast<float>(targetExtent.width),
+                    static_cast<float>(area.extent.height) / static_cast<float>(targetExtent.height)
+                };
+
                 ImVec2 viewportPanelSize = ImGui::GetContentRegionAvail();
-                ImGui::Image((uint64_t)ViewportRenderTargetDescriptors[frameIndex], ImVec2{viewportPanelSize.x, viewportPanelSize.y});
+                ImGui::Image((uint64_t)ViewportRenderTargetDescriptors[frameIndex], ImVec2{viewportPanelSize.x, viewportPanelSize.y}, ImVec2{0, 0}, uvMax);
 
                 ImGui::End();
                 ImGui::PopStyleVar();
@@ -1,18 +1,52 @@
 #include "VulkanShader.h"
 
 #include "VulkanContext.h"
+#include "VulkanShaderRegistry.h"
 #include "Etna/Core/Utils.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
 namespace vkc
 {
+    // Words rather than chars, so the code is aligned as vkCreateShaderModule wants it
+    static void ReadSpirv(const std::string& filename, std::vector<uint32_t>& words)
+    {
+        std::vector<char> bytes;
+        ReadFile(filename, bytes);
+        if (bytes.size() % sizeof(uint32_t) != 0)
+        {
+            Error("Size of %s is not a multiple of 4, it's not SPIR-V.", filename.c_str());
+        }
+
+        words.resize(bytes.size() / sizeof(uint32_t));
+        memcpy(words.data(), bytes.data(), bytes.size());
+    }
+
     Shader::Shader(vkc::ShaderStage type, const std::string &shaderFileName)
         : Type(type)
     {
-        std::vector<char> shaderCode;
+        // Development override, edited shaders are picked up without relinking
+        if (const char* shaderDir = std::getenv("ETNA_SHADER_DIR"))
+        {
+            auto name = std::filesystem::path(shaderFileName).filename();
+            std::vector<uint32_t> words;
+            ReadSpirv((std::filesystem::path(shaderDir) / name).string(), words);
+            Handle = CreateShaderModule(words.data(), words.size());
+            return;
+        }
 
-        ReadFile(shaderFileName, shaderCode);
+        if (auto embedded = FindEmbeddedShader(shaderFileName))
+        {
+            Handle = CreateShaderModule(embedded->Words, embedded->WordCount);
+            return;
+        }
 
-        Handle = CreateShaderModule(shaderCode);
+        // Built without glslc
+        std::vector<uint32_t> words;
+        ReadSpirv(shaderFileName, words);
+        Handle = CreateShaderModule(words.data(), words.size());
     }
 
     Shader::~Shader()
@@ -31,12 +65,12 @@ namespace vkc
         return shaderStageInfo;
     }
 
-    VkShaderModule Shader::CreateShaderModule(const std::vector<char> &code)
+    VkShaderModule Shader::CreateShaderModule(const uint32_t* words, size_t wordCount)
     {
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        createInfo.codeSize = wordCount * sizeof(uint32_t);
+        createInfo.pCode = words;
 
         VkShaderModule shaderModule{};
         if (vkCreateShaderModule(Context::GetDevice(), &createInfo, Context::GetAllocator(), &shaderModule) != VK_SUCCESS)
@@ -11,6 +11,8 @@ namespace vkc
     class Shader
     {
     public:
+        /// Embedded SPIR-V is used, unless ETNA_SHADER_DIR points to a directory with the .spv files.
+        /// Without either the path is read as is.
         Shader(ShaderStage type, const std::string& shaderFileName);
         Shader(const Shader&) = delete;
         Shader& operator=(const Shader&) = delete;
@@ -18,7 +20,7 @@ namespace vkc
 
         VkPipelineShaderStageCreateInfo GetShaderStageCreateInfo() const;
 
-        static VkShaderModule CreateShaderModule(const std::vector<char>& code);
+        static VkShaderModule CreateShaderModule(const uint32_t* words, size_t wordCount);
 
     private:
         ShaderStage Type;
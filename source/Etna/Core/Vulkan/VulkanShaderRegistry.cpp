@@ -0,0 +1,31 @@
+#include "VulkanShaderRegistry.h"
+
+#include "Etna/Core/Utils.h"
+
+namespace vkc
+{
+#ifdef ETNA_EMBEDDED_SHADERS
+    // Defined by the generated EmbeddedShaders.cpp
+    extern const EmbeddedShader EmbeddedShaders[];
+    extern const uint32_t EmbeddedShaderCount;
+#endif
+
+    const EmbeddedShader* FindEmbeddedShader(std::string_view path)
+    {
+#ifdef ETNA_EMBEDDED_SHADERS
+        size_t separator = path.find_last_of("/\\");
+        std::string_view name = separator == std::string_view::npos ? path : path.substr(separator + 1);
+
+        for (uint32_t i = 0; i < EmbeddedShaderCount; i++)
+        {
+            if (name == EmbeddedShaders[i].Name)
+            {
+                return &EmbeddedShaders[i];
+            }
+        }
+#else
+        UNUSED(path);
+#endif
+        return nullptr;
+    }
+}
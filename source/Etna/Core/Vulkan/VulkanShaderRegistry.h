@@ -0,0 +1,26 @@
+/*
+ * SPIR-V compiled from shaders/*.glsl at build time and embedded into the binary.
+ * See cmake/EmbedSpirv.cmake, which generates the table.
+ */
+
+#ifndef VULKANSHADERREGISTRY_H
+#define VULKANSHADERREGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace vkc
+{
+    struct EmbeddedShader
+    {
+        const char* Name;       // File name of the .spv, e.g. "vert.spv"
+        const uint32_t* Words;
+        size_t WordCount;
+    };
+
+    /// Looks the shader up by the file name of the path. Null if it wasn't embedded.
+    const EmbeddedShader* FindEmbeddedShader(std::string_view path);
+}
+
+#endif //VULKANSHADERREGISTRY_H
@@ -64,7 +64,7 @@ namespace vkc
         }
         if (lastAcquired != lastPresented)
         {
-            InfoLog("Acquired: %i\t\t Presented: %i", (int) lastAcquired, (int) lastPresented);
+            InfoLogLimited("Acquired: %i\t\t Presented: %i", (int) lastAcquired, (int) lastPresented);
         }
         return false;
     }
@@ -2,6 +2,8 @@
 
 #include "Etna/Core/Utils.h"
 
+#include <cstring>
+
 namespace vkc
 {
     Texture::~Texture()
@@ -67,12 +69,14 @@ namespace vkc
             width, height,
             texture->Format,
             VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            // Sampled by passes, which test against it without writing, see RenderPassCreateInfo::ReadOnlyDepth
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             texture->Image,
             texture->Memory
         );
 
+        texture->Sampler = CreateDepthSampler();
         texture->ImageView = CreateImageView(
             texture->Image,
             texture->Format,
@@ -91,7 +95,7 @@ namespace vkc
             width, height,
             format,
             VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             texture->Image,
             texture->Memory
@@ -108,14 +112,101 @@ namespace vkc
         return texture;
     }
 
-    Texture3D::Texture3D(unsigned char *data, VkExtent3D extent)
+    void Texture2D::Read(VkRect2D region, std::vector<uint8_t>& pixels) const
+    {
+        VkDeviceSize size = static_cast<VkDeviceSize>(region.extent.width) * region.extent.height * 4;
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingMemory;
+        CreateBuffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingBuffer,
+            stagingMemory
+        );
+
+        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool(), "Readback: Image");
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = Image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier
+        );
+
+        VkBufferImageCopy copyRegion{};
+        copyRegion.bufferOffset = 0;
+        copyRegion.bufferRowLength = 0;
+        copyRegion.bufferImageHeight = 0;
+        copyRegion.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        copyRegion.imageOffset = {region.offset.x, region.offset.y, 0};
+        copyRegion.imageExtent = {region.extent.width, region.extent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &copyRegion);
+
+        // Give it back to render passes and samplers
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier
+        );
+
+        EndSingleTimeCommands(commandBuffer, Context::GetTransferCommandPool());
+
+        pixels.resize(size);
+        void* data;
+        vkMapMemory(Context::GetDevice(), stagingMemory, 0, size, 0, &data);
+        memcpy(pixels.data(), data, size);
+        vkUnmapMemory(Context::GetDevice(), stagingMemory);
+
+        vkDestroyBuffer(Context::GetDevice(), stagingBuffer, Context::GetAllocator());
+        vkFreeMemory(Context::GetDevice(), stagingMemory, Context::GetAllocator());
+    }
+
+    Texture3D::Texture3D(unsigned char *data, VkExtent3D extent, VkFormat format)
     {
         Width = static_cast<int>(extent.width);
         Height = static_cast<int>(extent.height);
         Depth = static_cast<int>(extent.depth);
-        Format = VK_FORMAT_R8G8B8A8_UNORM;
-        Channels = 4;
-        uint32_t imageSize = Width * Height * Depth * Channels;
+        Format = format;
+
+        // Bytes per texel
+        uint32_t texelSize;
+        switch (Format)
+        {
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                Channels = 4;
+                texelSize = 4;
+                break;
+            case VK_FORMAT_R16G16_SFLOAT:
+                Channels = 2;
+                texelSize = 4;
+                break;
+            case VK_FORMAT_R16_SFLOAT:
+                Channels = 1;
+                texelSize = 2;
+                break;
+            case VK_FORMAT_R8_UNORM:
+                Channels = 1;
+                texelSize = 1;
+                break;
+            default:
+                Error("Format %d is not supported by 3D textures.", static_cast<int>(Format));
+        }
+        uint32_t imageSize = Width * Height * Depth * texelSize;
 
         if (!data)
         {
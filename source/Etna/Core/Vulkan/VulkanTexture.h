@@ -7,6 +7,7 @@
 #include <stb_image.h>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace vkc
 {
@@ -50,12 +51,17 @@ namespace vkc
     public:
         static Ref<Texture2D> CreateDepthBuffer(uint32_t width, uint32_t height);
         static Ref<Texture2D> CreateRenderTarget(uint32_t width, uint32_t height, VkFormat format);
+
+        /// Blocking copy of a region of the render target into host memory, 4 bytes per texel.
+        /// The image must be idle and in the layout render passes leave it in.
+        void Read(VkRect2D region, std::vector<uint8_t>& pixels) const;
     };
 
     class Texture3D : public Texture
     {
     public:
-        Texture3D(unsigned char* data, VkExtent3D extent);
+        /// RGBA8 unless the format says otherwise. Only formats of 1, 2 or 4 bytes per texel are supported.
+        Texture3D(unsigned char* data, VkExtent3D extent, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
         ~Texture3D() = default;
     };
 
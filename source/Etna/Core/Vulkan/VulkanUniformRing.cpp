@@ -0,0 +1,81 @@
+#include "VulkanUniformRing.h"
+#include "VulkanContext.h"
+#include "VulkanCore.h"
+
+#include "Etna/Core/Utils.h"
+
+#include <algorithm>
+
+namespace vkc
+{
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void UniformRing::Init(VkDeviceSize bytesPerFrame, uint32_t framesInFlight)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(Context::GetPhysicalDevice(), &properties);
+        Alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+
+        // Regions start aligned, so every offset inside of them is too
+        BytesPerFrame = AlignUp(bytesPerFrame, Alignment);
+        VkDeviceSize size = BytesPerFrame * framesInFlight;
+
+        CreateBuffer(
+            size,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            Buffer,
+            Memory
+        );
+
+        void* mapped;
+        if (vkMapMemory(Context::GetDevice(), Memory, 0, size, 0, &mapped) != VK_SUCCESS)
+        {
+            Error("Failed to map uniform ring.");
+        }
+        Mapped = static_cast<uint8_t*>(mapped);
+
+        FrameStart = 0;
+        Head = 0;
+    }
+
+    void UniformRing::Shutdown()
+    {
+        if (Buffer == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        vkUnmapMemory(Context::GetDevice(), Memory);
+        vkDestroyBuffer(Context::GetDevice(), Buffer, Context::GetAllocator());
+        vkFreeMemory(Context::GetDevice(), Memory, Context::GetAllocator());
+        Buffer = VK_NULL_HANDLE;
+        Memory = VK_NULL_HANDLE;
+        Mapped = nullptr;
+    }
+
+    void UniformRing::BeginFrame(uint32_t frameIndex)
+    {
+        FrameStart = BytesPerFrame * frameIndex;
+        Head = FrameStart;
+    }
+
+    UniformAllocation UniformRing::Allocate(VkDeviceSize size)
+    {
+        VkDeviceSize end = Head + size;
+        if (end > FrameStart + BytesPerFrame)
+        {
+            Error("Uniform ring is out of space: %llu of %llu bytes are used this frame.",
+                  static_cast<unsigned long long>(Head - FrameStart), static_cast<unsigned long long>(BytesPerFrame));
+        }
+
+        UniformAllocation allocation = {Mapped + Head, static_cast<uint32_t>(Head)};
+        Head = AlignUp(end, Alignment);
+        PeakBytes = std::max(PeakBytes, Head - FrameStart);
+
+        return allocation;
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Frame scoped allocator of uniform data.
+ * One persistently mapped buffer is split into a region per frame in flight,
+ * allocations bump through the region of the current frame and are bound
+ * as UniformBufferDynamic with per-draw offsets. Updating per-draw data is
+ * a memcpy, descriptor sets are written once.
+ */
+
+#ifndef VULKANUNIFORMRING_H
+#define VULKANUNIFORMRING_H
+
+#include "VulkanHeader.h"
+
+#include <cstring>
+
+namespace vkc
+{
+    struct UniformAllocation
+    {
+        void* Data;
+        uint32_t Offset; // Dynamic offset to bind with
+    };
+
+    class UniformRing
+    {
+    public:
+        UniformRing() = default;
+        ~UniformRing() = default;
+
+        UniformRing(const UniformRing&) = delete;
+        UniformRing& operator=(const UniformRing&) = delete;
+
+        void Init(VkDeviceSize bytesPerFrame, uint32_t framesInFlight);
+        void Shutdown();
+
+        /// Start allocating from the frame's region. Must be called after the frame's fence.
+        void BeginFrame(uint32_t frameIndex);
+
+        /// Throws if the frame's region is exhausted
+        UniformAllocation Allocate(VkDeviceSize size);
+
+        /// Copy the data into the ring, returns its dynamic offset
+        template<class T>
+        uint32_t Push(const T& data);
+
+        /// Buffer to write into the descriptors, with offset 0 and range of the bound type
+        [[nodiscard]] VkBuffer GetBuffer() const { return Buffer; }
+        [[nodiscard]] VkDeviceSize GetAlignment() const { return Alignment; }
+        [[nodiscard]] VkDeviceSize GetBytesPerFrame() const { return BytesPerFrame; }
+        /// Bytes allocated in the current frame and the most ever allocated in one
+        [[nodiscard]] VkDeviceSize GetUsedBytes() const { return Head - FrameStart; }
+        [[nodiscard]] VkDeviceSize GetPeakBytes() const { return PeakBytes; }
+
+    private:
+        VkBuffer Buffer = VK_NULL_HANDLE;
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        uint8_t* Mapped = nullptr;
+
+        VkDeviceSize Alignment = 256;
+        VkDeviceSize BytesPerFrame = 0;
+        VkDeviceSize FrameStart = 0;
+        VkDeviceSize Head = 0;
+        VkDeviceSize PeakBytes = 0;
+    };
+
+    template<class T>
+    uint32_t UniformRing::Push(const T& data)
+    {
+        auto allocation = Allocate(sizeof(T));
+        memcpy(allocation.Data, &data, sizeof(T));
+        return allocation.Offset;
+    }
+}
+
+#endif //VULKANUNIFORMRING_H
@@ -0,0 +1,668 @@
+#include "VulkanVirtualVolume.h"
+#include "VulkanRenderer.h"
+#include "VulkanContext.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/Utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vkc
+{
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    VirtualVolume::VirtualVolume(Renderer& renderer, const VirtualVolumeSettings& settings)
+        : Owner(renderer), Settings(settings)
+    {
+        if (!Context::SupportsFragmentStores())
+        {
+            Error("Virtual volume needs fragment shader stores for its feedback.");
+        }
+        if (Settings.BrickSize == 0 || Settings.UploadsPerFrame == 0 || Settings.FeedbackCapacity == 0)
+        {
+            Error("Virtual volume settings must be positive.");
+        }
+
+        PaddedSize = Settings.BrickSize + 2 * Border;
+        BrickBytes = static_cast<VkDeviceSize>(PaddedSize) * PaddedSize * PaddedSize * VolumeSource::TexelSize;
+
+        CreateAtlas();
+        CreateBuffers();
+
+        // Info and feedback are dynamic, so one set serves every frame in flight
+        Layout = DescriptorSetLayout::Builder()
+            .AddBinding(0, DescriptorType::CombinedImageSampler, ShaderStage::Fragment)
+            .AddBinding(1, DescriptorType::UniformBufferDynamic, ShaderStage::Fragment)
+            .AddBinding(2, DescriptorType::StorageBuffer, ShaderStage::Fragment)
+            .AddBinding(3, DescriptorType::StorageBufferDynamic, ShaderStage::Fragment)
+            .Build();
+    }
+
+    VirtualVolume::~VirtualVolume()
+    {
+        VkDevice device = Context::GetDevice();
+        auto allocator = Context::GetAllocator();
+
+        vkDestroyBuffer(device, PageTable, allocator);
+        vkFreeMemory(device, PageTableMemory, allocator);
+        vkDestroyBuffer(device, Feedback, allocator);
+        vkFreeMemory(device, FeedbackMemory, allocator);
+        vkDestroyBuffer(device, Staging, allocator);
+        vkFreeMemory(device, StagingMemory, allocator);
+
+        vkDestroySampler(device, AtlasSampler, allocator);
+        vkDestroyImageView(device, AtlasView, allocator);
+        vkDestroyImage(device, Atlas, allocator);
+        vkFreeMemory(device, AtlasMemory, allocator);
+
+        vkDestroyDescriptorSetLayout(device, Layout->Handle, allocator);
+    }
+
+    void VirtualVolume::CreateAtlas()
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(Context::GetPhysicalDevice(), &properties);
+
+        // Largest cube of bricks within the budget, the image and the page table entry
+        uint32_t bricks = Settings.AtlasBricks;
+        if (bricks == 0)
+        {
+            bricks = static_cast<uint32_t>(std::cbrt(static_cast<double>(Settings.AtlasBytes / BrickBytes)));
+        }
+        bricks = std::min({bricks, properties.limits.maxImageDimension3D / PaddedSize, MaxAtlasBricks});
+        if (bricks < 2)
+        {
+            Error("Atlas of %u bricks per side is too small for bricks of %u voxels.", bricks, Settings.BrickSize);
+        }
+        AtlasBricks = bricks;
+
+        uint32_t extent = AtlasBricks * PaddedSize;
+        CreateImage(
+            extent, extent, extent,
+            VK_IMAGE_TYPE_3D,
+            VK_FORMAT_R8G8B8A8_UNORM,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            Atlas, AtlasMemory
+        );
+        AtlasView = CreateImageView(Atlas, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_3D);
+
+        // Borders keep the filter inside of a brick, wrapping is done by the shader
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        if (vkCreateSampler(Context::GetDevice(), &samplerInfo, Context::GetAllocator(), &AtlasSampler) != VK_SUCCESS)
+        {
+            Error("Failed to create atlas sampler.");
+        }
+
+        Slots.resize(static_cast<size_t>(AtlasBricks) * AtlasBricks * AtlasBricks);
+        Stats.Slots = static_cast<uint32_t>(Slots.size());
+    }
+
+    void VirtualVolume::CreateBuffers()
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(Context::GetPhysicalDevice(), &properties);
+        uint32_t framesCount = Owner.GetFramesCount();
+
+        FeedbackRegionBytes = AlignUp(static_cast<VkDeviceSize>(Settings.FeedbackCapacity) * sizeof(uint32_t),
+                                      properties.limits.minStorageBufferOffsetAlignment);
+        CreateBuffer(
+            FeedbackRegionBytes * framesCount,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            Feedback, FeedbackMemory
+        );
+        void* mapped;
+        vkMapMemory(Context::GetDevice(), FeedbackMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        FeedbackMapped = static_cast<uint32_t*>(mapped);
+        memset(FeedbackMapped, 0, FeedbackRegionBytes * framesCount);
+        FeedbackWritten.assign(framesCount, false);
+
+        // Every upload changes two entries at most, the evicted page and the loaded one
+        StagingRegionBytes = Settings.UploadsPerFrame * BrickBytes + Settings.UploadsPerFrame * 2 * sizeof(uint32_t);
+        StagingRegionBytes = AlignUp(StagingRegionBytes, 16);
+        CreateBuffer(
+            StagingRegionBytes * framesCount,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            Staging, StagingMemory
+        );
+        vkMapMemory(Context::GetDevice(), StagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        StagingMapped = static_cast<uint8_t*>(mapped);
+    }
+
+    void VirtualVolume::SetSource(std::shared_ptr<VolumeSource> source)
+    {
+        PROFILE_FUNCTION();
+
+        // Atlas, page table and the cached set might still be in use
+        VkDevice device = Context::GetDevice();
+        vkDeviceWaitIdle(device);
+        Owner.GetDescriptorAllocator().ClearCache();
+        vkDestroyBuffer(device, PageTable, Context::GetAllocator());
+        vkFreeMemory(device, PageTableMemory, Context::GetAllocator());
+        PageTable = VK_NULL_HANDLE;
+        PageTableMemory = VK_NULL_HANDLE;
+
+        Source = std::move(source);
+        if (!Source)
+        {
+            return;
+        }
+
+        // Levels go down until one brick covers the whole volume
+        glm::uvec3 extent = Source->GetExtent();
+        LevelCount = 1;
+        while (glm::any(glm::greaterThan(VolumeSource::GetLevelExtent(extent, LevelCount - 1), glm::uvec3(Settings.BrickSize))))
+        {
+            LevelCount++;
+        }
+        if (LevelCount > MaxLevels)
+        {
+            Error("Volume needs %u levels, only %u are supported.", LevelCount, MaxLevels);
+        }
+
+        glm::uvec3 scale(AtlasBricks * PaddedSize);
+        Info = {};
+        Info.AtlasScale = glm::vec4(1.0f / glm::vec3(scale), 0.0f);
+        Info.Layout = {Settings.BrickSize, Border, LevelCount, Settings.FeedbackCapacity};
+        Info.Lod = {0.0f, Settings.LodBias, 0.0f, 0.0f};
+
+        uint32_t pageCount = 0;
+        for (uint32_t level = 0; level < LevelCount; level++)
+        {
+            glm::uvec3 levelExtent = VolumeSource::GetLevelExtent(extent, level);
+            glm::uvec3 grid = (levelExtent + Settings.BrickSize - 1u) / Settings.BrickSize;
+            if (glm::any(glm::greaterThan(grid, glm::uvec3(MaxGridBricks))))
+            {
+                Error("Volume has more than %u bricks per side.", MaxGridBricks);
+            }
+            Info.LevelGrid[level] = glm::uvec4(grid, pageCount);
+            Info.LevelExtent[level] = glm::vec4(glm::vec3(levelExtent), 0.0f);
+            pageCount += grid.x * grid.y * grid.z;
+        }
+
+        Pages.assign(pageCount, 0);
+        DirtyPages.clear();
+        std::fill(Slots.begin(), Slots.end(), Slot{});
+        FreeSlots.resize(Slots.size());
+        for (uint32_t i = 0; i < FreeSlots.size(); i++)
+        {
+            // Popped from the back, so the atlas fills from its first slot
+            FreeSlots[i] = static_cast<uint32_t>(FreeSlots.size()) - 1 - i;
+        }
+        Head = InvalidSlot;
+        Tail = InvalidSlot;
+        Stats = {};
+        Stats.Slots = static_cast<uint32_t>(Slots.size());
+
+        uint32_t framesCount = Owner.GetFramesCount();
+        memset(FeedbackMapped, 0, FeedbackRegionBytes * framesCount);
+        FeedbackWritten.assign(framesCount, false);
+
+        CreateBuffer(
+            static_cast<VkDeviceSize>(pageCount) * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            PageTable, PageTableMemory
+        );
+
+        // The coarsest level is the fallback of every sample, it never leaves the atlas
+        glm::uvec3 pinnedGrid = glm::uvec3(Info.LevelGrid[LevelCount - 1]);
+        uint32_t pinnedCount = pinnedGrid.x * pinnedGrid.y * pinnedGrid.z;
+        if (pinnedCount >= Slots.size())
+        {
+            Error("Atlas of %u slots can't hold the coarsest level.", static_cast<uint32_t>(Slots.size()));
+        }
+
+        VkDeviceSize pagesOffset = pinnedCount * BrickBytes;
+        VkDeviceSize uploadSize = pagesOffset + Pages.size() * sizeof(uint32_t);
+        VkBuffer uploadBuffer;
+        VkDeviceMemory uploadMemory;
+        CreateBuffer(
+            uploadSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            uploadBuffer, uploadMemory
+        );
+        void* mapped;
+        vkMapMemory(device, uploadMemory, 0, uploadSize, 0, &mapped);
+        auto upload = static_cast<uint8_t*>(mapped);
+
+        std::vector<VkBufferImageCopy> brickCopies;
+        for (uint32_t i = 0; i < pinnedCount; i++)
+        {
+            glm::uvec3 brick(i % pinnedGrid.x, (i / pinnedGrid.x) % pinnedGrid.y, i / (pinnedGrid.x * pinnedGrid.y));
+            uint32_t slot = FreeSlots.back();
+            FreeSlots.pop_back();
+            Slots[slot].Pinned = true;
+            LoadBrick({LevelCount - 1, brick}, slot, upload + i * BrickBytes);
+            brickCopies.push_back(GetBrickCopy(slot, i * BrickBytes));
+        }
+        memcpy(upload + pagesOffset, Pages.data(), Pages.size() * sizeof(uint32_t));
+        vkUnmapMemory(device, uploadMemory);
+        DirtyPages.clear();
+
+        auto commandBuffer = BeginSingleTimeCommands(Context::GetTransferCommandPool(), "Upload: Virtual volume");
+            // Slots, which aren't pinned, are garbage until loaded, so old contents are discarded
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = Atlas;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            vkCmdCopyBufferToImage(commandBuffer, uploadBuffer, Atlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   static_cast<uint32_t>(brickCopies.size()), brickCopies.data());
+            VkBufferCopy pagesCopy = {pagesOffset, 0, Pages.size() * sizeof(uint32_t)};
+            vkCmdCopyBuffer(commandBuffer, uploadBuffer, PageTable, 1, &pagesCopy);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        EndSingleTimeCommands(commandBuffer, Context::GetTransferCommandPool());
+
+        vkDestroyBuffer(device, uploadBuffer, Context::GetAllocator());
+        vkFreeMemory(device, uploadMemory, Context::GetAllocator());
+
+        InfoLog("Virtual volume %ux%ux%u: %u levels, %u pages, atlas of %u bricks.",
+                extent.x, extent.y, extent.z, LevelCount, pageCount, Stats.Slots);
+    }
+
+    void VirtualVolume::Update(float pixelAngle, const VolumeView& view)
+    {
+        PROFILE_FUNCTION();
+
+        if (!Source)
+        {
+            return;
+        }
+        Source->BeginFrame(view);
+
+        uint32_t frameIndex = Owner.GetCurrentFrame();
+        FrameNumber++;
+        Stats.Uploaded = 0;
+
+        std::vector<BrickKey> missing;
+        ReadFeedback(frameIndex, missing);
+        RecordUploads(frameIndex, missing);
+
+        // Feedback of this frame is read when its fence comes around again
+        VkBuffer feedback = Feedback;
+        VkDeviceSize offset = frameIndex * FeedbackRegionBytes;
+        VkDeviceSize size = FeedbackRegionBytes;
+        Owner.EnqueueCommands(CommandStage::AfterPasses,
+            [feedback, offset, size](VkCommandBuffer commandBuffer, uint32_t)
+            {
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = feedback;
+                barrier.offset = offset;
+                barrier.size = size;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                                     0, 0, nullptr, 1, &barrier, 0, nullptr);
+            });
+        FeedbackWritten[frameIndex] = true;
+
+        // Shaders measure the distance in box units, the box is two units wide
+        glm::vec3 extent = glm::vec3(Info.LevelExtent[0]);
+        Info.Lod.x = pixelAngle * std::max({extent.x, extent.y, extent.z}) * 0.5f;
+        // Every frame a different eighth of the pixels writes the feedback
+        Info.Frame.x = static_cast<uint32_t>(FrameNumber & 7);
+        InfoOffset = Owner.GetUniformRing().Push(Info);
+    }
+
+    void VirtualVolume::ReadFeedback(uint32_t frameIndex, std::vector<BrickKey>& missing)
+    {
+        if (!FeedbackWritten[frameIndex])
+        {
+            return;
+        }
+        FeedbackWritten[frameIndex] = false;
+
+        // Hashing in the shader only drops most of the duplicates
+        uint32_t* feedback = FeedbackMapped + frameIndex * (FeedbackRegionBytes / sizeof(uint32_t));
+        std::vector<uint32_t> requests;
+        for (uint32_t i = 0; i < Settings.FeedbackCapacity; i++)
+        {
+            if (feedback[i] & RequestValid)
+            {
+                requests.push_back(feedback[i]);
+            }
+        }
+        memset(feedback, 0, Settings.FeedbackCapacity * sizeof(uint32_t));
+
+        std::sort(requests.begin(), requests.end());
+        requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+        Stats.Requested = static_cast<uint32_t>(requests.size());
+        Stats.Missing = 0;
+
+        for (uint32_t request : requests)
+        {
+            BrickKey key = {
+                (request >> 27) & 0xF,
+                {request & 0x1FF, (request >> 9) & 0x1FF, (request >> 18) & 0x1FF}
+            };
+            if (key.Level >= LevelCount ||
+                glm::any(glm::greaterThanEqual(key.Brick, glm::uvec3(Info.LevelGrid[key.Level]))))
+            {
+                continue;
+            }
+
+            // Shader fell back to an ancestor meanwhile, so the whole chain is in use
+            bool resident = true;
+            for (BrickKey chain = key; chain.Level < LevelCount; chain.Level++, chain.Brick /= 2u)
+            {
+                uint32_t slot = FindSlot(GetPage(chain));
+                if (slot != InvalidSlot)
+                {
+                    Touch(slot);
+                }
+                else
+                {
+                    missing.push_back(chain);
+                    resident = resident && chain.Level != key.Level;
+                }
+            }
+            Stats.Missing += resident ? 0 : 1;
+        }
+
+        // Coarse levels first, a child is never worth more than its parent
+        std::sort(missing.begin(), missing.end(), [this](const BrickKey& a, const BrickKey& b)
+        {
+            return a.Level != b.Level ? a.Level > b.Level : GetPage(a) < GetPage(b);
+        });
+        missing.erase(std::unique(missing.begin(), missing.end(), [this](const BrickKey& a, const BrickKey& b)
+        {
+            return GetPage(a) == GetPage(b);
+        }), missing.end());
+    }
+
+    void VirtualVolume::RecordUploads(uint32_t frameIndex, const std::vector<BrickKey>& missing)
+    {
+        VkDeviceSize regionOffset = frameIndex * StagingRegionBytes;
+        uint8_t* region = StagingMapped + regionOffset;
+
+        std::vector<VkBufferImageCopy> brickCopies;
+        for (const BrickKey& key : missing)
+        {
+            if (brickCopies.size() == Settings.UploadsPerFrame)
+            {
+                break;
+            }
+
+            // Atlas is full of bricks used this frame, the rest waits for them to go out of view
+            uint32_t slot = AcquireSlot();
+            if (slot == InvalidSlot)
+            {
+                break;
+            }
+
+            VkDeviceSize offset = brickCopies.size() * BrickBytes;
+            LoadBrick(key, slot, region + offset);
+            Touch(slot);
+            brickCopies.push_back(GetBrickCopy(slot, regionOffset + offset));
+        }
+        Stats.Uploaded = static_cast<uint32_t>(brickCopies.size());
+
+        if (DirtyPages.empty())
+        {
+            return;
+        }
+
+        // Entries go after the bricks, runs of neighbouring pages are copied at once
+        std::sort(DirtyPages.begin(), DirtyPages.end());
+        DirtyPages.erase(std::unique(DirtyPages.begin(), DirtyPages.end()), DirtyPages.end());
+
+        VkDeviceSize pagesOffset = Settings.UploadsPerFrame * BrickBytes;
+        auto entries = reinterpret_cast<uint32_t*>(region + pagesOffset);
+        std::vector<VkBufferCopy> pageCopies;
+        for (size_t i = 0; i < DirtyPages.size(); i++)
+        {
+            uint32_t page = DirtyPages[i];
+            entries[i] = Pages[page];
+            if (i > 0 && page == DirtyPages[i - 1] + 1)
+            {
+                pageCopies.back().size += sizeof(uint32_t);
+                continue;
+            }
+            pageCopies.push_back({regionOffset + pagesOffset + i * sizeof(uint32_t), page * sizeof(uint32_t), sizeof(uint32_t)});
+        }
+        DirtyPages.clear();
+
+        VkBuffer staging = Staging;
+        VkBuffer pageTable = PageTable;
+        VkImage atlas = Atlas;
+        Owner.EnqueueCommands(CommandStage::BeforePasses,
+            [staging, pageTable, atlas, brickCopies = std::move(brickCopies), pageCopies = std::move(pageCopies)]
+            (VkCommandBuffer commandBuffer, uint32_t)
+            {
+                PROFILE_SCOPE("RecordBrickUploads");
+
+                // Previous frames might still sample the slots and read the entries being replaced
+                VkImageMemoryBarrier imageBarrier{};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = atlas;
+                imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                imageBarrier.srcAccessMask = 0;
+                imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+                VkBufferMemoryBarrier bufferBarrier{};
+                bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                bufferBarrier.srcAccessMask = 0;
+                bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                bufferBarrier.buffer = pageTable;
+                bufferBarrier.offset = 0;
+                bufferBarrier.size = VK_WHOLE_SIZE;
+
+                bool bricks = !brickCopies.empty();
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     0, 0, nullptr, 1, &bufferBarrier, bricks ? 1 : 0, &imageBarrier);
+
+                if (bricks)
+                {
+                    vkCmdCopyBufferToImage(commandBuffer, staging, atlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                           static_cast<uint32_t>(brickCopies.size()), brickCopies.data());
+                }
+                vkCmdCopyBuffer(commandBuffer, staging, pageTable, static_cast<uint32_t>(pageCopies.size()), pageCopies.data());
+
+                imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                     0, 0, nullptr, 1, &bufferBarrier, bricks ? 1 : 0, &imageBarrier);
+            });
+    }
+
+    uint32_t VirtualVolume::GetPage(const BrickKey& key) const
+    {
+        const glm::uvec4& grid = Info.LevelGrid[key.Level];
+        return grid.w + key.Brick.x + grid.x * (key.Brick.y + grid.y * key.Brick.z);
+    }
+
+    uint32_t VirtualVolume::FindSlot(uint32_t page) const
+    {
+        uint32_t entry = Pages[page];
+        if (!(entry & PageResident))
+        {
+            return InvalidSlot;
+        }
+        uint32_t x = entry & 0xFF;
+        uint32_t y = (entry >> 8) & 0xFF;
+        uint32_t z = (entry >> 16) & 0xFF;
+        return x + AtlasBricks * (y + AtlasBricks * z);
+    }
+
+    void VirtualVolume::Touch(uint32_t slot)
+    {
+        auto& entry = Slots[slot];
+        entry.LastUsed = FrameNumber;
+        if (entry.Pinned || Head == slot)
+        {
+            return;
+        }
+
+        // Only the head has no previous slot
+        if (entry.Previous != InvalidSlot)
+        {
+            Unlink(slot);
+        }
+
+        entry.Next = Head;
+        if (Head != InvalidSlot)
+        {
+            Slots[Head].Previous = slot;
+        }
+        else
+        {
+            Tail = slot;
+        }
+        Head = slot;
+    }
+
+    void VirtualVolume::Unlink(uint32_t slot)
+    {
+        auto& entry = Slots[slot];
+        if (entry.Previous != InvalidSlot)
+        {
+            Slots[entry.Previous].Next = entry.Next;
+        }
+        else
+        {
+            Head = entry.Next;
+        }
+
+        if (entry.Next != InvalidSlot)
+        {
+            Slots[entry.Next].Previous = entry.Previous;
+        }
+        else
+        {
+            Tail = entry.Previous;
+        }
+        entry.Previous = InvalidSlot;
+        entry.Next = InvalidSlot;
+    }
+
+    uint32_t VirtualVolume::AcquireSlot()
+    {
+        if (!FreeSlots.empty())
+        {
+            uint32_t slot = FreeSlots.back();
+            FreeSlots.pop_back();
+            return slot;
+        }
+
+        if (Tail == InvalidSlot || Slots[Tail].LastUsed == FrameNumber)
+        {
+            return InvalidSlot;
+        }
+
+        uint32_t slot = Tail;
+        Unlink(slot);
+        auto& entry = Slots[slot];
+        Pages[entry.Page] = 0;
+        DirtyPages.push_back(entry.Page);
+        entry.Page = InvalidPage;
+        Stats.Resident--;
+        Stats.Evicted++;
+        return slot;
+    }
+
+    void VirtualVolume::LoadBrick(const BrickKey& key, uint32_t slot, uint8_t* staging)
+    {
+        PROFILE_FUNCTION();
+
+        glm::ivec3 origin = glm::ivec3(key.Brick * Settings.BrickSize) - static_cast<int32_t>(Border);
+        Source->Read(key.Level, origin, glm::uvec3(PaddedSize), staging);
+
+        uint32_t page = GetPage(key);
+        uint32_t x = slot % AtlasBricks;
+        uint32_t y = (slot / AtlasBricks) % AtlasBricks;
+        uint32_t z = slot / (AtlasBricks * AtlasBricks);
+        Pages[page] = PageResident | x | (y << 8) | (z << 16);
+        DirtyPages.push_back(page);
+
+        Slots[slot].Page = page;
+        Slots[slot].LastUsed = FrameNumber;
+        Stats.Resident++;
+    }
+
+    VkBufferImageCopy VirtualVolume::GetBrickCopy(uint32_t slot, VkDeviceSize stagingOffset) const
+    {
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingOffset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset = {
+            static_cast<int32_t>(slot % AtlasBricks * PaddedSize),
+            static_cast<int32_t>((slot / AtlasBricks) % AtlasBricks * PaddedSize),
+            static_cast<int32_t>(slot / (AtlasBricks * AtlasBricks) * PaddedSize)
+        };
+        region.imageExtent = {PaddedSize, PaddedSize, PaddedSize};
+        return region;
+    }
+
+    VkDescriptorSet VirtualVolume::WriteDescriptorSet()
+    {
+        // Offsets of the info and the feedback are supplied at bind time
+        DescriptorSetWriter writer{*Layout, Owner.GetDescriptorAllocator(), DescriptorLifetime::Cached};
+        writer.WriteImage(0, AtlasView, AtlasSampler);
+        writer.WriteBuffer(1, Owner.GetUniformRing().GetBuffer(), 0, sizeof(ShaderInfo));
+        writer.WriteBuffer(2, PageTable, 0, VK_WHOLE_SIZE);
+        writer.WriteBuffer(3, Feedback, 0, Settings.FeedbackCapacity * sizeof(uint32_t));
+        return writer.Write();
+    }
+
+    void VirtualVolume::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex)
+    {
+        VkDescriptorSet set = WriteDescriptorSet();
+        uint32_t offsets[] = {
+            InfoOffset,
+            static_cast<uint32_t>(Owner.GetCurrentFrame() * FeedbackRegionBytes)
+        };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                                setIndex, 1, &set, 2, offsets);
+    }
+}
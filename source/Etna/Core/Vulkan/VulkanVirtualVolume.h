@@ -0,0 +1,194 @@
+/*
+ * Volume streamed into a fixed size brick atlas, for volumes larger than device memory.
+ * The source is split into bricks of BrickSize^3 voxels on every level of detail.
+ * A brick is uploaded with a one voxel border, so linear filtering never reads its neighbours.
+ * A page table maps (level, brick) to an atlas slot. Shaders fall back to the nearest
+ * coarser resident level, and record the bricks they wanted into a feedback buffer.
+ * The CPU reads the feedback frames in flight later, uploads missing bricks coarse first
+ * within a per-frame budget and evicts the least recently used ones.
+ * The coarsest level is a single brick, pinned for the lifetime of the source.
+ * Feedback is written by fragment shaders, see Context::SupportsFragmentStores.
+ */
+
+#ifndef VULKANVIRTUALVOLUME_H
+#define VULKANVIRTUALVOLUME_H
+
+#include "VulkanDescriptors.h"
+
+#include "Etna/Core/VolumeSource.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace vkc
+{
+    class Renderer;
+
+    struct VirtualVolumeSettings
+    {
+        // Voxels per brick side, without the border
+        uint32_t BrickSize = 64;
+        // Device memory of the atlas, which holds as many bricks as fit into it
+        VkDeviceSize AtlasBytes = 512ull * 1024 * 1024;
+        // Bricks per side of the atlas, overrides the budget when not zero
+        uint32_t AtlasBricks = 0;
+        // Bricks read from the source and uploaded in one frame at most
+        uint32_t UploadsPerFrame = 16;
+        // Slots of the hashed feedback of every frame in flight
+        uint32_t FeedbackCapacity = 4096;
+        // Positive values prefer coarser levels
+        float LodBias = 0.0f;
+    };
+
+    struct VirtualVolumeStats
+    {
+        uint32_t Slots;     // Bricks the atlas holds
+        uint32_t Resident;  // Slots in use, the pinned ones included
+        uint32_t Requested; // Distinct bricks in the last feedback
+        uint32_t Missing;   // Of them, not resident when read
+        uint32_t Uploaded;  // Bricks uploaded this frame
+        uint64_t Evicted;   // Bricks evicted since the source was set
+    };
+
+    class VirtualVolume
+    {
+    public:
+        /// Have to match shaders/frag_virtual.glsl
+        static constexpr uint32_t Border = 1;
+        static constexpr uint32_t MaxLevels = 12;
+
+        // Page table entry: resident bit and the atlas slot, 8 bits per axis
+        static constexpr uint32_t PageResident = 1u << 31;
+        // Feedback entry: valid bit, level in 4 bits and the brick, 9 bits per axis
+        static constexpr uint32_t RequestValid = 1u << 31;
+        static constexpr uint32_t MaxAtlasBricks = 255;
+        static constexpr uint32_t MaxGridBricks = 511;
+
+        /// Uniform block of the shaders, std140
+        struct ShaderInfo
+        {
+            glm::vec4 AtlasScale;             // xyz one over atlas texels per axis, w unused
+            glm::uvec4 Layout;                // Brick size, border, level count, feedback capacity
+            glm::vec4 Lod;                    // x level 0 voxels a pixel covers at unit distance, y bias
+            glm::uvec4 Frame;                 // x feedback phase
+            glm::uvec4 LevelGrid[MaxLevels];  // xyz bricks per axis, w first page of the level
+            glm::vec4 LevelExtent[MaxLevels]; // xyz voxels per axis
+        };
+
+    public:
+        /// Creates the atlas and the feedback, the set layout is valid right away
+        VirtualVolume(Renderer& renderer, const VirtualVolumeSettings& settings = {});
+        ~VirtualVolume();
+
+        VirtualVolume(const VirtualVolume&) = delete;
+        VirtualVolume& operator=(const VirtualVolume&) = delete;
+
+        /// Start streaming another volume, uploads its pinned level. Waits for the device to idle.
+        void SetSource(std::shared_ptr<VolumeSource> source);
+
+        /// Read the feedback of this frame in flight, record the uploads it asks for
+        /// and push the shader info. Must be called between BeginFrame and EndFrame.
+        /// Pixel angle is the view angle of a pixel, in radians. View goes to the source.
+        void Update(float pixelAngle, const VolumeView& view);
+
+        /// Bind the set with this frame's dynamic offsets
+        void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex);
+
+        [[nodiscard]] bool HasSource() const { return Source != nullptr; }
+        [[nodiscard]] VolumeSource* GetSource() const { return Source.get(); }
+        [[nodiscard]] const DescriptorSetLayout& GetLayout() const { return *Layout; }
+        [[nodiscard]] const VirtualVolumeStats& GetStats() const { return Stats; }
+
+    private:
+        struct Slot
+        {
+            uint32_t Page = InvalidPage;
+            uint64_t LastUsed = 0;
+            bool Pinned = false;
+            // Intrusive LRU list, most recent at the head
+            uint32_t Previous = InvalidSlot;
+            uint32_t Next = InvalidSlot;
+        };
+
+        struct BrickKey
+        {
+            uint32_t Level;
+            glm::uvec3 Brick;
+        };
+
+        static constexpr uint32_t InvalidPage = ~0u;
+        static constexpr uint32_t InvalidSlot = ~0u;
+
+        void CreateAtlas();
+        void CreateBuffers();
+
+        [[nodiscard]] uint32_t GetPage(const BrickKey& key) const;
+        [[nodiscard]] uint32_t FindSlot(uint32_t page) const;
+
+        void Touch(uint32_t slot);
+        void Unlink(uint32_t slot);
+        /// Free slot or the least recently used one, which wasn't used this frame
+        uint32_t AcquireSlot();
+
+        /// Fill a staging brick and point the page at the slot
+        void LoadBrick(const BrickKey& key, uint32_t slot, uint8_t* staging);
+        [[nodiscard]] VkBufferImageCopy GetBrickCopy(uint32_t slot, VkDeviceSize stagingOffset) const;
+
+        void ReadFeedback(uint32_t frameIndex, std::vector<BrickKey>& missing);
+        void RecordUploads(uint32_t frameIndex, const std::vector<BrickKey>& missing);
+
+        VkDescriptorSet WriteDescriptorSet();
+
+    private:
+        Renderer& Owner;
+        VirtualVolumeSettings Settings;
+        uint32_t PaddedSize;
+        VkDeviceSize BrickBytes;
+
+        // RGBA8, bricks of PaddedSize^3 texels. Always in SHADER_READ_ONLY between frames.
+        VkImage Atlas = VK_NULL_HANDLE;
+        VkDeviceMemory AtlasMemory = VK_NULL_HANDLE;
+        VkImageView AtlasView = VK_NULL_HANDLE;
+        VkSampler AtlasSampler = VK_NULL_HANDLE;
+        uint32_t AtlasBricks;
+
+        // Entries of every level back to back, mirrored on the CPU
+        VkBuffer PageTable = VK_NULL_HANDLE;
+        VkDeviceMemory PageTableMemory = VK_NULL_HANDLE;
+        std::vector<uint32_t> Pages;
+
+        // Host visible, a region per frame in flight bound with a dynamic offset
+        VkBuffer Feedback = VK_NULL_HANDLE;
+        VkDeviceMemory FeedbackMemory = VK_NULL_HANDLE;
+        uint32_t* FeedbackMapped = nullptr;
+        VkDeviceSize FeedbackRegionBytes = 0;
+        std::vector<bool> FeedbackWritten;
+
+        // Bricks and page table entries of every frame in flight
+        VkBuffer Staging = VK_NULL_HANDLE;
+        VkDeviceMemory StagingMemory = VK_NULL_HANDLE;
+        uint8_t* StagingMapped = nullptr;
+        VkDeviceSize StagingRegionBytes = 0;
+
+        std::unique_ptr<DescriptorSetLayout> Layout;
+        uint32_t InfoOffset = 0;
+
+        std::shared_ptr<VolumeSource> Source;
+        uint32_t LevelCount = 0;
+        ShaderInfo Info = {};
+
+        std::vector<Slot> Slots;
+        std::vector<uint32_t> FreeSlots;
+        uint32_t Head = InvalidSlot;
+        uint32_t Tail = InvalidSlot;
+        // Pages changed this frame, copied to the device before the passes
+        std::vector<uint32_t> DirtyPages;
+
+        uint64_t FrameNumber = 0;
+        VirtualVolumeStats Stats = {};
+    };
+}
+
+#endif //VULKANVIRTUALVOLUME_H
@@ -0,0 +1,430 @@
+#include "CpuRaymarcher.h"
+#include "CpuRaymarcherKernels.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/Utils.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static const glm::vec3 BoxMin = glm::vec3(-1.0f, -1.0f, -1.0f);
+static const glm::vec3 BoxMax = glm::vec3(1.0f, 1.0f, 1.0f);
+
+// Adaptive stepping constants of VolumeMarch.glsl
+static constexpr float MinStepScale = 0.5f;
+static constexpr float MaxStepScale = 4.0f;
+static constexpr float ActivityRange = 0.1f;
+static constexpr int32_t MaxAdaptiveSamples = 2048;
+
+/// Box-local distance to the nearest occluder in front of the camera, infinite if there's none.
+/// Shade is the one of the face the ray enters it through.
+static float IntersectOccluders(const MarchContext& context, glm::vec3 origin, glm::vec3 direction, float& shade)
+{
+    float nearest = std::numeric_limits<float>::infinity();
+    for (uint32_t i = 0; i < context.OccluderCount; i++)
+    {
+        // Transform is affine, so distances along the ray don't change
+        glm::mat4 occluderFromLocal = glm::make_mat4(context.OccluderFromLocal + i * 16);
+        glm::vec3 occluderOrigin = glm::vec3(occluderFromLocal * glm::vec4(origin, 1.0f));
+        glm::vec3 occluderDirection = glm::mat3(occluderFromLocal) * direction;
+
+        glm::vec3 tMin = (BoxMin - occluderOrigin) / occluderDirection;
+        glm::vec3 tMax = (BoxMax - occluderOrigin) / occluderDirection;
+        glm::vec3 t1 = glm::min(tMin, tMax);
+        glm::vec3 t2 = glm::max(tMin, tMax);
+        float tNear = std::max(std::max(t1.x, t1.y), t1.z);
+        float tFar = std::min(std::min(t2.x, t2.y), t2.z);
+
+        // Back faces are culled, an occluder around the camera isn't drawn at all
+        if (tNear < tFar && tNear > 0.0f && tNear < nearest)
+        {
+            nearest = tNear;
+            int axis = t1.x >= t1.y && t1.x >= t1.z ? 0 : (t1.y >= t1.z ? 1 : 2);
+            shade = OccluderFaceShades[axis];
+        }
+    }
+    return nearest;
+}
+
+bool SetupMarchRay(const MarchContext& context, uint32_t x, uint32_t y, MarchRay& ray)
+{
+    glm::mat4 localFromClip = glm::make_mat4(context.LocalFromClip);
+    glm::vec3 cameraLocal = glm::make_vec3(context.CameraLocal);
+
+    // Center of the pixel on the far plane. Viewport's y points down, as in Vulkan.
+    glm::vec4 ndc = {
+        2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(context.Width) - 1.0f,
+        2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(context.Height) - 1.0f,
+        1.0f, 1.0f
+    };
+    glm::vec4 farPoint = localFromClip * ndc;
+    glm::vec3 rayDirection = glm::normalize(glm::vec3(farPoint) / farPoint.w - cameraLocal);
+
+    glm::vec3 tMin = (BoxMin - cameraLocal) / rayDirection;
+    glm::vec3 tMax = (BoxMax - cameraLocal) / rayDirection;
+    glm::vec3 t1 = glm::min(tMin, tMax);
+    glm::vec3 t2 = glm::max(tMin, tMax);
+    float tNear = std::max(std::max(t1.x, t1.y), t1.z);
+    float tFar = std::min(std::min(t2.x, t2.y), t2.z);
+
+    ray.Background = 0.0f;
+    float tOpaque = IntersectOccluders(context, cameraLocal, rayDirection, ray.Background);
+
+    // Near plane clips the cube, the GPU switches to a full-screen triangle then, see NeedsFullscreenMarch
+    tNear = std::max(tNear, context.NearPlane / glm::dot(rayDirection, glm::make_vec3(context.CameraForward)));
+    if (tNear >= tFar)
+    {
+        return false;
+    }
+
+    // Depth test drops the cube's fragment if the occluder is in front of it, otherwise the ray ends there
+    bool hidden = tOpaque <= tNear;
+    float tEnd = hidden ? tNear : std::min(tFar, tOpaque);
+
+    glm::vec3 pointIn = cameraLocal + rayDirection * tNear;
+    glm::vec3 pointOut = cameraLocal + rayDirection * tEnd;
+    glm::vec3 stepVector = context.StepSize * rayDirection;
+    ray.Steps = std::min(context.MaxSteps, static_cast<int32_t>(glm::distance(pointIn, pointOut) / context.StepSize));
+
+    glm::vec3 pointFar = cameraLocal + rayDirection * tFar;
+    int32_t fullSteps = std::min(context.MaxSteps, static_cast<int32_t>(glm::distance(pointIn, pointFar) / context.StepSize));
+    ray.OccludedSteps = fullSteps - ray.Steps;
+    ray.OccludedLength = tFar - tEnd;
+
+    glm::vec3 boxRange = glm::abs(BoxMax - BoxMin);
+    pointIn = (pointIn - BoxMin) / boxRange;
+    stepVector /= boxRange;
+    glm::vec3 direction = rayDirection / boxRange;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        ray.Position[axis] = pointIn[axis];
+        ray.Step[axis] = stepVector[axis];
+        ray.Direction[axis] = direction[axis];
+    }
+    ray.Near = tNear;
+    ray.Length = tEnd - tNear;
+
+    return !hidden;
+}
+
+uint8_t ResolveMarchColor(float accumulated, float background)
+{
+    // Beer-Lambert, the white media's opacity is its premultiplied color
+    float color = 1.0f - std::exp(std::min(-accumulated, 0.0f));
+    color += background * (1.0f - color);
+    return static_cast<uint8_t>(std::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static int32_t MirrorTexel(int32_t index, int32_t size)
+{
+    int32_t period = size * 2;
+    int32_t r = index % period;
+    if (r < 0)
+    {
+        r += period;
+    }
+    return r >= size ? period - 1 - r : r;
+}
+
+/// Trilinear fetch of a single channel with linear filter and mirrored repeat
+static float SampleChannel(const MarchContext& context, const float position[3], int channel)
+{
+    int32_t i0[3], i1[3];
+    float f[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float u = position[axis] * static_cast<float>(context.Size) - 0.5f;
+        float base = std::floor(u);
+        f[axis] = u - base;
+        i0[axis] = MirrorTexel(static_cast<int32_t>(base), context.Size);
+        i1[axis] = MirrorTexel(static_cast<int32_t>(base) + 1, context.Size);
+    }
+
+    auto fetch = [&](int32_t x, int32_t y, int32_t z)
+    {
+        size_t index = (static_cast<size_t>(z) * context.Size + y) * context.Size + x;
+        return static_cast<float>(context.Texels[index * 4 + channel]);
+    };
+    auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+
+    float c00 = lerp(fetch(i0[0], i0[1], i0[2]), fetch(i1[0], i0[1], i0[2]), f[0]);
+    float c10 = lerp(fetch(i0[0], i1[1], i0[2]), fetch(i1[0], i1[1], i0[2]), f[0]);
+    float c01 = lerp(fetch(i0[0], i0[1], i1[2]), fetch(i1[0], i0[1], i1[2]), f[0]);
+    float c11 = lerp(fetch(i0[0], i1[1], i1[2]), fetch(i1[0], i1[1], i1[2]), f[0]);
+    float c0 = lerp(c00, c10, f[1]);
+    float c1 = lerp(c01, c11, f[1]);
+
+    return lerp(c0, c1, f[2]) * (1.0f / 255.0f);
+}
+
+/// Combined density of the four channels at the position, as SampleDensity of VolumeMarch.glsl
+static float SampleDensity(const MarchContext& context, const float position[3])
+{
+    float samples[4];
+    for (int channel = 0; channel < 4; channel++)
+    {
+        float channelPosition[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            channelPosition[axis] = position[axis] * context.Scales[channel] + context.Offsets[channel][axis];
+        }
+        samples[channel] = SampleChannel(context, channelPosition, channel);
+    }
+    return (samples[0] * samples[1]) * (samples[2] + samples[3]) * 0.2f;
+}
+
+/// Optical depth of the ray with steps adapted to the media and the pixel footprint, as MarchAdaptive.
+/// Occluded part of the ray is marched on without accumulating, only to count its samples.
+static float MarchAdaptive(const MarchContext& context, const MarchRay& ray, int32_t& samples, int32_t& occludedSamples)
+{
+    float baseStep = context.StepSize / context.StepQuality;
+    float fullLength = ray.Length + ray.OccludedLength;
+    float previous = SampleDensity(context, ray.Position);
+    float change = 0.0f;
+    float accumulated = 0.0f;
+    float t = 0.0f;
+
+    int32_t i = 1;
+    int32_t marched = 1;
+    for (; i < MaxAdaptiveSamples && t < fullLength; i++)
+    {
+        bool occluded = t >= ray.Length;
+        float activity = std::max(previous, change * 2.0f);
+        float smoothness = 1.0f - std::clamp(activity / ActivityRange, 0.0f, 1.0f);
+        float stepLength = baseStep * (MinStepScale + (MaxStepScale - MinStepScale) * smoothness);
+        stepLength = std::max(stepLength, (ray.Near + t) * context.PixelAngle);
+        stepLength = std::min(stepLength, (occluded ? fullLength : ray.Length) - t);
+        t += stepLength;
+
+        float position[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            position[axis] = ray.Position[axis] + ray.Direction[axis] * t;
+        }
+        float current = SampleDensity(context, position);
+        if (!occluded)
+        {
+            accumulated += (previous + current) * 0.5f * stepLength;
+            marched = i + 1;
+        }
+        change = std::abs(current - previous);
+        previous = current;
+    }
+
+    samples = marched;
+    occludedSamples = i - marched;
+    return accumulated;
+}
+
+MarchTileStats MarchTileScalar(const MarchContext& context, const MarchTile& tile, uint8_t* pixels)
+{
+    MarchTileStats stats{};
+    for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++)
+    {
+        for (uint32_t x = tile.X; x < tile.X + tile.Width; x++)
+        {
+            uint8_t* pixel = pixels + (static_cast<size_t>(y) * context.Width + x) * 4;
+
+            MarchRay ray{};
+            bool covered = SetupMarchRay(context, x, y, ray);
+            pixel[3] = 255;
+            if (!covered)
+            {
+                pixel[0] = pixel[1] = pixel[2] = ResolveMarchColor(0.0f, ray.Background);
+
+                // Cube behind an occluder isn't marched at all
+                if (ray.OccludedLength > 0.0f)
+                {
+                    int32_t samples = 0, occludedSamples = ray.OccludedSteps;
+                    if (context.StepQuality > 0.0f)
+                    {
+                        // Nothing in front of the occluder, only the sample counts are wanted
+                        MarchAdaptive(context, ray, samples, occludedSamples);
+                        occludedSamples += samples;
+                    }
+                    stats.OccludedSamples += static_cast<uint64_t>(occludedSamples);
+                }
+                continue;
+            }
+
+            float accumulated = 0.0f;
+            int32_t samples = ray.Steps;
+            int32_t occludedSamples = ray.OccludedSteps;
+            if (context.StepQuality > 0.0f)
+            {
+                accumulated = MarchAdaptive(context, ray, samples, occludedSamples);
+            }
+            else
+            {
+                for (int32_t i = 0; i < ray.Steps; i++)
+                {
+                    accumulated += SampleDensity(context, ray.Position);
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        ray.Position[axis] += ray.Step[axis];
+                    }
+                }
+                accumulated *= context.StepSize;
+            }
+
+            pixel[0] = pixel[1] = pixel[2] = ResolveMarchColor(accumulated, ray.Background);
+
+            stats.Rays++;
+            stats.Samples += static_cast<uint64_t>(samples);
+            stats.OccludedSamples += static_cast<uint64_t>(occludedSamples);
+        }
+    }
+    return stats;
+}
+
+CpuRaymarcher::CpuRaymarcher(uint32_t threadCount)
+    : Pool(threadCount)
+{
+}
+
+CpuRaymarchStats CpuRaymarcher::Render(const ObjectShaderData& osd, const GlobalShaderData& gsd,
+                                       const uint8_t* volume, uint32_t volumeSize,
+                                       uint32_t width, uint32_t height, std::vector<uint8_t>& pixels,
+                                       CpuRaymarchPath path)
+{
+    PROFILE_FUNCTION();
+
+    // Adaptive steps diverge between the lanes of a packet, so they are marched one ray at a time
+    bool adaptive = gsd.StepQuality > 0.0f;
+    if (path == CpuRaymarchPath::Auto)
+    {
+        path = IsAvx2Supported() && !adaptive ? CpuRaymarchPath::Avx2 : CpuRaymarchPath::Scalar;
+    }
+    else if (path == CpuRaymarchPath::Avx2 && adaptive)
+    {
+        Warning("AVX2 kernel marches fixed steps only, falling back to the scalar raymarcher.");
+        path = CpuRaymarchPath::Scalar;
+    }
+    else if (path == CpuRaymarchPath::Avx2 && !IsAvx2Supported())
+    {
+        Warning("AVX2 is not available, falling back to the scalar raymarcher.");
+        path = CpuRaymarchPath::Scalar;
+    }
+
+    MarchContext context{};
+    context.Texels = volume;
+    context.Size = static_cast<int32_t>(volumeSize);
+    for (int channel = 0; channel < 4; channel++)
+    {
+        context.Scales[channel] = MediaChannelScales[channel];
+        glm::vec3 offset = GetMediaOffset(gsd, channel);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            context.Offsets[channel][axis] = offset[axis];
+        }
+    }
+
+    glm::mat4 localFromClip = gsd.WorldToLocal * glm::inverse(osd.Projection * osd.View);
+    std::memcpy(context.LocalFromClip, glm::value_ptr(localFromClip), sizeof(context.LocalFromClip));
+    glm::vec3 cameraLocal = glm::vec3(gsd.WorldToLocal * glm::vec4(gsd.CameraPosition, 1.0f));
+    std::memcpy(context.CameraLocal, glm::value_ptr(cameraLocal), sizeof(context.CameraLocal));
+    glm::vec3 cameraForward = glm::vec3(gsd.CameraForward);
+    std::memcpy(context.CameraForward, glm::value_ptr(cameraForward), sizeof(context.CameraForward));
+    context.NearPlane = gsd.DepthScale / gsd.DepthBias;
+
+    context.MaxSteps = std::max(gsd.MaxSteps, 1);
+    context.StepSize = (1.0f / static_cast<float>(context.MaxSteps)) * 4.0f;
+    context.StepQuality = std::min(gsd.StepQuality, MaxStepQuality);
+    // Same as VolumeScene::GetPixelAngle, recovered from the projection
+    context.PixelAngle = 2.0f / (std::abs(osd.Projection[1][1]) * static_cast<float>(std::max(height, 1u)));
+    context.Width = width;
+    context.Height = height;
+
+    // Straight from the cube's local space into each occluder's, through the world
+    std::vector<float> occluderFromLocal(Occluders.size() * 16);
+    glm::mat4 worldFromLocal = glm::inverse(gsd.WorldToLocal);
+    for (size_t i = 0; i < Occluders.size(); i++)
+    {
+        glm::mat4 transform = glm::inverse(Occluders[i]) * worldFromLocal;
+        std::memcpy(occluderFromLocal.data() + i * 16, glm::value_ptr(transform), 16 * sizeof(float));
+    }
+    context.OccluderFromLocal = occluderFromLocal.data();
+    context.OccluderCount = static_cast<uint32_t>(Occluders.size());
+
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+
+    uint32_t tilesX = (width + TileSize - 1) / TileSize;
+    uint32_t tilesY = (height + TileSize - 1) / TileSize;
+    auto kernel = path == CpuRaymarchPath::Avx2 ? &MarchTileAvx2 : &MarchTileScalar;
+
+    std::atomic<uint64_t> rays = 0;
+    std::atomic<uint64_t> samples = 0;
+    std::atomic<uint64_t> occludedSamples = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    Pool.ParallelFor(tilesX * tilesY, [&](uint32_t index)
+    {
+        PROFILE_SCOPE("MarchTile");
+
+        MarchTile tile{};
+        tile.X = (index % tilesX) * TileSize;
+        tile.Y = (index / tilesX) * TileSize;
+        tile.Width = std::min(TileSize, width - tile.X);
+        tile.Height = std::min(TileSize, height - tile.Y);
+
+        MarchTileStats tileStats = kernel(context, tile, pixels.data());
+        rays += tileStats.Rays;
+        samples += tileStats.Samples;
+        occludedSamples += tileStats.OccludedSamples;
+    });
+    auto end = std::chrono::steady_clock::now();
+
+    CpuRaymarchStats stats{};
+    stats.Path = path;
+    stats.Rays = rays.load();
+    stats.Samples = samples.load();
+    stats.OccludedSamples = occludedSamples.load();
+    stats.Seconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+}
+
+bool CpuRaymarcher::IsAvx2Supported()
+{
+    if (!IsAvx2KernelCompiled())
+    {
+        return false;
+    }
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    // OS has to preserve YMM registers
+    if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
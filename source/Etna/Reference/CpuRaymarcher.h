@@ -0,0 +1,67 @@
+/*
+ * CPU reference implementation of frag.glsl.
+ * Consumes the same shader data and the same packed volume as the GPU,
+ * so it can be used as a regression oracle on machines without one.
+ */
+
+#ifndef CPURAYMARCHER_H
+#define CPURAYMARCHER_H
+
+#include "Etna/Core/ThreadPool.h"
+#include "Etna/Scene/ShaderData.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class CpuRaymarchPath
+{
+    Auto,   // AVX2 when the CPU has it
+    Scalar,
+    Avx2,
+};
+
+struct CpuRaymarchStats
+{
+    CpuRaymarchPath Path = CpuRaymarchPath::Scalar;
+    uint64_t Rays = 0;      // Pixels covered by the cube
+    uint64_t Samples = 0;   // Marching steps, each of them is four texture fetches
+    // Steps the rays would have taken behind the occluders, or in the cube they hide.
+    // Counting them marches the hidden part of adaptive rays too, so it shows in Seconds.
+    uint64_t OccludedSamples = 0;
+    double Seconds = 0.0;
+
+    [[nodiscard]] double GetRaysPerSecond() const { return Seconds > 0.0 ? static_cast<double>(Rays) / Seconds : 0.0; }
+    [[nodiscard]] double GetSamplesPerSecond() const { return Seconds > 0.0 ? static_cast<double>(Samples) / Seconds : 0.0; }
+};
+
+class CpuRaymarcher
+{
+public:
+    static constexpr uint32_t TileSize = 32;
+
+public:
+    /// Zero picks one thread per hardware thread
+    explicit CpuRaymarcher(uint32_t threadCount = 0);
+
+    /// Render RGBA8 image of the volume the way the GPU would, into a cleared black target.
+    /// Volume is size^3 RGBA8 texels, as produced by GenerateNoiseVolume.
+    /// Occluders are drawn first and end the rays, as VolumeScene does.
+    CpuRaymarchStats Render(const ObjectShaderData& osd, const GlobalShaderData& gsd,
+                            const uint8_t* volume, uint32_t volumeSize,
+                            uint32_t width, uint32_t height, std::vector<uint8_t>& pixels,
+                            CpuRaymarchPath path = CpuRaymarchPath::Auto);
+
+    /// Same boxes as VolumeScene::SetOccluders, in world space
+    void SetOccluders(std::vector<glm::mat4> models) { Occluders = std::move(models); }
+
+    [[nodiscard]] uint32_t GetThreadCount() const { return Pool.GetThreadCount(); }
+
+    /// CPU and OS both support AVX2 and FMA, and the kernel was compiled in
+    [[nodiscard]] static bool IsAvx2Supported();
+
+private:
+    ThreadPool Pool;
+    std::vector<glm::mat4> Occluders;
+};
+
+#endif //CPURAYMARCHER_H
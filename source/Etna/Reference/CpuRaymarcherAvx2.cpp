@@ -0,0 +1,200 @@
+/*
+ * AVX2 kernel of the CPU raymarcher. Marches packets of eight horizontally
+ * adjacent rays, lanes drop out of accumulation as their own step count runs out.
+ * Only this file is compiled with AVX2 enabled, see CpuRaymarcherKernels.h for the rules.
+ */
+
+#include "CpuRaymarcherKernels.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+static constexpr int PacketSize = 8;
+
+struct PacketConstants
+{
+    __m256 Size;
+    __m256 Period;
+    __m256 InversePeriod;
+    __m256 LastInPeriod;
+    __m256i SizeInt;
+    __m256i ByteMask;
+};
+
+/// Mirrored repeat of whole texel indices, kept in float since they are small
+static inline __m256i MirrorTexels(__m256 index, const PacketConstants& constants)
+{
+    __m256 wraps = _mm256_floor_ps(_mm256_mul_ps(index, constants.InversePeriod));
+    __m256 r = _mm256_fnmadd_ps(wraps, constants.Period, index);
+
+    // Reciprocal might be off by an ulp at the period's multiples
+    r = _mm256_sub_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, constants.Period, _CMP_GE_OQ), constants.Period));
+    r = _mm256_add_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, _mm256_setzero_ps(), _CMP_LT_OQ), constants.Period));
+
+    __m256 mirrored = _mm256_sub_ps(constants.LastInPeriod, r);
+    r = _mm256_blendv_ps(r, mirrored, _mm256_cmp_ps(r, constants.Size, _CMP_GE_OQ));
+    return _mm256_cvttps_epi32(r);
+}
+
+static inline __m256 Lerp(__m256 a, __m256 b, __m256 t)
+{
+    return _mm256_fmadd_ps(_mm256_sub_ps(b, a), t, a);
+}
+
+static inline __m256 Fetch(const int* texels, __m256i x, __m256i y, __m256i z, __m128i shift,
+                           const PacketConstants& constants)
+{
+    __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(z, constants.SizeInt), y), constants.SizeInt), x);
+    __m256i texel = _mm256_i32gather_epi32(texels, index, 4);
+    return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(texel, shift), constants.ByteMask));
+}
+
+static inline __m256 SampleChannel(const MarchContext& context, const __m256 position[3], int channel,
+                                   const PacketConstants& constants)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256i i0[3], i1[3];
+    __m256 f[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        __m256 u = _mm256_sub_ps(_mm256_mul_ps(position[axis], constants.Size), half);
+        __m256 base = _mm256_floor_ps(u);
+        f[axis] = _mm256_sub_ps(u, base);
+        i0[axis] = MirrorTexels(base, constants);
+        i1[axis] = MirrorTexels(_mm256_add_ps(base, one), constants);
+    }
+
+    const int* texels = reinterpret_cast<const int*>(context.Texels);
+    __m128i shift = _mm_cvtsi32_si128(channel * 8);
+
+    __m256 c00 = Lerp(Fetch(texels, i0[0], i0[1], i0[2], shift, constants), Fetch(texels, i1[0], i0[1], i0[2], shift, constants), f[0]);
+    __m256 c10 = Lerp(Fetch(texels, i0[0], i1[1], i0[2], shift, constants), Fetch(texels, i1[0], i1[1], i0[2], shift, constants), f[0]);
+    __m256 c01 = Lerp(Fetch(texels, i0[0], i0[1], i1[2], shift, constants), Fetch(texels, i1[0], i0[1], i1[2], shift, constants), f[0]);
+    __m256 c11 = Lerp(Fetch(texels, i0[0], i1[1], i1[2], shift, constants), Fetch(texels, i1[0], i1[1], i1[2], shift, constants), f[0]);
+    __m256 c0 = Lerp(c00, c10, f[1]);
+    __m256 c1 = Lerp(c01, c11, f[1]);
+
+    return _mm256_mul_ps(Lerp(c0, c1, f[2]), _mm256_set1_ps(1.0f / 255.0f));
+}
+
+MarchTileStats MarchTileAvx2(const MarchContext& context, const MarchTile& tile, uint8_t* pixels)
+{
+    PacketConstants constants{};
+    constants.Size = _mm256_set1_ps(static_cast<float>(context.Size));
+    constants.Period = _mm256_set1_ps(static_cast<float>(context.Size * 2));
+    constants.InversePeriod = _mm256_set1_ps(1.0f / static_cast<float>(context.Size * 2));
+    constants.LastInPeriod = _mm256_set1_ps(static_cast<float>(context.Size * 2 - 1));
+    constants.SizeInt = _mm256_set1_epi32(context.Size);
+    constants.ByteMask = _mm256_set1_epi32(0xFF);
+
+    const __m256 scale = _mm256_set1_ps(0.2f);
+
+    MarchTileStats stats{};
+    for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++)
+    {
+        for (uint32_t x0 = tile.X; x0 < tile.X + tile.Width; x0 += PacketSize)
+        {
+            uint32_t lanes = tile.X + tile.Width - x0;
+            lanes = lanes < PacketSize ? lanes : PacketSize;
+
+            // Transpose rays into the packet, missed and missing lanes sit at the origin with no steps
+            alignas(32) float position[3][PacketSize] = {};
+            alignas(32) float step[3][PacketSize] = {};
+            alignas(32) int32_t steps[PacketSize] = {};
+            bool covered[PacketSize] = {};
+            float background[PacketSize] = {};
+            int32_t packetSteps = 0;
+            for (uint32_t lane = 0; lane < lanes; lane++)
+            {
+                MarchRay ray{};
+                covered[lane] = SetupMarchRay(context, x0 + lane, y, ray);
+                background[lane] = ray.Background;
+                stats.OccludedSamples += static_cast<uint64_t>(ray.OccludedSteps);
+                if (!covered[lane])
+                {
+                    continue;
+                }
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    position[axis][lane] = ray.Position[axis];
+                    step[axis][lane] = ray.Step[axis];
+                }
+                steps[lane] = ray.Steps;
+                packetSteps = ray.Steps > packetSteps ? ray.Steps : packetSteps;
+
+                stats.Rays++;
+                stats.Samples += static_cast<uint64_t>(ray.Steps);
+            }
+
+            __m256 p[3], s[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                p[axis] = _mm256_load_ps(position[axis]);
+                s[axis] = _mm256_load_ps(step[axis]);
+            }
+            __m256i laneSteps = _mm256_load_si256(reinterpret_cast<const __m256i*>(steps));
+            __m256 accumulated = _mm256_setzero_ps();
+
+            for (int32_t i = 0; i < packetSteps; i++)
+            {
+                __m256 active = _mm256_castsi256_ps(_mm256_cmpgt_epi32(laneSteps, _mm256_set1_epi32(i)));
+
+                __m256 samples[4];
+                for (int channel = 0; channel < 4; channel++)
+                {
+                    __m256 channelScale = _mm256_set1_ps(context.Scales[channel]);
+                    __m256 q[3];
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        q[axis] = _mm256_fmadd_ps(p[axis], channelScale, _mm256_set1_ps(context.Offsets[channel][axis]));
+                    }
+                    samples[channel] = SampleChannel(context, q, channel, constants);
+                }
+
+                __m256 current = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(samples[0], samples[1]),
+                                                             _mm256_add_ps(samples[2], samples[3])), scale);
+                accumulated = _mm256_add_ps(accumulated, _mm256_and_ps(current, active));
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    p[axis] = _mm256_add_ps(p[axis], s[axis]);
+                }
+            }
+
+            alignas(32) float result[PacketSize];
+            _mm256_store_ps(result, _mm256_mul_ps(accumulated, _mm256_set1_ps(context.StepSize)));
+
+            for (uint32_t lane = 0; lane < lanes; lane++)
+            {
+                uint8_t* pixel = pixels + (static_cast<size_t>(y) * context.Width + x0 + lane) * 4;
+                uint8_t value = ResolveMarchColor(covered[lane] ? result[lane] : 0.0f, background[lane]);
+                pixel[0] = pixel[1] = pixel[2] = value;
+                pixel[3] = 255;
+            }
+        }
+    }
+    return stats;
+}
+
+bool IsAvx2KernelCompiled()
+{
+    return true;
+}
+
+#else
+
+MarchTileStats MarchTileAvx2(const MarchContext& context, const MarchTile& tile, uint8_t* pixels)
+{
+    return MarchTileScalar(context, tile, pixels);
+}
+
+bool IsAvx2KernelCompiled()
+{
+    return false;
+}
+
+#endif
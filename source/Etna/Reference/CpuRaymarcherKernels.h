@@ -0,0 +1,96 @@
+/*
+ * Internals shared by the scalar and the AVX2 kernels of the CPU raymarcher.
+ *
+ * CpuRaymarcherAvx2.cpp is compiled with AVX2 enabled, so it must not instantiate
+ * any inline function (glm, std) the rest of the program might pick up instead of
+ * its own copy. That's why everything here is plain data, and rays are set up
+ * by the scalar translation unit.
+ */
+
+#ifndef CPURAYMARCHERKERNELS_H
+#define CPURAYMARCHERKERNELS_H
+
+#include <cstdint>
+
+/// Everything a kernel needs, derived once per image from the shader data
+struct MarchContext
+{
+    const uint8_t* Texels;  // RGBA8, (z * Size + y) * Size + x
+    int32_t Size;
+
+    // Texture coordinate of channel c is Position * Scales[c] + Offsets[c]
+    float Scales[4];
+    float Offsets[4][3];
+
+    // Clip space straight to the cube's local space, column major.
+    // Matches the rasterized cube as long as WorldToLocal is the inverse of Model.
+    float LocalFromClip[16];
+    float CameraLocal[3];
+    // Rays start at the near plane, for a camera in or close to the cube
+    float CameraForward[3];
+    float NearPlane;
+
+    int32_t MaxSteps;
+    float StepSize;
+
+    // Adaptive stepping when above zero, the AVX2 kernel only marches fixed steps
+    float StepQuality;
+    float PixelAngle;
+
+    // Opaque boxes, a column major transform from the cube's local space into each of theirs.
+    // Rays end at the nearest one, as at the depth of the opaque pass.
+    const float* OccluderFromLocal;
+    uint32_t OccluderCount;
+
+    uint32_t Width;
+    uint32_t Height;
+};
+
+/// Part of the image processed by a single task
+struct MarchTile
+{
+    uint32_t X, Y;
+    uint32_t Width, Height;
+};
+
+struct MarchTileStats
+{
+    uint64_t Rays;
+    uint64_t Samples;
+    uint64_t OccludedSamples;
+};
+
+/// Ray in the volume's normalized [0, 1] space
+struct MarchRay
+{
+    float Position[3];
+    float Step[3];
+    int32_t Steps;
+
+    // Per unit of the box-local distance, for adaptive stepping
+    float Direction[3];
+    float Near;   // From the camera to Position, box-local
+    float Length; // Inside of the box up to the nearest occluder, box-local
+
+    // Occluder behind the pixel, zero shade if there's none
+    float Background;
+    // Part of the box behind the occluder, or all of it if the occluder hides the cube
+    float OccludedLength;
+    int32_t OccludedSteps; // Fixed steps it would have taken
+};
+
+/// Same as frag.glsl up to the marching loop. Returns false if the ray misses the cube,
+/// or an occluder hides it. The ray's background is valid either way.
+bool SetupMarchRay(const MarchContext& context, uint32_t x, uint32_t y, MarchRay& ray);
+
+/// Pixel value of the accumulated density blended over the background, as written to a UNORM target
+uint8_t ResolveMarchColor(float accumulated, float background);
+
+/// Write RGBA8 pixels of the tile into the full image
+MarchTileStats MarchTileScalar(const MarchContext& context, const MarchTile& tile, uint8_t* pixels);
+MarchTileStats MarchTileAvx2(const MarchContext& context, const MarchTile& tile, uint8_t* pixels);
+
+/// False if CpuRaymarcherAvx2.cpp was built without AVX2
+bool IsAvx2KernelCompiled();
+
+#endif //CPURAYMARCHERKERNELS_H
@@ -0,0 +1,90 @@
+#include "BrickOccupancy.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Upper bound of the density in terms of the first channel, see VolumeMarch.glsl
+static constexpr float MaxDensityPerFirstChannel = 0.4f;
+
+uint32_t FindOccupiedBricks(const uint8_t* texels, uint32_t size, uint32_t bricksPerSide,
+                            std::vector<vkc::ProxyBox>& boxes, ThreadPool* pool)
+{
+    PROFILE_FUNCTION();
+
+    boxes.clear();
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    bricksPerSide = std::clamp(bricksPerSide, 1u, size);
+    uint32_t brickTexels = (size + bricksPerSide - 1) / bricksPerSide;
+    uint32_t grid = (size + brickTexels - 1) / brickTexels;
+
+    // Layers are joined in order, so the boxes don't depend on the scheduling
+    std::vector<std::vector<vkc::ProxyBox>> layers(grid);
+    auto findLayer = [&](uint32_t bz)
+    {
+        for (uint32_t by = 0; by < grid; by++)
+        {
+            for (uint32_t bx = 0; bx < grid; bx++)
+            {
+                glm::uvec3 begin = glm::uvec3(bx, by, bz) * brickTexels;
+                glm::uvec3 end = glm::min(begin + brickTexels, glm::uvec3(size));
+                glm::vec3 boxMin = glm::vec3(begin) / static_cast<float>(size) * 2.0f - 1.0f;
+                glm::vec3 boxMax = glm::vec3(end) / static_cast<float>(size) * 2.0f - 1.0f;
+
+                // Smallest texel of the first channel, which makes the brick count
+                float diagonal = glm::length(boxMax - boxMin);
+                float threshold = EmptyOpticalDepth / (MaxDensityPerFirstChannel * diagonal) * 255.0f;
+                auto limit = static_cast<uint32_t>(std::ceil(threshold));
+
+                // Linear filter reaches a texel past the brick, mirrored repeat stays within the volume
+                glm::uvec3 first = glm::max(begin, glm::uvec3(1)) - 1u;
+                glm::uvec3 last = glm::min(end + 1u, glm::uvec3(size));
+                bool occupied = false;
+                for (uint32_t z = first.z; z < last.z && !occupied; z++)
+                {
+                    for (uint32_t y = first.y; y < last.y && !occupied; y++)
+                    {
+                        const uint8_t* row = texels + ((static_cast<size_t>(z) * size + y) * size) * 4;
+                        for (uint32_t x = first.x; x < last.x; x++)
+                        {
+                            if (row[x * 4] >= limit)
+                            {
+                                occupied = true;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                if (occupied)
+                {
+                    layers[bz].push_back({glm::vec4(boxMin, 0.0f), glm::vec4(boxMax, 0.0f)});
+                }
+            }
+        }
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(grid, findLayer);
+    }
+    else
+    {
+        for (uint32_t bz = 0; bz < grid; bz++)
+        {
+            findLayer(bz);
+        }
+    }
+
+    for (const auto& layer : layers)
+    {
+        boxes.insert(boxes.end(), layer.begin(), layer.end());
+    }
+    return grid;
+}
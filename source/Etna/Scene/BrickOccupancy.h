@@ -0,0 +1,28 @@
+/*
+ * Bricks of the noise volume, which hold any media, as the boxes of vkc::BrickProxy.
+ * Density of VolumeMarch.glsl is (s1 * s2) * (s3 + s4) * 0.2, so it never exceeds 0.4 * s1,
+ * baked or not. The first channel doesn't scroll, so a brick's largest s1 bounds its density
+ * for good. A brick is dropped, if a ray along its diagonal at that density stays below
+ * EmptyOpticalDepth, which keeps every pixel within half of an 8-bit step.
+ */
+
+#ifndef BRICKOCCUPANCY_H
+#define BRICKOCCUPANCY_H
+
+#include "Etna/Core/Vulkan/VulkanBrickProxy.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Bricks along each side of the box, fewer if the volume has fewer texels
+static constexpr uint32_t ProxyBricksPerSide = 16;
+static constexpr float EmptyOpticalDepth = 1.0f / 512.0f;
+
+/// Boxes of the occupied bricks of the size^3 RGBA8 volume, in the box's local space spanning [-1, 1].
+/// Brick layers are searched in parallel when a pool is given. Returns the bricks per side.
+uint32_t FindOccupiedBricks(const uint8_t* texels, uint32_t size, uint32_t bricksPerSide,
+                            std::vector<vkc::ProxyBox>& boxes, ThreadPool* pool = nullptr);
+
+#endif //BRICKOCCUPANCY_H
@@ -0,0 +1,126 @@
+#include "DensityBake.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/ThreadPool.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+
+bool DensityBakeKey::Matches(const GlobalShaderData& gsd) const
+{
+    for (int channel = 0; channel < 4; channel++)
+    {
+        if ((Channels & (1u << channel)) != 0 && GetMediaOffset(gsd, channel) != Offsets[channel])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DensityBakeKey::operator==(const DensityBakeKey& other) const
+{
+    if (Channels != other.Channels)
+    {
+        return false;
+    }
+    for (int channel = 0; channel < 4; channel++)
+    {
+        if ((Channels & (1u << channel)) != 0 && Offsets[channel] != other.Offsets[channel])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int32_t MirrorTexel(int32_t index, int32_t size)
+{
+    int32_t period = size * 2;
+    int32_t r = index % period;
+    if (r < 0)
+    {
+        r += period;
+    }
+    return r >= size ? period - 1 - r : r;
+}
+
+/// Trilinear fetch of a single channel with linear filter and mirrored repeat, as the volume's sampler
+static float SampleChannel(const uint8_t* texels, int32_t size, glm::vec3 uvw, int channel)
+{
+    glm::vec3 u = uvw * static_cast<float>(size) - 0.5f;
+    glm::vec3 base = glm::floor(u);
+    glm::vec3 f = u - base;
+
+    int32_t i0[3], i1[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        i0[axis] = MirrorTexel(static_cast<int32_t>(base[axis]), size);
+        i1[axis] = MirrorTexel(static_cast<int32_t>(base[axis]) + 1, size);
+    }
+
+    auto fetch = [&](int32_t x, int32_t y, int32_t z)
+    {
+        size_t index = (static_cast<size_t>(z) * size + y) * size + x;
+        return static_cast<float>(texels[index * 4 + channel]);
+    };
+
+    float c00 = glm::mix(fetch(i0[0], i0[1], i0[2]), fetch(i1[0], i0[1], i0[2]), f.x);
+    float c10 = glm::mix(fetch(i0[0], i1[1], i0[2]), fetch(i1[0], i1[1], i0[2]), f.x);
+    float c01 = glm::mix(fetch(i0[0], i0[1], i1[2]), fetch(i1[0], i0[1], i1[2]), f.x);
+    float c11 = glm::mix(fetch(i0[0], i1[1], i1[2]), fetch(i1[0], i1[1], i1[2]), f.x);
+
+    return glm::mix(glm::mix(c00, c10, f.y), glm::mix(c01, c11, f.y), f.z) * (1.0f / 255.0f);
+}
+
+void BakeDensity(const uint8_t* texels, uint32_t size, const DensityBakeKey& key,
+                 std::vector<uint16_t>& baked, ThreadPool* pool)
+{
+    PROFILE_FUNCTION();
+
+    baked.resize(static_cast<size_t>(size) * size * size * 2);
+    auto sizeInt = static_cast<int32_t>(size);
+
+    auto bakeSlice = [&](uint32_t z)
+    {
+        uint16_t* out = baked.data() + static_cast<size_t>(z) * size * size * 2;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                // Texel centers, where the baked volume is exact
+                glm::vec3 uvw = (glm::vec3(x, y, z) + 0.5f) / static_cast<float>(size);
+                auto sample = [&](int channel)
+                {
+                    return SampleChannel(texels, sizeInt, uvw * MediaChannelScales[channel] + key.Offsets[channel], channel);
+                };
+
+                float product = sample(0) * sample(1) * 0.2f;
+                float folded = 0.0f;
+                for (int channel = 2; channel < 4; channel++)
+                {
+                    if ((key.Channels & (1u << channel)) != 0)
+                    {
+                        folded += sample(channel);
+                    }
+                }
+
+                *out++ = static_cast<uint16_t>(glm::packHalf1x16(product * folded));
+                *out++ = static_cast<uint16_t>(glm::packHalf1x16(product));
+            }
+        }
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(size, bakeSlice);
+    }
+    else
+    {
+        for (uint32_t z = 0; z < size; z++)
+        {
+            bakeSlice(z);
+        }
+    }
+}
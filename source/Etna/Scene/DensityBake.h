@@ -0,0 +1,44 @@
+/*
+ * Media channels, which don't scroll, folded into a single RG16F volume.
+ * Density of VolumeMarch.glsl is (s1 * s2) * (s3 + s4) * 0.2, expanded into
+ * 0.2 * s1 * s2 * s3 + 0.2 * s1 * s2 * s4. With s1 and s2 static, R holds the terms
+ * of the static ones among s3 and s4, G holds 0.2 * s1 * s2, which scales the scrolling ones.
+ * With every channel static a step is one fetch instead of four.
+ */
+
+#ifndef DENSITYBAKE_H
+#define DENSITYBAKE_H
+
+#include "ShaderData.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+struct DensityBakeKey
+{
+    // Has to match VolumeMarch.glsl
+    static constexpr uint32_t ProductChannels = 0x3;
+
+    // Bit per channel folded into the volume, zero if nothing is baked
+    uint32_t Channels = 0;
+    // Offsets the folded channels were baked with
+    glm::vec3 Offsets[4] = {};
+
+    /// Bake pays off only if the product is static
+    [[nodiscard]] bool IsBakeable() const { return (Channels & ProductChannels) == ProductChannels; }
+    /// Folded channels are still where they were baked
+    [[nodiscard]] bool Matches(const GlobalShaderData& gsd) const;
+
+    bool operator==(const DensityBakeKey& other) const;
+};
+
+/// Bake the size^3 RGBA8 volume into RG16F half floats, two per texel.
+/// Slices are baked in parallel when a pool is given.
+void BakeDensity(const uint8_t* texels, uint32_t size, const DensityBakeKey& key,
+                 std::vector<uint16_t>& baked, ThreadPool* pool = nullptr);
+
+#endif //DENSITYBAKE_H
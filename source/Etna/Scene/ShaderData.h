@@ -0,0 +1,95 @@
+/*
+ * Layouts of the volume shaders' inputs.
+ * Free of any Vulkan, so CPU-only tools can use them as well.
+ */
+
+#ifndef SHADERDATA_H
+#define SHADERDATA_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+struct Vertex
+{
+    glm::vec3 Position;
+    glm::vec2 TexCoord;
+};
+
+struct ObjectShaderData
+{
+    glm::mat4 Model;
+    glm::mat4 View;
+    glm::mat4 Projection;
+};
+
+struct GlobalShaderData
+{
+    glm::mat4 WorldToLocal;
+    glm::vec3 CameraPosition;
+    int32_t MaxSteps; // Fills the padding after CameraPosition, as in std140
+    glm::mat4 MediaScroll;
+    // Zero marches at a fixed step of 4 / MaxSteps. Otherwise the step adapts to the density
+    // and to the pixel footprint, larger values take shorter steps. Up to MaxStepQuality.
+    float StepQuality;
+    // View depth of a depth buffer value d is DepthScale / (d + DepthBias), Projection[3][2] and [2][2]
+    float DepthScale;
+    float DepthBias;
+    int32_t OpaqueDepth; // Non-zero if rays end at the depth of the opaque pass
+    glm::vec4 CameraForward; // xyz view direction in the box's local space, w unused. Assumes a rigid model.
+};
+
+// Shade of the opaque boxes' faces, by the axis they face in their own space.
+// Has to match shaders/frag_opaque.glsl.
+static constexpr float OccluderFaceShades[3] = {0.3f, 0.4f, 0.5f};
+
+static constexpr float MaxStepQuality = 4.0f;
+
+// Coordinate scale and MediaScroll weight of the four fetches in VolumeMarch.glsl
+static constexpr float MediaChannelScales[4] = {1.0f, 0.8f, 0.75f, 0.7f};
+static constexpr float MediaChannelWeights[4] = {0.0f, 0.2f, 0.25f, 0.3f};
+
+/// Texture coordinate offset of the channel, it's fetched at Position * scale + offset
+inline glm::vec3 GetMediaOffset(const GlobalShaderData& gsd, int channel)
+{
+    return glm::vec3(gsd.MediaScroll[0][channel], gsd.MediaScroll[1][channel], gsd.MediaScroll[2][channel])
+        * MediaChannelWeights[channel];
+}
+
+// Per-draw data, pushed as constants into both stages.
+// Stays within the 128 bytes every device supports.
+struct DrawPushConstants
+{
+    glm::mat4 ModelViewProjection;
+    glm::vec3 CameraLocal;
+    int32_t MaxSteps; // Fills the padding after CameraLocal
+    uint32_t TextureIndex; // Slot in the bindless table, unused otherwise
+    float StepQuality;
+    float PixelAngle; // View angle of a pixel in radians, for the distance level of detail
+    uint32_t BakedChannels; // Bit per channel folded into the baked volume, see DensityBake.h
+    uint32_t BakedIndex; // Slot of the baked volume in the bindless table
+    uint32_t Fullscreen; // Non-zero draws a full-screen triangle instead of the cube, see NeedsFullscreenMarch
+};
+
+/// Near plane clips the cube's faces, if the camera is inside of it or closer than the near plane's corners.
+/// Volume is drawn with a full-screen triangle then, and its rays start at the near plane.
+inline bool NeedsFullscreenMarch(const glm::vec3& cameraLocal, const glm::mat4& projection)
+{
+    float nearPlane = projection[3][2] / projection[2][2];
+    glm::vec2 tanHalfFov = 1.0f / glm::abs(glm::vec2(projection[0][0], projection[1][1]));
+    float cornerDistance = nearPlane * std::sqrt(1.0f + glm::dot(tanHalfFov, tanHalfFov));
+    // Box spans [-1, 1], distance to it is zero inside
+    glm::vec3 outside = glm::max(glm::abs(cameraLocal) - 1.0f, 0.0f);
+    return glm::length(outside) <= cornerDistance;
+}
+
+struct VolumeCamera
+{
+    glm::vec3 Position = {3.0f, 3.0f, 3.0f};
+    glm::vec3 Target = {0.0f, 0.0f, 0.0f};
+    glm::vec3 Up = {0.0f, 0.0f, 1.0f};
+    float FovY = 45.0f;
+};
+
+#endif //SHADERDATA_H
@@ -0,0 +1,693 @@
+#include "VolumeScene.h"
+#include "BrickOccupancy.h"
+
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/ThreadPool.h"
+#include "Etna/Core/VolumeSource.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <FastNoise/FastNoise.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+static const std::vector<Vertex> CubeVertices = {
+    {{1.0, -1.0, -1.0}, {1.0, 0.0}},
+    {{1.0, -1.0, 1.0}, {1.0, 1.0}},
+    {{-1.0, -1.0, 1.0}, {0.0, 1.0}},
+    {{-1.0, -1.0, -1.0}, {0.0, 0.0}},
+    {{1.0, 1.0, -1.0}, {1.0, 0.0}},
+    {{1.0, 1.0, 1.0}, {1.0, 1.0}},
+    {{-1.0, 1.0, 1.0}, {0.0, 1.0}},
+    {{-1.0, 1.0, -1.0}, {0.0, 0.0}}
+};
+
+static const std::vector<uint16_t> CubeIndices = {
+    0, 1, 2, 0, 2, 3,
+    3, 2, 6, 3, 6, 7,
+    0, 3, 7, 0, 7, 4,
+    4, 7, 6, 4, 6, 5,
+    1, 5, 6, 1, 6, 2,
+    4, 5, 1, 4, 1, 0
+};
+
+void GenerateNoiseVolume(uint32_t volumeSize, std::vector<unsigned char>& pixelData, int32_t seed, ThreadPool* pool)
+{
+    PROFILE_FUNCTION();
+
+    int size = static_cast<int>(volumeSize);
+    size_t sizeCube = static_cast<size_t>(size) * size * size;
+    pixelData.resize(sizeCube * 4);
+
+    // Channels are independent, each one is generated by its own task.
+    // Volumes stay as they always were: the second cellular pass used to be written over the first one's
+    // output, so red packs the second pass with the first one's range and green packs zeros with its own.
+    struct Channel
+    {
+        FastNoise::SmartNode<> Node;
+        float Frequency;
+        uint32_t Power;
+        int32_t Source; // Channel whose output is packed, negative for zeros
+        std::vector<float> Output;
+        FastNoise::OutputMinMax Range;
+    };
+    std::array<Channel, 4> channels = {{
+        {FastNoise::New<FastNoise::CellularDistance>(), 0.01f, 4, 1},
+        {FastNoise::New<FastNoise::CellularDistance>(), 0.03f, 1, -1},
+        {FastNoise::New<FastNoise::Perlin>(), 0.19f, 1, 2},
+        {FastNoise::New<FastNoise::Simplex>(), 0.15f, 1, 3},
+    }};
+
+    auto generate = [&](uint32_t index)
+    {
+        PROFILE_SCOPE("GenerateNoiseChannel");
+        auto& channel = channels[index];
+        channel.Output.resize(sizeCube);
+        channel.Range = channel.Node->GenUniformGrid3D(channel.Output.data(), 0, 0, 0, size, size, size,
+                                                      channel.Frequency, seed + static_cast<int32_t>(index) + 1);
+    };
+
+    // Slices of z are packed independently as well
+    auto pack = [&](uint32_t z)
+    {
+        for (uint32_t c = 0; c < channels.size(); c++)
+        {
+            auto& channel = channels[c];
+            const float* source = channel.Source >= 0 ? channels[channel.Source].Output.data() : nullptr;
+            float inverseRange = 1 / (channel.Range.max - channel.Range.min);
+            size_t begin = static_cast<size_t>(z) * size * size;
+            for (size_t index = begin; index < begin + static_cast<size_t>(size) * size; index++)
+            {
+                float value = source ? source[index] : 0.0f;
+                float sample = 1 - (value - channel.Range.min) * inverseRange;
+                float shaped = sample;
+                for (uint32_t p = 1; p < channel.Power; p++)
+                {
+                    shaped *= sample;
+                }
+                pixelData[index * 4 + c] = static_cast<unsigned char>(shaped * 255.0f);
+            }
+        }
+    };
+
+    if (pool)
+    {
+        pool->ParallelFor(static_cast<uint32_t>(channels.size()), generate);
+        pool->ParallelFor(volumeSize, pack);
+    }
+    else
+    {
+        for (uint32_t c = 0; c < channels.size(); c++)
+        {
+            generate(c);
+        }
+        for (uint32_t z = 0; z < volumeSize; z++)
+        {
+            pack(z);
+        }
+    }
+}
+
+VolumeScene::VolumeScene(vkc::Renderer& renderer, uint32_t volumeSize, int32_t seed)
+    : VolumeScene(renderer, volumeSize, seed, nullptr)
+{
+}
+
+VolumeScene::VolumeScene(vkc::Renderer& renderer, uint32_t volumeSize, int32_t seed,
+                         const vkc::VirtualVolumeSettings& virtualSettings)
+    : VolumeScene(renderer, volumeSize, seed, &virtualSettings)
+{
+}
+
+VolumeScene::VolumeScene(vkc::Renderer& renderer, uint32_t volumeSize, int32_t seed,
+                         const vkc::VirtualVolumeSettings* virtualSettings)
+    : Renderer(renderer), VolumeSize(0), Seed(seed), IndicesCount(static_cast<uint32_t>(CubeIndices.size()))
+{
+    auto indices = CubeIndices;
+    auto vertices = CubeVertices;
+    Indices = std::make_unique<vkc::IndexBuffer>(vkc::Context::GetTransferCommandPool(), indices.data(), indices.size());
+    Vertices = std::make_unique<vkc::VertexBuffer<Vertex>>(vkc::Context::GetTransferCommandPool(), vertices.data(), vertices.size());
+
+    if (virtualSettings)
+    {
+        Virtual = std::make_unique<vkc::VirtualVolume>(Renderer, *virtualSettings);
+    }
+
+    // Volume is either a slot of the bindless table in set 1, the virtual volume's set 1,
+    // or a binding of the scene's set
+    auto& bindlessTable = Renderer.GetBindlessTable();
+    Bindless = !Virtual && bindlessTable.IsEnabled();
+
+    vkc::DescriptorSetLayout::Builder layoutBuilder;
+    layoutBuilder.AddBinding(1, vkc::DescriptorType::UniformBufferDynamic, vkc::ShaderStage::Fragment);
+    if (!Bindless && !Virtual)
+    {
+        layoutBuilder.AddBinding(2, vkc::DescriptorType::CombinedImageSampler, vkc::ShaderStage::Fragment);
+        layoutBuilder.AddBinding(3, vkc::DescriptorType::CombinedImageSampler, vkc::ShaderStage::Fragment);
+    }
+    layoutBuilder.AddBinding(4, vkc::DescriptorType::CombinedImageSampler, vkc::ShaderStage::Fragment);
+    SceneLayout = layoutBuilder.Build();
+
+    std::vector<VkDescriptorSetLayout> layouts = {
+        SceneLayout->Handle,
+    };
+    if (Bindless)
+    {
+        layouts.push_back(bindlessTable.GetLayout());
+    }
+    if (Virtual)
+    {
+        layouts.push_back(Virtual->GetLayout().Handle);
+    }
+
+    // Clears the target and leaves the occluders' depth behind, vert.glsl only reads the matrix
+    vkc::RenderPassCreateInfo opaqueInfo = {
+        .DepthEnabled = true,
+        .Type = vkc::RenderPassType::Graphic,
+        .TargetFormat = Renderer.GetTargetFormat(),
+        .VertexShaderPath = "shaders/vert.spv",
+        .FragmentShaderPath = "shaders/frag_opaque.spv",
+        .VertexLayoutInfo = vkc::CreateVertexLayout<glm::vec3, glm::vec2>(),
+        .PushConstantBlocks = {
+            vkc::PushConstantBlock::Of<DrawPushConstants>(VK_SHADER_STAGE_VERTEX_BIT)
+        },
+        .StoreDepth = true
+    };
+    Renderer.AddRenderPass(OpaquePassName, opaqueInfo);
+
+    vkc::RenderPassCreateInfo createInfo = {
+        .DepthEnabled = true,
+        .Type = vkc::RenderPassType::Graphic,
+        .TargetFormat = Renderer.GetTargetFormat(),
+        .VertexShaderPath = "shaders/vert.spv",
+        .FragmentShaderPath = Virtual ? "shaders/frag_virtual.spv"
+                            : Bindless ? "shaders/frag_bindless.spv" : "shaders/frag.spv",
+        .VertexLayoutInfo = vkc::CreateVertexLayout<glm::vec3, glm::vec2>(),
+        .DescriptorSetLayouts = layouts,
+        .PushConstantBlocks = {
+            vkc::PushConstantBlock::Of<DrawPushConstants>(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+        },
+        .ReadOnlyDepth = true,
+        .BlendOverTarget = true
+    };
+
+    Renderer.AddRenderPass(PassName, createInfo);
+
+    // Same pass with counting shaders, built in the background since it's only a debug view
+    if (!Virtual && vkc::Context::SupportsFragmentStores())
+    {
+        Cost = std::make_unique<vkc::CostMap>(Renderer);
+        CostSetIndex = static_cast<uint32_t>(layouts.size());
+
+        vkc::RenderPassCreateInfo costInfo = createInfo;
+        costInfo.FragmentShaderPath = Bindless ? "shaders/frag_bindless_cost.spv" : "shaders/frag_cost.spv";
+        costInfo.DescriptorSetLayouts.push_back(Cost->GetLayout().Handle);
+        costInfo.RequiredForFirstFrame = false;
+        Renderer.AddRenderPass(CostPassName, costInfo);
+    }
+
+    // Same pass drawing the boxes of the occupied bricks, the cube stays for fixed steps
+    if (!Virtual)
+    {
+        Proxy = std::make_unique<vkc::BrickProxy>(Renderer, IndicesCount);
+        ProxySetIndex = static_cast<uint32_t>(layouts.size());
+
+        vkc::RenderPassCreateInfo proxyInfo = createInfo;
+        proxyInfo.VertexShaderPath = Bindless ? "shaders/vert_bricks_bindless.spv" : "shaders/vert_bricks.spv";
+        proxyInfo.DescriptorSetLayouts.push_back(Proxy->GetLayout().Handle);
+        Renderer.AddRenderPass(ProxyPassName, proxyInfo);
+    }
+
+    if (volumeSize != 0)
+    {
+        LoadVolume(volumeSize);
+    }
+}
+
+VolumeScene::~VolumeScene()
+{
+    ResetBake();
+    if (Volume && Bindless)
+    {
+        Renderer.GetBindlessTable().Unregister(VolumeIndex);
+    }
+}
+
+void VolumeScene::LoadVolume(uint32_t volumeSize)
+{
+    if (HasVolume() && volumeSize == VolumeSize)
+    {
+        return;
+    }
+
+    std::vector<unsigned char> pixelData;
+    GenerateNoiseVolume(volumeSize, pixelData, Seed);
+    LoadVolume(volumeSize, pixelData);
+}
+
+void VolumeScene::LoadVolume(uint32_t volumeSize, const std::vector<unsigned char>& pixelData)
+{
+    if (pixelData.size() != static_cast<size_t>(volumeSize) * volumeSize * volumeSize * 4)
+    {
+        Error("Volume data doesn't match the size %u.", volumeSize);
+    }
+
+    if (Virtual)
+    {
+        // Levels are built from the whole volume up front, bricks are read out of them on demand
+        std::vector<uint8_t> texels(pixelData.begin(), pixelData.end());
+        LoadVolume(std::make_shared<DenseVolumeSource>(std::move(texels), volumeSize));
+        return;
+    }
+
+    // Set of the old volume might still be in flight
+    vkDeviceWaitIdle(vkc::Context::GetDevice());
+    Renderer.GetDescriptorAllocator().ClearCache();
+    ResetBake();
+    Texels.reset();
+    if (Volume && Bindless)
+    {
+        Renderer.GetBindlessTable().Unregister(VolumeIndex);
+    }
+    Volume.reset();
+
+    {
+        PROFILE_SCOPE("UploadVolume");
+        Volume = std::make_unique<vkc::Texture3D>(pixelData.data(), VkExtent3D{volumeSize, volumeSize, volumeSize});
+    }
+    VolumeSize = volumeSize;
+    if (Bindless)
+    {
+        VolumeIndex = Renderer.GetBindlessTable().Register(*Volume);
+    }
+
+    if (Baking != DensityBaking::Disabled)
+    {
+        Texels = std::make_shared<const std::vector<uint8_t>>(pixelData.begin(), pixelData.end());
+    }
+
+    if (!BakeWorkers)
+    {
+        BakeWorkers = std::make_unique<ThreadPool>();
+    }
+    std::vector<vkc::ProxyBox> boxes;
+    uint32_t grid = FindOccupiedBricks(pixelData.data(), volumeSize, ProxyBricksPerSide, boxes, BakeWorkers.get());
+    Proxy->SetBoxes(boxes);
+    InfoLog("Brick proxy of the %u^3 volume: %u of %u bricks occupied",
+            volumeSize, Proxy->GetBoxCount(), grid * grid * grid);
+}
+
+void VolumeScene::SetDensityBaking(DensityBaking baking)
+{
+    Baking = baking;
+    if (Baking == DensityBaking::Disabled)
+    {
+        vkDeviceWaitIdle(vkc::Context::GetDevice());
+        Renderer.GetDescriptorAllocator().ClearCache();
+        ResetBake();
+        Texels.reset();
+    }
+}
+
+void VolumeScene::UpdateBake(const GlobalShaderData& gsd)
+{
+    PROFILE_FUNCTION();
+
+    // Channels count as static once their offset held for a few frames.
+    // Blocking bakes from the first frame on, so tools render the baked path from their first image,
+    // a channel moving later on is fetched again, see DensityBakeKey::Matches.
+    uint32_t settleFrames = Baking == DensityBaking::Blocking ? 1 : BakeSettleFrames;
+    DensityBakeKey settled;
+    for (int channel = 0; channel < 4; channel++)
+    {
+        glm::vec3 offset = GetMediaOffset(gsd, channel);
+        bool held = !HasLastOffsets || offset == LastOffsets[channel];
+        StaticFrames[channel] = held ? std::min(StaticFrames[channel] + 1, settleFrames) : 0;
+        LastOffsets[channel] = offset;
+        if (StaticFrames[channel] >= settleFrames)
+        {
+            settled.Channels |= 1u << channel;
+            settled.Offsets[channel] = offset;
+        }
+    }
+    HasLastOffsets = true;
+
+    if (PendingBake.valid() && PendingBake.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        FinishBake();
+    }
+
+    // One bake at a time, the latest settled channels win once it's done
+    bool stale = !Baked || !(settled == BakedKey);
+    if (Texels && !PendingBake.valid() && settled.IsBakeable() && stale)
+    {
+        StartBake(settled);
+        if (Baking == DensityBaking::Blocking)
+        {
+            FinishBake();
+        }
+    }
+
+    // Channels, which moved since the bake, are fetched again until it's redone
+    bool useBake = Baked && BakedKey.Matches(gsd);
+    DrawConstants.BakedChannels = useBake ? BakedKey.Channels : 0;
+    DrawConstants.BakedIndex = useBake && Bindless ? BakedIndex : VolumeIndex;
+}
+
+void VolumeScene::StartBake(const DensityBakeKey& key)
+{
+    if (!BakeWorkers)
+    {
+        BakeWorkers = std::make_unique<ThreadPool>();
+    }
+
+    PendingKey = key;
+    PendingBake = BakeWorkers->Submit([texels = Texels, size = VolumeSize, key, pool = BakeWorkers.get()]()
+    {
+        std::vector<uint16_t> baked;
+        BakeDensity(texels->data(), size, key, baked, pool);
+        return baked;
+    });
+}
+
+void VolumeScene::FinishBake()
+{
+    PROFILE_FUNCTION();
+
+    std::vector<uint16_t> baked = PendingBake.get();
+
+    // Frames in flight still sample the previous bake, it goes away after their fences
+    if (Baked)
+    {
+        std::shared_ptr<vkc::Texture3D> previous = std::move(Baked);
+        Renderer.Retire([&renderer = Renderer, previous, index = BakedIndex, bindless = Bindless]()
+        {
+            renderer.GetDescriptorAllocator().EvictCached(reinterpret_cast<uint64_t>(previous->GetView()));
+            if (bindless)
+            {
+                renderer.GetBindlessTable().Unregister(index);
+            }
+        });
+    }
+
+    Baked = std::make_unique<vkc::Texture3D>(reinterpret_cast<unsigned char*>(baked.data()),
+                                             VkExtent3D{VolumeSize, VolumeSize, VolumeSize}, VK_FORMAT_R16G16_SFLOAT);
+    if (Bindless)
+    {
+        BakedIndex = Renderer.GetBindlessTable().Register(*Baked);
+    }
+    BakedKey = PendingKey;
+
+    InfoLog("Baked media channels 0x%x of the %u^3 volume", BakedKey.Channels, VolumeSize);
+}
+
+void VolumeScene::ResetBake()
+{
+    if (PendingBake.valid())
+    {
+        PendingBake.wait();
+        PendingBake = {};
+    }
+    if (Baked && Bindless)
+    {
+        Renderer.GetBindlessTable().Unregister(BakedIndex);
+    }
+    Baked.reset();
+    BakedKey = {};
+    HasLastOffsets = false;
+    std::fill(std::begin(StaticFrames), std::end(StaticFrames), 0u);
+}
+
+bool VolumeScene::UsesBrickProxy() const
+{
+    return ProxyEnabled && Proxy && Proxy->GetBoxCount() > 0 && StepQuality > 0.0f;
+}
+
+void VolumeScene::LoadVolume(std::shared_ptr<VolumeSource> source)
+{
+    if (!Virtual)
+    {
+        Error("Only virtual scenes stream their volume from a source.");
+    }
+
+    VolumeSize = source->GetExtent().x;
+    Virtual->SetSource(std::move(source));
+}
+
+VkDescriptorSet VolumeScene::WriteDescriptorSet()
+{
+    // Offset of the data is supplied at bind time
+    VkBuffer ring = Renderer.GetUniformRing().GetBuffer();
+    vkc::DescriptorSetWriter writer{*SceneLayout, Renderer.GetDescriptorAllocator(), vkc::DescriptorLifetime::Cached};
+    writer.WriteBuffer(1, ring, 0, sizeof(GlobalShaderData));
+    if (!Bindless && !Virtual)
+    {
+        writer.WriteImage(2, Volume->GetView(), Volume->GetSampler());
+        // Never sampled while nothing is baked, but has to be valid
+        const vkc::Texture3D& baked = Baked ? *Baked : *Volume;
+        writer.WriteImage(3, baked.GetView(), baked.GetSampler());
+    }
+    const vkc::Texture2D& depth = Renderer.GetDepthBuffer();
+    writer.WriteImage(4, depth.GetView(), depth.GetSampler(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    return writer.Write();
+}
+
+void VolumeScene::Update(const glm::mat4& model, const VolumeCamera& camera, float time)
+{
+    PROFILE_SCOPE("UpdateUniforms");
+
+    VkExtent2D extent = Renderer.GetRenderArea().extent;
+    float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+
+    ObjectShaderData osd{};
+    GlobalShaderData gsd{};
+    BuildShaderData(model, camera, time, Renderer.GetRaymarchSteps(), StepQuality, aspect, osd, gsd);
+    gsd.OpaqueDepth = Occluders.empty() ? 0 : 1;
+    ViewProjection = osd.Projection * osd.View;
+
+    float pixelAngle = GetPixelAngle(camera, extent.height);
+    DrawConstants = BuildPushConstants(osd, gsd);
+    DrawConstants.TextureIndex = VolumeIndex;
+    DrawConstants.PixelAngle = pixelAngle;
+    GlobalUniformOffset = Renderer.GetUniformRing().Push(gsd);
+
+    if (Volume && Baking != DensityBaking::Disabled)
+    {
+        UpdateBake(gsd);
+    }
+
+    if (Virtual)
+    {
+        // Box spans [-1, 1], the volume [0, 1]
+        VolumeView view = {
+            .Eye = DrawConstants.CameraLocal * 0.5f + 0.5f,
+            .Direction = glm::vec3(gsd.CameraForward)
+        };
+        Virtual->Update(pixelAngle, view);
+    }
+}
+
+void VolumeScene::BuildShaderData(const glm::mat4& model, const VolumeCamera& camera, float time,
+                                  uint32_t steps, float stepQuality, float aspect,
+                                  ObjectShaderData& osd, GlobalShaderData& gsd)
+{
+    osd = {
+        .Model = model,
+        .View = GetView(camera),
+        .Projection = GetProjection(camera, aspect)
+    };
+
+    glm::mat4 mediaScroll = {
+        {-time, 0, -0,0},
+        {0, -0, 0, 0},
+        {0, 0, -0, 0},
+        {0, 0, 0,0}
+    };
+
+    glm::mat4 worldToLocal = glm::inverse(model);
+    glm::vec3 forward = glm::normalize(glm::mat3(worldToLocal) * (camera.Target - camera.Position));
+
+    gsd = {
+        .WorldToLocal = worldToLocal,
+        .CameraPosition = camera.Position,
+        .MaxSteps = static_cast<int32_t>(steps),
+        .MediaScroll = mediaScroll,
+        .StepQuality = std::clamp(stepQuality, 0.0f, MaxStepQuality),
+        .DepthScale = osd.Projection[3][2],
+        .DepthBias = osd.Projection[2][2],
+        .OpaqueDepth = 0,
+        .CameraForward = glm::vec4(forward, 0.0f)
+    };
+}
+
+DrawPushConstants VolumeScene::BuildPushConstants(const ObjectShaderData& osd, const GlobalShaderData& gsd)
+{
+    DrawPushConstants constants = {
+        .ModelViewProjection = osd.Projection * osd.View * osd.Model,
+        .CameraLocal = glm::vec3(gsd.WorldToLocal * glm::vec4(gsd.CameraPosition, 1.0f)),
+        .MaxSteps = gsd.MaxSteps,
+        .StepQuality = gsd.StepQuality
+    };
+    constants.Fullscreen = NeedsFullscreenMarch(constants.CameraLocal, osd.Projection) ? 1u : 0u;
+    return constants;
+}
+
+float VolumeScene::GetPixelAngle(const VolumeCamera& camera, uint32_t height)
+{
+    return 2.0f * std::tan(glm::radians(camera.FovY) * 0.5f) / static_cast<float>(std::max(height, 1u));
+}
+
+void VolumeScene::Enqueue()
+{
+    if (!HasVolume())
+    {
+        return;
+    }
+
+    // Scaled by the quality governor
+    VkRect2D rect = Renderer.GetRenderArea();
+
+    auto setViewport = [rect](VkCommandBuffer commandBuffer)
+    {
+        VkViewport viewport = {
+            0.0f, 0.0f,
+            static_cast<float>(rect.extent.width), static_cast<float>(rect.extent.height),
+            0.0f, 1.0f,
+        };
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        VkRect2D scissor = rect;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    };
+
+    // Update may come after Enqueue, so its data is read when the passes are recorded
+    Renderer.EnqueueRenderPass(OpaquePassName, rect, {},
+        [this, setViewport](vkc::RenderPassContext&& rpc)
+        {
+            setViewport(rpc.CommandBuffer);
+            Indices->Bind(rpc.CommandBuffer, 0);
+            Vertices->Bind(rpc.CommandBuffer, 0);
+            for (const glm::mat4& occluder : Occluders)
+            {
+                DrawPushConstants constants = {};
+                constants.ModelViewProjection = ViewProjection * occluder;
+                rpc.Push(constants);
+                vkCmdDrawIndexed(rpc.CommandBuffer, IndicesCount, 1, 0, 0, 0);
+            }
+        });
+
+    // Image is cleared and the totals read along the pass, so both agree on the view
+    bool cost = CostView;
+    if (cost)
+    {
+        Cost->Update();
+    }
+
+    // Boxes are culled with the matrix of this frame, once Update latched it
+    bool proxy = !cost && UsesBrickProxy();
+    if (proxy)
+    {
+        Renderer.EnqueueCommands(vkc::CommandStage::BeforePasses,
+            [this](VkCommandBuffer commandBuffer, uint32_t)
+            {
+                auto& profiler = Renderer.GetGpuProfiler();
+                uint32_t zone = profiler.BeginZone(commandBuffer, CullingZoneName);
+                Proxy->RecordCulling(commandBuffer, DrawConstants.ModelViewProjection);
+                profiler.EndZone(commandBuffer, zone);
+            });
+    }
+
+    VolumePassName = cost ? CostPassName : proxy ? ProxyPassName : PassName;
+    Renderer.EnqueueRenderPass(VolumePassName, rect, {OpaquePassName},
+        [this, setViewport, cost, proxy](vkc::RenderPassContext&& rpc)
+        {
+            setViewport(rpc.CommandBuffer);
+            Indices->Bind(rpc.CommandBuffer, 0);
+            Vertices->Bind(rpc.CommandBuffer, 0);
+            // Offset picks this frame's uniforms out of the ring
+            VkDescriptorSet sceneSet = WriteDescriptorSet();
+            vkCmdBindDescriptorSets(
+                rpc.CommandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                rpc.PipelineLayout, 0, 1,
+                &sceneSet,
+                1, &GlobalUniformOffset
+            );
+            if (Bindless)
+            {
+                VkDescriptorSet tableSet = Renderer.GetBindlessTable().GetSet();
+                vkCmdBindDescriptorSets(
+                    rpc.CommandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    rpc.PipelineLayout, 1, 1,
+                    &tableSet,
+                    0, nullptr
+                );
+            }
+            if (Virtual)
+            {
+                Virtual->Bind(rpc.CommandBuffer, rpc.PipelineLayout, 1);
+            }
+            if (cost)
+            {
+                Cost->Bind(rpc.CommandBuffer, rpc.PipelineLayout, CostSetIndex);
+            }
+            if (proxy)
+            {
+                Proxy->Bind(rpc.CommandBuffer, rpc.PipelineLayout, ProxySetIndex);
+            }
+            rpc.Push(DrawConstants);
+            if (DrawConstants.Fullscreen != 0)
+            {
+                // Near plane would clip the cube, vert.glsl makes up the triangle out of the vertex index
+                vkCmdDraw(rpc.CommandBuffer, 3, 1, 0, 0);
+            }
+            else if (proxy)
+            {
+                Proxy->Draw(rpc.CommandBuffer);
+            }
+            else
+            {
+                vkCmdDrawIndexed(rpc.CommandBuffer, IndicesCount, 1, 0, 0, 0);
+            }
+        });
+}
+
+glm::mat4 VolumeScene::GetModel(float phi, float theta)
+{
+    auto rot = glm::rotate(glm::mat4(1.0f), glm::radians(phi), glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::rotate(rot, glm::radians(theta), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+std::vector<glm::mat4> VolumeScene::GetMixedOccluders()
+{
+    auto box = [](glm::vec3 center, float angle, glm::vec3 halfExtent)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+        model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+        return glm::scale(model, halfExtent);
+    };
+
+    return {
+        // Across the default view, cuts the upper half of the volume's rays short
+        box({0.0f, 0.0f, 0.6f}, 45.0f, {0.05f, 1.2f, 0.6f}),
+        // Hides a part of the volume completely
+        box({1.5f, 0.2f, 0.0f}, 0.0f, {0.15f, 0.15f, 1.4f}),
+        // Never in front of the volume
+        box({0.0f, 0.0f, -1.9f}, 0.0f, {3.0f, 3.0f, 0.05f}),
+    };
+}
+
+glm::mat4 VolumeScene::GetView(const VolumeCamera& camera)
+{
+    return glm::lookAt(camera.Position, camera.Target, camera.Up);
+}
+
+glm::mat4 VolumeScene::GetProjection(const VolumeCamera& camera, float aspect)
+{
+    auto projection = glm::perspective(glm::radians(camera.FovY), aspect, 0.1f, 10.0f);
+    projection[1][1] *= -1;
+    return projection;
+}
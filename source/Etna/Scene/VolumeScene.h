@@ -0,0 +1,209 @@
+/*
+ * Noise volume raymarched inside of a unit cube.
+ * Shared by the demo application and the benchmark,
+ * so both of them always measure the same thing.
+ * Opaque boxes are drawn into the depth buffer first, rays end where they hit them.
+ * Once the near plane would clip the cube, it's drawn as a full-screen triangle instead.
+ * Cost view draws the samples each pixel took as a heatmap, see vkc::CostMap.
+ * Dense volumes are drawn as the boxes of their occupied bricks, which the GPU culls, see vkc::BrickProxy.
+ */
+
+#ifndef VOLUMESCENE_H
+#define VOLUMESCENE_H
+
+#include "Etna/Core/Vulkan/VulkanRenderer.h"
+#include "Etna/Core/Vulkan/VulkanVertexBuffer.h"
+#include "Etna/Core/Vulkan/VulkanIndexBuffer.h"
+#include "Etna/Core/Vulkan/VulkanTexture.h"
+#include "Etna/Core/Vulkan/VulkanDescriptors.h"
+#include "Etna/Core/Vulkan/VulkanVirtualVolume.h"
+#include "Etna/Core/Vulkan/VulkanCostMap.h"
+#include "Etna/Core/Vulkan/VulkanBrickProxy.h"
+
+#include "ShaderData.h"
+#include "DensityBake.h"
+
+#include <glm/glm.hpp>
+
+#include <future>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+/// Folding media channels, which stopped scrolling, into a baked volume
+enum class DensityBaking
+{
+    Disabled,
+    Background, // Baked on workers, draws fetch every channel until it's done
+    Blocking,   // Bakes on the first frame a channel holds still and waits for it, so output doesn't depend on timings
+};
+
+/// Four channel RGBA8 noise of size^3 texels. Same seed gives the same volume.
+/// Channels are generated in parallel when a pool is given.
+void GenerateNoiseVolume(uint32_t size, std::vector<unsigned char>& pixelData, int32_t seed = 0, ThreadPool* pool = nullptr);
+
+class VolumeScene
+{
+public:
+    static constexpr const char* PassName = "BasePass";
+    // Occluders, whose depth the base pass tests against and samples
+    static constexpr const char* OpaquePassName = "OpaquePass";
+    // Instrumented base pass, drawn in its place while the cost view is on
+    static constexpr const char* CostPassName = "CostPass";
+    // Base pass drawing the occupied bricks, and the compute zone culling them before it
+    static constexpr const char* ProxyPassName = "ProxyPass";
+    static constexpr const char* CullingZoneName = "BrickCulling";
+    static constexpr float DefaultStepQuality = 1.0f;
+    // Frames a channel's offset has to hold, before it's baked in the background
+    static constexpr uint32_t BakeSettleFrames = 8;
+
+public:
+    /// Zero size leaves the volume to LoadVolume, nothing is drawn until then
+    VolumeScene(vkc::Renderer& renderer, uint32_t volumeSize, int32_t seed = 0);
+    /// Volume is streamed through a brick atlas instead of being uploaded whole
+    VolumeScene(vkc::Renderer& renderer, uint32_t volumeSize, int32_t seed, const vkc::VirtualVolumeSettings& virtualSettings);
+    VolumeScene(const VolumeScene&) = delete;
+    VolumeScene& operator=(const VolumeScene&) = delete;
+    ~VolumeScene();
+
+    /// Replace the volume. Waits for the device to idle.
+    void LoadVolume(uint32_t volumeSize);
+    /// Replace the volume with one generated elsewhere, e.g. on a worker during startup
+    void LoadVolume(uint32_t volumeSize, const std::vector<unsigned char>& pixelData);
+    /// Stream the volume from the source, e.g. a BrickStore. Only for virtual scenes.
+    void LoadVolume(std::shared_ptr<VolumeSource> source);
+
+    /// Push uniforms of the current frame into the renderer's uniform ring, latch the draw's push constants.
+    /// Must be called between BeginFrame and EndFrame, latest from the renderer's frame update.
+    void Update(const glm::mat4& model, const VolumeCamera& camera, float time);
+
+    /// Enqueue the opaque and the raymarching pass for the current frame, into the governor's render area
+    void Enqueue();
+
+    /// Boxes spanning [-1, 1] in their model space, given in world space. Empty draws no opaque geometry.
+    void SetOccluders(std::vector<glm::mat4> models) { Occluders = std::move(models); }
+    [[nodiscard]] const std::vector<glm::mat4>& GetOccluders() const { return Occluders; }
+    /// Wall through the volume, a pillar in front of it and a floor below, for the tools' mixed scene
+    [[nodiscard]] static std::vector<glm::mat4> GetMixedOccluders();
+
+    /// Only dense volumes are baked, they keep a host copy of their texels for it.
+    /// Enabling it applies to the next volume loaded.
+    void SetDensityBaking(DensityBaking baking);
+    /// Bit per channel folded into the baked volume, zero if draws fetch every channel
+    [[nodiscard]] uint32_t GetBakedChannels() const { return DrawConstants.BakedChannels; }
+
+    /// Draw the heatmap of per-pixel samples instead of the volume. Takes effect with the next Enqueue.
+    void SetCostView(bool enabled) { CostView = enabled && Cost; }
+    [[nodiscard]] bool GetCostView() const { return CostView; }
+    /// Dense volumes only, on devices with fragment shader stores
+    [[nodiscard]] bool SupportsCostView() const { return Cost != nullptr; }
+    /// Totals of the latest frame drawn with the cost view, null if it isn't supported
+    [[nodiscard]] const vkc::CostMapStats* GetCostStats() const { return Cost ? &Cost->GetStats() : nullptr; }
+
+    /// Draw the occupied bricks instead of the whole cube, takes effect with the next Enqueue.
+    /// Only adaptive steps use them, fixed ones would lose up to a step in every brick.
+    void SetBrickProxy(bool enabled) { ProxyEnabled = enabled; }
+    [[nodiscard]] bool GetBrickProxy() const { return ProxyEnabled; }
+    /// Dense volumes only
+    [[nodiscard]] bool SupportsBrickProxy() const { return Proxy != nullptr; }
+    /// Occupied bricks of the volume, out of ProxyBricksPerSide^3 at most
+    [[nodiscard]] uint32_t GetProxyBricks() const { return Proxy ? Proxy->GetBoxCount() : 0; }
+    /// Pass the volume went into with the last Enqueue, for its profiler zone
+    [[nodiscard]] const char* GetVolumePassName() const { return VolumePassName; }
+
+    /// Zero goes back to fixed steps, see GlobalShaderData::StepQuality
+    void SetStepQuality(float quality) { StepQuality = quality; }
+    [[nodiscard]] float GetStepQuality() const { return StepQuality; }
+
+    [[nodiscard]] uint32_t GetVolumeSize() const { return VolumeSize; }
+    [[nodiscard]] bool HasVolume() const { return Volume || (Virtual && Virtual->HasSource()); }
+    /// Null unless the scene streams its volume
+    [[nodiscard]] vkc::VirtualVolume* GetVirtualVolume() const { return Virtual.get(); }
+
+    /// Cube's model matrix, spun by the two angles in degrees
+    [[nodiscard]] static glm::mat4 GetModel(float phi, float theta);
+
+    [[nodiscard]] static glm::mat4 GetView(const VolumeCamera& camera);
+    [[nodiscard]] static glm::mat4 GetProjection(const VolumeCamera& camera, float aspect);
+
+    /// Shader inputs of one frame, also fed to the CPU reference raymarcher
+    static void BuildShaderData(const glm::mat4& model, const VolumeCamera& camera, float time,
+                                uint32_t steps, float stepQuality, float aspect,
+                                ObjectShaderData& osd, GlobalShaderData& gsd);
+    /// Per-draw part of the shader inputs
+    [[nodiscard]] static DrawPushConstants BuildPushConstants(const ObjectShaderData& osd, const GlobalShaderData& gsd);
+    /// View angle of a pixel in radians, for a target of the given height
+    [[nodiscard]] static float GetPixelAngle(const VolumeCamera& camera, uint32_t height);
+
+private:
+    VolumeScene(vkc::Renderer& renderer, uint32_t volumeSize, int32_t seed, const vkc::VirtualVolumeSettings* virtualSettings);
+
+    /// Cached by the allocator, so only a new volume actually writes it
+    VkDescriptorSet WriteDescriptorSet();
+
+    /// Track which channels hold still, bake them when that changes, and pick the draw's variant
+    void UpdateBake(const GlobalShaderData& gsd);
+    void StartBake(const DensityBakeKey& key);
+    /// Upload the finished bake in place of the previous one
+    void FinishBake();
+    /// Drop the baked volume, wait for the bake in flight and forget which channels held still. Device has to be idle.
+    void ResetBake();
+
+    /// Proxy has boxes, and the draw takes adaptive steps
+    [[nodiscard]] bool UsesBrickProxy() const;
+
+private:
+    vkc::Renderer& Renderer;
+    uint32_t VolumeSize;
+    int32_t Seed;
+    uint32_t IndicesCount;
+
+    std::unique_ptr<vkc::IndexBuffer> Indices;
+    std::unique_ptr<vkc::VertexBuffer<Vertex>> Vertices;
+    std::unique_ptr<vkc::Texture3D> Volume;
+    // Replaces the texture in virtual mode, its set goes after the scene's
+    std::unique_ptr<vkc::VirtualVolume> Virtual;
+
+    // Uniforms are dynamic bindings into the ring, so one set serves every frame in flight
+    std::unique_ptr<vkc::DescriptorSetLayout> SceneLayout;
+    uint32_t GlobalUniformOffset = 0;
+
+    // Counts of the instrumented pass, its set goes after the volume's
+    std::unique_ptr<vkc::CostMap> Cost;
+    uint32_t CostSetIndex = 0;
+    bool CostView = false;
+
+    // Boxes of the occupied bricks, their set goes last
+    std::unique_ptr<vkc::BrickProxy> Proxy;
+    uint32_t ProxySetIndex = 0;
+    bool ProxyEnabled = true;
+    const char* VolumePassName = PassName;
+
+    // Bindless mode samples the volume by its slot in the renderer's table
+    bool Bindless = false;
+    uint32_t VolumeIndex = 0;
+    DrawPushConstants DrawConstants = {};
+    float StepQuality = DefaultStepQuality;
+
+    std::vector<glm::mat4> Occluders;
+    glm::mat4 ViewProjection = glm::mat4(1.0f);
+
+    // Static channels folded into RG16F, see DensityBake.h
+    DensityBaking Baking = DensityBaking::Background;
+    std::shared_ptr<const std::vector<uint8_t>> Texels;
+    std::unique_ptr<vkc::Texture3D> Baked;
+    uint32_t BakedIndex = 0;
+    DensityBakeKey BakedKey;
+    DensityBakeKey PendingKey;
+    std::future<std::vector<uint16_t>> PendingBake;
+    glm::vec3 LastOffsets[4] = {};
+    bool HasLastOffsets = false;
+    uint32_t StaticFrames[4] = {};
+
+    // Last member, so it's joined before anything a bake touches goes away.
+    // Bricks of the proxy are searched on them as well.
+    std::unique_ptr<ThreadPool> BakeWorkers;
+};
+
+#endif //VOLUMESCENE_H
@@ -1,176 +1,432 @@
 #include "Core/Vulkan/VulkanCore.h"
 #include "Core/Vulkan/VulkanContext.h"
 #include "Core/Vulkan/VulkanRenderer.h"
-#include "Core/Vulkan/VulkanVertexBuffer.h"
-#include "Core/Vulkan/VulkanIndexBuffer.h"
-#include "Core/Vulkan/VulkanUniformBuffer.h"
-#include "Core/Vulkan/VulkanTexture.h"
-#include "Core/Vulkan/VulkanDescriptors.h"
 
 #include "Core/Utils.h"
 
-#include <chrono>
-#include <glm/gtc/matrix_transform.hpp>
-
-#include <FastNoise/FastNoise.h>
-
+#include "Etna/Core/BrickStore.h"
 #include "Etna/Core/Clock.h"
+#include "Etna/Core/FrameSink.h"
+#include "Etna/Core/Profiler.h"
+#include "Etna/Core/TaskGraph.h"
+#include "Etna/Core/ThreadPool.h"
+#include "Etna/Scene/VolumeScene.h"
 
 #include "imgui.h"
 
-struct Vertex
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Taken during static initialization, so the startup report starts close to the process start
+static const auto ProcessStart = std::chrono::steady_clock::now();
+
+/*
+ * Offline mode renders the media animation headless, as fast as the GPU goes:
+ *      VolumetricRenderer --offline [--frames 240] [--fps 60] [--seed 0] [--size 128]
+ *                         [--steps 128] [--quality 1] [--extent 1280x720] [--in-flight 3]
+ *                         [--spin 0] [--sink png|exr|raw] [--out frames/frame]
+ *                         [--virtual 0] [--brick 64] [--store volume.brk] [--occluders 0] [--cost 0]
+ *                         [--proxy 1]
+ * Time advances by exactly 1/fps per frame and quality is pinned,
+ * so same arguments always give the same images.
+ * Quality scales the adaptive raymarch steps, zero marches at a fixed step.
+ * Virtual streams the volume through an atlas of that many bricks per side, zero uploads it whole.
+ * Store streams it from a brick file instead of memory, the file is generated when it's missing.
+ * Occluders adds the opaque boxes of VolumeScene::GetMixedOccluders, rays end at them.
+ * Cost writes the heatmap of per-pixel samples instead of the volume and logs the totals.
+ * Proxy draws the occupied bricks of a dense volume instead of the whole cube, zero draws the cube.
+ */
+struct OfflineSettings
 {
-    glm::vec3 Position;
-    glm::vec2 TexCoord;
+    bool Enabled = false;
+    uint32_t Frames = 240;
+    float Fps = 60.0f;
+    int32_t Seed = 0;
+    uint32_t Size = 128;
+    uint32_t Steps = 128;
+    float StepQuality = VolumeScene::DefaultStepQuality;
+    VkExtent2D Extent = {1280, 720};
+    uint32_t FramesInFlight = 3;
+    float Spin = 0.0f; // Degrees per second of simulated time
+    std::string Sink = "png";
+    std::string OutputPath = "frame";
+    uint32_t VirtualAtlas = 0;
+    uint32_t BrickSize = 64;
+    std::string StorePath;
+    bool Occluders = false;
+    bool Cost = false;
+    bool Proxy = true;
 };
 
-struct ObjectShaderData
+static OfflineSettings ParseArguments(int argc, char** argv)
 {
-    glm::mat4 Model;
-    glm::mat4 View;
-    glm::mat4 Projection;
-};
+    OfflineSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--offline")
+        {
+            settings.Enabled = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            Error("Missing value for argument %s.", arg.c_str());
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--frames")
+        {
+            settings.Frames = std::stoul(value);
+        }
+        else if (arg == "--fps")
+        {
+            settings.Fps = std::stof(value);
+        }
+        else if (arg == "--seed")
+        {
+            settings.Seed = std::stoi(value);
+        }
+        else if (arg == "--size")
+        {
+            settings.Size = std::stoul(value);
+        }
+        else if (arg == "--steps")
+        {
+            settings.Steps = std::stoul(value);
+        }
+        else if (arg == "--quality")
+        {
+            settings.StepQuality = std::stof(value);
+        }
+        else if (arg == "--extent")
+        {
+            auto separator = value.find('x');
+            if (separator == std::string::npos)
+            {
+                Error("Extent has to look like 1280x720, got %s.", value.c_str());
+            }
+            settings.Extent = {
+                static_cast<uint32_t>(std::stoul(value.substr(0, separator))),
+                static_cast<uint32_t>(std::stoul(value.substr(separator + 1)))
+            };
+        }
+        else if (arg == "--in-flight")
+        {
+            settings.FramesInFlight = std::max<uint32_t>(std::stoul(value), 1);
+        }
+        else if (arg == "--spin")
+        {
+            settings.Spin = std::stof(value);
+        }
+        else if (arg == "--sink")
+        {
+            settings.Sink = value;
+        }
+        else if (arg == "--out")
+        {
+            settings.OutputPath = value;
+        }
+        else if (arg == "--occluders")
+        {
+            settings.Occluders = std::stoul(value) != 0;
+        }
+        else if (arg == "--cost")
+        {
+            settings.Cost = std::stoul(value) != 0;
+        }
+        else if (arg == "--proxy")
+        {
+            settings.Proxy = std::stoul(value) != 0;
+        }
+        else if (arg == "--virtual")
+        {
+            settings.VirtualAtlas = std::stoul(value);
+        }
+        else if (arg == "--brick")
+        {
+            settings.BrickSize = std::max<uint32_t>(std::stoul(value), 1);
+        }
+        else if (arg == "--store")
+        {
+            settings.StorePath = value;
+        }
+        else
+        {
+            Error("Unknown argument %s.", arg.c_str());
+        }
+    }
 
-struct GlobalShaderData
+    // Brick files are only read by the virtual volume
+    if (!settings.StorePath.empty() && settings.VirtualAtlas == 0)
+    {
+        settings.VirtualAtlas = 16;
+    }
+    return settings;
+}
+
+/*
+ * Startup runs as a task graph. Volume is generated on workers while the window,
+ * Vulkan and ImGui are initialized on the main thread. Pipelines are built by the
+ * compiler's workers as soon as the pass is added, the volume is uploaded last.
+ * With a brick store only the file is opened, it's written first if it doesn't exist.
+ */
+static std::unique_ptr<VolumeScene> StartUp(TaskGraph& graph, vkc::Renderer& renderer,
+                                            const vkc::RendererCreateInfo& createInfo,
+                                            uint32_t volumeSize, int32_t seed,
+                                            const vkc::VirtualVolumeSettings* virtualSettings = nullptr,
+                                            const std::string& storePath = "")
 {
-    glm::mat4 WorldToLocal;
-    glm::vec3 CameraPosition;
-    glm::mat4 MediaScroll;
-};
+    ThreadPool pool;
+    std::vector<unsigned char> pixelData;
+    std::shared_ptr<BrickStore> store;
+    std::unique_ptr<VolumeScene> scene;
 
-int main(int argc, char** argv)
+    auto generateVolume = storePath.empty()
+        ? graph.Add("GenerateVolume", [&]()
+        {
+            GenerateNoiseVolume(volumeSize, pixelData, seed, &pool);
+        })
+        : graph.Add("OpenBrickStore", [&]()
+        {
+            if (!std::filesystem::exists(storePath))
+            {
+                GenerateNoiseVolume(volumeSize, pixelData, seed, &pool);
+                DenseVolumeSource source({pixelData.begin(), pixelData.end()}, volumeSize);
+                pixelData = {};
+                BrickStore::Write(storePath, source, virtualSettings->BrickSize);
+            }
+            store = std::make_shared<BrickStore>(storePath);
+        });
+    auto initRenderer = graph.Add("InitRenderer", [&]()
+    {
+        renderer.Init(createInfo);
+    }, {}, TaskAffinity::MainThread);
+    auto createScene = graph.Add("CreateScene", [&]()
+    {
+        scene = virtualSettings ? std::make_unique<VolumeScene>(renderer, 0, seed, *virtualSettings)
+                                : std::make_unique<VolumeScene>(renderer, 0, seed);
+    }, {initRenderer}, TaskAffinity::MainThread);
+    graph.Add("BuildPipelines", [&]()
+    {
+        renderer.GetPipelineCompiler().WaitIdle();
+    }, {createScene});
+    graph.Add("UploadVolume", [&]()
+    {
+        if (store)
+        {
+            scene->LoadVolume(store);
+        }
+        else
+        {
+            scene->LoadVolume(volumeSize, pixelData);
+        }
+    }, {generateVolume, createScene}, TaskAffinity::MainThread);
+
+    graph.Run(pool);
+    return scene;
+}
+
+static void RenderOffline(const OfflineSettings& settings)
 {
-    auto fnCellular = FastNoise::New<FastNoise::CellularDistance>();
-    auto fnPerlin = FastNoise::New<FastNoise::Perlin>();
-    auto fnSimplex = FastNoise::New<FastNoise::Simplex>();
-
-    //fnPerlin->SetSource( fnSimplex );
-    //fnPerlin->SetOctaveCount( 10 );
-
-
-    int size = 128;
-    int sizeCube = size * size * size;
-    std::vector<float> noiseOutput1(sizeCube);
-    std::vector<float> noiseOutput2(sizeCube);
-    std::vector<float> noiseOutput3(sizeCube);
-    std::vector<float> noiseOutput4(sizeCube);
-    std::vector<unsigned char> pixelData(sizeCube*4);
-
-    auto output1 = fnCellular->GenUniformGrid3D(noiseOutput1.data(), 0, 0, 0, size, size, size, 0.01f, 1);
-    auto output2 = fnCellular->GenUniformGrid3D(noiseOutput1.data(), 0, 0, 0, size, size, size, 0.03f, 2);
-    auto output3 = fnPerlin->GenUniformGrid3D(noiseOutput3.data(), 0, 0, 0, size, size, size, 0.19f, 3);
-    auto output4 = fnSimplex->GenUniformGrid3D(noiseOutput4.data(), 0, 0, 0, size, size, size, 0.15f, 4);
-
-    float inverseRange1 = 1 / (output1.max - output1.min);
-    float inverseRange2 = 1 / (output2.max - output2.min);
-    float inverseRange3 = 1 / (output3.max - output3.min);
-    float inverseRange4 = 1 / (output4.max - output4.min);
-    int index = 0;
-    for (int z = 0; z < size; z++)
+    // Raw frames streamed to stdout, the log and the reports go to stderr instead
+    if (settings.Sink == "raw" && settings.OutputPath == "-")
+    {
+        Log::SetConsole(stderr);
+    }
+
+    vkc::VirtualVolumeSettings virtualSettings = {
+        .BrickSize = settings.BrickSize,
+        .AtlasBricks = settings.VirtualAtlas
+    };
+
+    TaskGraph startup(ProcessStart);
+    vkc::Renderer renderer;
+    auto scene = StartUp(startup, renderer, {
+        .Mode = vkc::ContextMode::Headless,
+        .FramesInFlight = settings.FramesInFlight,
+        .TargetExtent = settings.Extent
+    }, settings.Size, settings.Seed, settings.VirtualAtlas != 0 ? &virtualSettings : nullptr, settings.StorePath);
+
+    // Governor would make the output depend on the timings
+    renderer.GetQualityGovernor().Pin(1.0f, settings.Steps);
+    scene->SetStepQuality(settings.StepQuality);
+    scene->SetDensityBaking(DensityBaking::Blocking);
+    if (settings.Occluders)
+    {
+        scene->SetOccluders(VolumeScene::GetMixedOccluders());
+    }
+    if (settings.Cost)
+    {
+        if (!scene->SupportsCostView())
+        {
+            Warning("Cost view needs a dense volume and fragment shader stores, the volume is drawn instead.");
+        }
+        scene->SetCostView(true);
+    }
+    scene->SetBrickProxy(settings.Proxy);
+
+    auto& readback = renderer.GetFrameReadback();
+    readback.SetLossless(true);
+    readback.SetSink(CreateFrameSink(settings.Sink, settings.OutputPath));
     {
-        for (int y = 0; y < size; y++)
+        VolumeCamera camera;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < settings.Frames; i++)
         {
-            for (int x = 0; x < size; x++)
+            PROFILE_SCOPE("OfflineFrame");
+            float time = static_cast<float>(i) / settings.Fps;
+
+            renderer.BeginFrame();
+            scene->Enqueue();
+            scene->Update(VolumeScene::GetModel(settings.Spin * time, 0.0f), camera, time);
+            renderer.EndFrame();
+            if (i == 0)
             {
-                float sample1 = 1 - (noiseOutput1[index] - output1.min) * inverseRange1;
-                float sample2 = 1 - (noiseOutput2[index] - output2.min) * inverseRange2;
-                float sample3 = 1 - (noiseOutput3[index] - output3.min) * inverseRange3;
-                float sample4 = 1 - (noiseOutput4[index] - output4.min) * inverseRange4;
+                startup.LogReport("Startup", "FirstFrameSubmitted", startup.GetElapsed());
+            }
+        }
 
-                sample1 *= sample1 * sample1 * sample1;
-                //sample2 *= sample2 * sample2;
-                //sample3 *= sample3 * sample3;
+        // Frames in flight still have to reach the sink
+        vkDeviceWaitIdle(vkc::Context::GetDevice());
+        readback.Flush();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-                pixelData[index*4   ] = static_cast<unsigned char>((sample1) * 255.0f);
-                pixelData[index*4+1 ] = static_cast<unsigned char>((sample2) * 255.0f);
-                pixelData[index*4+2 ] = static_cast<unsigned char>((sample3) * 255.0f);
-                pixelData[index*4+3 ] = static_cast<unsigned char>((sample4) * 255.0f);
+        auto stats = readback.GetStats();
+        ReportLog("Rendered %u frames in %.2f s, %.1f frames/sec. Written %llu, waited for the sink %llu times.",
+                  settings.Frames, seconds, seconds > 0.0 ? settings.Frames / seconds : 0.0,
+                  static_cast<unsigned long long>(stats.Delivered), static_cast<unsigned long long>(stats.Waits));
 
-                index++;
+        // Totals are read frames in flight late, so the last frames aren't counted
+        auto cost = scene->GetCostStats();
+        if (scene->GetCostView() && cost->Frames > 0)
+        {
+            ReportLog("Raymarch cost of the last frame read: %u pixels, %llu samples, %llu fetches, %.1f samples per pixel, %u at most.",
+                      cost->Pixels, static_cast<unsigned long long>(cost->Samples), static_cast<unsigned long long>(cost->Fetches),
+                      cost->Pixels > 0 ? static_cast<double>(cost->Samples) / cost->Pixels : 0.0, cost->MaxSamples);
+        }
+
+        // Against the plain cube with --proxy 0, the profiler's table has the times of both passes
+        uint64_t fragments = 0;
+        if (renderer.GetGpuProfiler().GetLastFragments(scene->GetVolumePassName(), fragments))
+        {
+            ReportLog("%s shaded %llu fragments in the last frame read, %u occupied bricks.",
+                      scene->GetVolumePassName(), static_cast<unsigned long long>(fragments), scene->GetProxyBricks());
+        }
+
+        if (auto virtualVolume = scene->GetVirtualVolume())
+        {
+            auto& bricks = virtualVolume->GetStats();
+            ReportLog("Virtual volume: %u of %u slots resident, %llu bricks evicted.",
+                      bricks.Resident, bricks.Slots, static_cast<unsigned long long>(bricks.Evicted));
+
+            if (auto store = dynamic_cast<BrickStore*>(virtualVolume->GetSource()))
+            {
+                auto cache = store->GetStats();
+                ReportLog("Brick store: %.0f%% hits and %.1f MiB read in the last frame, %.0f%% of %llu prefetches used.",
+                          cache.HitRate * 100.0f, static_cast<double>(cache.BytesRead) / (1024.0 * 1024.0),
+                          cache.PrefetchAccuracy * 100.0f, static_cast<unsigned long long>(cache.Prefetched));
             }
         }
     }
+    scene.reset();
+    renderer.Shutdown();
+}
 
-    std::vector<Vertex> vertices = {
-        {{1.0, -1.0, -1.0}, {1.0, 0.0}},
-        {{1.0, -1.0, 1.0}, {1.0, 1.0}},
-        {{-1.0, -1.0, 1.0}, {0.0, 1.0}},
-        {{-1.0, -1.0, -1.0}, {0.0, 0.0}},
-        {{1.0, 1.0, -1.0}, {1.0, 0.0}},
-        {{1.0, 1.0, 1.0}, {1.0, 1.0}},
-        {{-1.0, 1.0, 1.0}, {0.0, 1.0}},
-        {{-1.0, 1.0, -1.0}, {0.0, 0.0}}
-    };
+/// Proxy and cost view toggles, next to the fragments the volume's pass shaded and the brick streaming
+static void RenderScenePanel(VolumeScene& scene, vkc::Renderer& renderer)
+{
+    ImGui::Begin("Scene");
+    if (scene.SupportsBrickProxy())
+    {
+        bool proxy = scene.GetBrickProxy();
+        if (ImGui::Checkbox("Brick proxy", &proxy))
+        {
+            scene.SetBrickProxy(proxy);
+        }
+        ImGui::Text("Occupied bricks: %u, drawn by %s", scene.GetProxyBricks(), scene.GetVolumePassName());
 
-    std::vector<uint16_t> indices = {
-        0, 1, 2, 0, 2, 3,
-        3, 2, 6, 3, 6, 7,
-        0, 3, 7, 0, 7, 4,
-        4, 7, 6, 4, 6, 5,
-        1, 5, 6, 1, 6, 2,
-        4, 5, 1, 4, 1, 0
-    };
+        uint64_t fragments = 0;
+        if (renderer.GetGpuProfiler().GetLastFragments(scene.GetVolumePassName(), fragments))
+        {
+            ImGui::Text("Shaded fragments: %llu", static_cast<unsigned long long>(fragments));
+        }
+    }
 
-    uint32_t indicesCount = indices.size();
+    if (auto virtualVolume = scene.GetVirtualVolume())
+    {
+        auto& bricks = virtualVolume->GetStats();
+        ImGui::Text("Resident bricks: %u of %u, %llu evicted",
+                    bricks.Resident, bricks.Slots, static_cast<unsigned long long>(bricks.Evicted));
+        if (auto store = dynamic_cast<BrickStore*>(virtualVolume->GetSource()))
+        {
+            auto cache = store->GetStats();
+            ImGui::Text("Brick store: %.0f%% hits, %.1f MiB read", cache.HitRate * 100.0f,
+                        static_cast<double>(cache.BytesRead) / (1024.0 * 1024.0));
+            ImGui::Text("Prefetches: %.0f%% of %llu used", cache.PrefetchAccuracy * 100.0f,
+                        static_cast<unsigned long long>(cache.Prefetched));
+        }
+    }
 
-    LogsInit();
-    glfwInit();
+    if (!scene.SupportsCostView())
+    {
+        ImGui::TextUnformatted("Cost view: needs a dense volume and fragment shader stores");
+        ImGui::End();
+        return;
+    }
 
+    bool costView = scene.GetCostView();
+    if (ImGui::Checkbox("Cost heatmap", &costView))
+    {
+        scene.SetCostView(costView);
+    }
 
-    Clock clock;
-    vkc::Renderer renderer;
-    renderer.Init();
-    // All vulkanish code should go inside the following scope
+    const vkc::CostMapStats& cost = *scene.GetCostStats();
+    if (costView && cost.Frames > 0)
     {
-        vkc::IndexBuffer indexBuffer(vkc::Context::GetTransferCommandPool(), indices.data(), indices.size());
-        vkc::VertexBuffer<Vertex> vertexBuffer(vkc::Context::GetTransferCommandPool(), vertices.data(), vertices.size());
-
-        vkc::Texture3D texture(pixelData.data(), VkExtent3D(size, size, size));
-        vkc::UniformBuffer<ObjectShaderData> objectUniformBuffer(renderer.GetFramesCount());
-        vkc::UniformBuffer<GlobalShaderData> globalUniformBuffer(renderer.GetFramesCount());
-
-        auto perFrameLayout = vkc::DescriptorSetLayout::Builder{}
-            .AddBinding(0, vkc::DescriptorType::UniformBuffer, vkc::ShaderStage::Vertex)
-            .AddBinding(1, vkc::DescriptorType::UniformBuffer, vkc::ShaderStage::Fragment)
-            .AddBinding(2, vkc::DescriptorType::CombinedImageSampler, vkc::ShaderStage::Fragment)
-            .Build();
-        auto perFramePool = std::make_unique<vkc::DescriptorSetPool>(*perFrameLayout, renderer.GetFramesCount());
-        auto layouts = {
-            perFrameLayout->Handle,
-        };
-        std::vector<VkDescriptorSet> perFrameSets;
-        for (uint32_t i = 0; i < renderer.GetFramesCount(); i++)
-        {
-            auto objectBuffer = objectUniformBuffer.Buffers[i];
-            auto globalBuffer = globalUniformBuffer.Buffers[i];
-
-            perFrameSets.push_back(
-                vkc::DescriptorSetWriter{*perFrameLayout, *perFramePool}
-                    .WriteBuffer(0, objectBuffer, 0, sizeof(ObjectShaderData))
-                    .WriteBuffer(1, globalBuffer, 0, sizeof(GlobalShaderData))
-                    .WriteImage(2, texture.GetView(), texture.GetSampler())
-                    .Write()
-            );
-        }
+        double pixels = std::max<double>(cost.Pixels, 1.0);
+        ImGui::Text("Pixels marched: %u", cost.Pixels);
+        ImGui::Text("Samples: %llu (%.1f per pixel, %u at most)",
+                    static_cast<unsigned long long>(cost.Samples), static_cast<double>(cost.Samples) / pixels, cost.MaxSamples);
+        ImGui::Text("Fetches: %llu (%.1f per pixel)",
+                    static_cast<unsigned long long>(cost.Fetches), static_cast<double>(cost.Fetches) / pixels);
+    }
+    ImGui::End();
+}
 
-        vkc::RenderPassCreateInfo createInfo = {
-            .DepthEnabled = true,
-            .Type = vkc::RenderPassType::Graphic,
-            .TargetFormat = renderer.GetSwapchainImageFormat(),
-            .VertexShaderPath = "shaders/vert.spv",
-            .FragmentShaderPath = "shaders/frag.spv",
-            .VertexLayoutInfo = vkc::CreateVertexLayout<glm::vec3, glm::vec2>(),
-            .DescriptorSetLayouts = layouts
-        };
+static int Run(int argc, char** argv)
+{
+    OfflineSettings offline = ParseArguments(argc, argv);
+    if (offline.Enabled)
+    {
+        RenderOffline(offline);
+        return 0;
+    }
 
-        renderer.AddRenderPass("BasePass", createInfo);
+    TaskGraph startup(ProcessStart);
+    vkc::Renderer renderer;
+    // Interactive runs keep their pipelines, the tools and offline renders start from scratch
+    auto scene = StartUp(startup, renderer, {.PipelineCachePath = GetUserCachePath("pipeline_cache.bin")}, 128, 0);
+    bool firstFrame = true;
+
+    Clock clock;
+    // All vulkanish code should go inside the following scope
+    {
+        VolumeCamera camera;
 
-        auto startTime = std::chrono::high_resolution_clock::now();
         float cubePhi = 0;
         float cubeTheta = 0;
         float rotationSpeed = 100.f;
         float controlledFrameTime = 0;
-        while (!glfwWindowShouldClose(vkc::Context::GetWindow()))
+
+        // Runs after the fence and the image acquire, so keys are read right before the frame is recorded
+        renderer.SetFrameUpdate([&](uint32_t)
         {
             glfwPollEvents();
             float deltaTime = 0.016;
@@ -189,75 +445,60 @@ int main(int argc, char** argv)
             if (glfwGetKey(vkc::Context::GetWindow(), GLFW_KEY_ESCAPE) == GLFW_PRESS)
                 glfwSetWindowShouldClose(vkc::Context::GetWindow(), true);
 
-            VkRect2D rect = {{0,0}, renderer.GetSwapchainExtent()};
-
-            renderer.EnqueueRenderPass("BasePass", rect, {},
-                [rect, &perFrameSets, &indexBuffer, &vertexBuffer, indicesCount]
-                (vkc::RenderPassContext&& rpc)
-                {
-                    VkViewport viewport = {
-                        0.0f, 0.0f,
-                        static_cast<float>(rect.extent.width), static_cast<float>(rect.extent.height),
-                        0.0f, 1.0f,
-                    };
-                    vkCmdSetViewport(rpc.CommandBuffer, 0, 1, &viewport);
-                    VkRect2D scissor = rect;
-                    vkCmdSetScissor(rpc.CommandBuffer, 0, 1, &scissor);
-                    indexBuffer.Bind(rpc.CommandBuffer, 0);
-                    vertexBuffer.Bind(rpc.CommandBuffer, 0);
-                    // Bind per frame sets
-                    vkCmdBindDescriptorSets(
-                        rpc.CommandBuffer,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        rpc.PipelineLayout, 0, 1,
-                        &perFrameSets[rpc.FrameIndex],
-                        0, nullptr
-                    );
-                    vkCmdDrawIndexed(rpc.CommandBuffer, indicesCount, 1, 0, 0, 0);
-                });
-
-            // Update MVP matrix
-            auto currentTime = std::chrono::high_resolution_clock::now();
-            float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-            auto rot = glm::rotate(glm::mat4(1.0f), glm::radians(cubePhi), glm::vec3(0.0f, 0.0f, 1.0f));
-            ObjectShaderData osd = {
-                .Model = glm::rotate(rot, glm::radians(cubeTheta), glm::vec3(0.0f, 1.0f, 0.0f)),
-                .View = glm::lookAt(glm::vec3(3.0f, 3.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
-                .Projection = glm::perspective(glm::radians(45.0f), (float)1280 / (float)720, 0.1f, 10.0f)
-            };
-            osd.Projection[1][1] *= -1;
-
-            glm::mat4 worldToLocal = glm::inverse(osd.Model);
-
-            float frameTime = clock.Elapsed();
-            glm::mat4 mediaScroll = {
-                {-frameTime, 0, -0,0},
-                {0, -0, 0, 0},
-                {0, 0, -0, 0},
-                {0, 0, 0,0}
-            };
-
-            GlobalShaderData gsd = {
-                .WorldToLocal = worldToLocal,
-                .CameraPosition = glm::vec3(3.0f, 3.0f, 3.0f),
-                //.FrameTime = (float)cos(clock.Elapsed() * 0.5f) * 0.49f + 0.5f,
-                .MediaScroll = mediaScroll
-            };
-            //InfoLog("FrameTime: %f", gsd.FrameTime);
+            scene->Update(VolumeScene::GetModel(cubePhi, cubeTheta), camera, clock.Elapsed());
+        });
 
-            objectUniformBuffer.Update(&osd, renderer.GetCurrentFrame());
-            globalUniformBuffer.Update(&gsd, renderer.GetCurrentFrame());
+        while (!glfwWindowShouldClose(vkc::Context::GetWindow()))
+        {
+            // Window and GUI events, the frame update polls again for its input
+            glfwPollEvents();
 
+            // Uniform ring is reset by BeginFrame, the scene's uniforms are written by the frame update
             renderer.BeginFrame();
+            scene->Enqueue();
+
             // ImGui stuff goes here
             static bool show_demo_window = true;
             ImGui::ShowDemoWindow(&show_demo_window);
+            RenderScenePanel(*scene, renderer);
             renderer.EndFrame();
+
+            if (firstFrame)
+            {
+                startup.LogReport("Startup", "FirstFramePresented", startup.GetElapsed());
+                firstFrame = false;
+            }
         }
 
         vkDeviceWaitIdle(vkc::Context::GetDevice());
+        // Update refers to the scene
+        renderer.SetFrameUpdate({});
+        scene.reset();
     }
     renderer.Shutdown();
 
     return 0;
 }
+
+int main(int argc, char** argv)
+{
+    PROFILE_THREAD_NAME("Main");
+
+    LogsInit();
+    int result = 1;
+    try
+    {
+        result = Run(argc, argv);
+    }
+    catch (const Exception&)
+    {
+        // Already logged by Error
+    }
+    catch (const std::exception& exception)
+    {
+        ErrorNoThrow("Unhandled exception: %s", exception.what());
+    }
+    Log::Stop();
+
+    return result;
+}